@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) 2018 Samsung Electronics Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <app_preference.h>
+
+typedef struct preference {
+	struct preference *next;
+	int value;
+	char key[];
+} preference_t;
+
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+static preference_t *g_head;
+
+static preference_t *preference_find(const char *key)
+{
+	preference_t *p;
+
+	for (p = g_head; p; p = p->next) {
+		if (!strcmp(p->key, key))
+			return p;
+	}
+
+	return NULL;
+}
+
+int preference_get_int(const char *key, int *value)
+{
+	preference_t *p;
+
+	if (!key || !value)
+		return PREFERENCE_ERROR_INVALID_PARAMETER;
+
+	pthread_mutex_lock(&g_lock);
+	p = preference_find(key);
+	if (p)
+		*value = p->value;
+	pthread_mutex_unlock(&g_lock);
+
+	return p ? PREFERENCE_ERROR_NONE : PREFERENCE_ERROR_NO_KEY;
+}
+
+int preference_set_int(const char *key, int value)
+{
+	preference_t *p;
+
+	if (!key)
+		return PREFERENCE_ERROR_INVALID_PARAMETER;
+
+	pthread_mutex_lock(&g_lock);
+	p = preference_find(key);
+	if (!p) {
+		p = malloc(sizeof(*p) + strlen(key) + 1);
+		if (!p) {
+			pthread_mutex_unlock(&g_lock);
+			return PREFERENCE_ERROR_OUT_OF_MEMORY;
+		}
+		strcpy(p->key, key);
+		p->next = g_head;
+		g_head = p;
+	}
+	p->value = value;
+	pthread_mutex_unlock(&g_lock);
+
+	return PREFERENCE_ERROR_NONE;
+}
@@ -0,0 +1,406 @@
+/*
+ * Copyright (c) 2018 Samsung Electronics Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/*
+ * MQTT packet codec microbenchmarks
+ *
+ * The SDK codec sources are included here so their static serializers and
+ * the topic matcher can be timed directly. Results use the Go benchmark
+ * line format, so two runs can be compared with benchstat:
+ *
+ *   BenchmarkName <iterations> <ns> ns/op
+ *
+ *   codec-bench [-t msec] [-c count] [filter...]
+ */
+
+#include "../src/deviceSdk/src/aws_iot_mqtt_client_common_internal.c"
+#include "../src/deviceSdk/src/aws_iot_mqtt_client_publish.c"
+#include "../src/deviceSdk/src/aws_iot_mqtt_client_subscribe.c"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#define CODEC_BUF_SIZE		(300 * 1024)
+#define CODEC_TOPIC_MAX		64		// filters in one SUBSCRIBE / SUBACK
+#define CODEC_TARGET_MSEC	200
+
+typedef struct codec_case codec_case_t;
+
+struct codec_case {
+	char name[80];
+	IoT_Error_t (*run)(const codec_case_t *c, unsigned long iters);	// result of the last call
+	uint32_t len;			// remaining length, payload size or filter count
+	QoS qos;
+	const char *filter;
+	const char *topic;
+	bool error;			// times a rejected input
+};
+
+static unsigned char g_buf[CODEC_BUF_SIZE];
+static unsigned char g_payload[CODEC_BUF_SIZE];
+static char g_topic[CODEC_TOPIC_MAX][128];
+static const char *g_topic_list[CODEC_TOPIC_MAX];
+static uint16_t g_topic_len[CODEC_TOPIC_MAX];
+static QoS g_topic_qos[CODEC_TOPIC_MAX];
+static volatile uint32_t g_sink;
+
+// there is no application here to trace or publish metrics for
+void mqtt_request_metrics(void)
+{
+}
+
+void mqtt_set_metrics_period(int period_sec)
+{
+}
+
+static uint64_t clock_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static IoT_Error_t run_write_len(const codec_case_t *c, unsigned long iters)
+{
+	uint32_t sum = 0;
+
+	while (iters--)
+		sum += aws_iot_mqtt_internal_write_len_to_buffer(g_buf, c->len + (iters & 1));
+
+	g_sink = sum;
+
+	return SUCCESS;
+}
+
+static IoT_Error_t run_decode_len(const codec_case_t *c, unsigned long iters)
+{
+	unsigned char enc[8];
+	uint32_t len = 0, bytes = 0, sum = 0;
+	IoT_Error_t rc = SUCCESS;
+
+	if (c->len == UINT32_MAX) {
+		// five continuation bytes, rejected after the fourth
+		memset(enc, 0xFF, sizeof(enc));
+	} else {
+		aws_iot_mqtt_internal_write_len_to_buffer(enc, c->len);
+	}
+
+	while (iters--) {
+		rc = aws_iot_mqtt_internal_decode_remaining_length_from_buffer(enc, &len, &bytes);
+		sum += len + bytes;
+	}
+
+	g_sink = sum;
+
+	return rc;
+}
+
+static IoT_Error_t run_serialize_publish(const codec_case_t *c, unsigned long iters)
+{
+	uint32_t len, sum = 0;
+	IoT_Error_t rc = SUCCESS;
+
+	while (iters--) {
+		rc = _aws_iot_mqtt_internal_serialize_publish(g_buf, sizeof(g_buf), 0, c->qos, 0, (uint16_t)iters,
+												 c->topic, (uint16_t)strlen(c->topic),
+												 g_payload, c->len, &len);
+		sum += len;
+	}
+
+	g_sink = sum;
+
+	return rc;
+}
+
+static IoT_Error_t run_deserialize_publish(const codec_case_t *c, unsigned long iters)
+{
+	uint32_t len;
+	uint16_t id, topic_len;
+	uint8_t dup, retained;
+	QoS qos;
+	char *topic;
+	unsigned char *payload;
+	size_t payload_len;
+	uint32_t sum = 0;
+	IoT_Error_t rc;
+
+	rc = _aws_iot_mqtt_internal_serialize_publish(g_buf, sizeof(g_buf), 0, c->qos, 0, 1,
+												  c->topic, (uint16_t)strlen(c->topic),
+												  g_payload, c->len, &len);
+	if (rc != SUCCESS)
+		return rc;
+
+	while (iters--) {
+		rc = aws_iot_mqtt_internal_deserialize_publish(&dup, &qos, &retained, &id, &topic, &topic_len,
+												  &payload, &payload_len, g_buf, len);
+		sum += payload_len + topic_len;
+	}
+
+	g_sink = sum;
+
+	return rc;
+}
+
+static IoT_Error_t run_serialize_subscribe(const codec_case_t *c, unsigned long iters)
+{
+	uint32_t len, sum = 0;
+	IoT_Error_t rc = SUCCESS;
+
+	while (iters--) {
+		rc = _aws_iot_mqtt_serialize_subscribe(g_buf, sizeof(g_buf), 0, (uint16_t)iters, c->len,
+										  g_topic_list, g_topic_len, g_topic_qos, &len);
+		sum += len;
+	}
+
+	g_sink = sum;
+
+	return rc;
+}
+
+static IoT_Error_t run_deserialize_suback(const codec_case_t *c, unsigned long iters)
+{
+	QoS granted[CODEC_TOPIC_MAX];
+	uint32_t count, i, n = 0, sum = 0;
+	uint16_t id;
+	IoT_Error_t rc = SUCCESS;
+
+	g_buf[n++] = SUBACK << 4;
+	n += aws_iot_mqtt_internal_write_len_to_buffer(g_buf + n, 2 + c->len);
+	g_buf[n++] = 0x12;
+	g_buf[n++] = 0x34;
+	for (i = 0; i < c->len; i++)
+		g_buf[n++] = i & 1;
+
+	// an error case expects fewer filters than were granted
+	while (iters--) {
+		rc = _aws_iot_mqtt_deserialize_suback(&id, c->error ? c->len - 1 : c->len, &count, granted, g_buf, n);
+		sum += count;
+	}
+
+	g_sink = sum;
+
+	return rc;
+}
+
+static IoT_Error_t run_topic_match(const codec_case_t *c, unsigned long iters)
+{
+	uint16_t len = (uint16_t)strlen(c->topic);
+	uint32_t sum = 0;
+
+	while (iters--)
+		sum += _aws_iot_mqtt_internal_is_topic_matched((char *)c->filter, (char *)c->topic, len);
+
+	g_sink = sum;
+
+	return SUCCESS;
+}
+
+static const uint32_t g_lengths[] = { 0, 127, 128, 16383, 16384, 2097151, 2097152, 268435455 };
+static const uint32_t g_payloads[] = { 0, 32, 256, 4096, 262144 };
+static const uint32_t g_filters[] = { 1, 8, 64 };
+
+// realistic device topics and adversarial depths
+static const char g_deep_topic[] = "a/b/c/d/e/f/g/h/i/j/k/l/m/n/o/p/q/r/s/t/u/v/w/x/y/z/0/1/2/3/4/5";
+static const char g_shadow_topic[] = "$aws/things/AWS-IoT-C-SDK/shadow/update/delta";
+
+static const struct {
+	const char *name;
+	const char *filter;
+	const char *topic;
+} g_matches[] = {
+	{ "exact", "tizen/sub", "tizen/sub" },
+	{ "shadow_plus", "$aws/things/+/shadow/update/delta", g_shadow_topic },
+	{ "shadow_hash", "$aws/things/AWS-IoT-C-SDK/shadow/#", g_shadow_topic },
+	{ "miss_first", "tizen/sub", g_shadow_topic },
+	{ "miss_last", "$aws/things/AWS-IoT-C-SDK/shadow/update/deltb", g_shadow_topic },
+	{ "deep_plus", "+/+/+/+/+/+/+/+/+/+/+/+/+/+/+/+/+/+/+/+/+/+/+/+/+/+/+/+/+/+/+/+", g_deep_topic },
+	{ "deep_hash", "a/#", g_deep_topic },
+};
+
+#define ARRAY_SIZE(a)	(sizeof(a) / sizeof((a)[0]))
+
+static int codec_cases(codec_case_t *cases)
+{
+	static char long_topic[257];
+	const char *topics[] = { "tizen/sub", long_topic };
+	int n = 0;
+	size_t i, t, q;
+
+	memset(long_topic, 't', sizeof(long_topic) - 1);
+
+	for (i = 0; i < ARRAY_SIZE(g_lengths); i++) {
+		snprintf(cases[n].name, sizeof(cases[n].name), "WriteLen/%u", g_lengths[i]);
+		cases[n].run = run_write_len;
+		cases[n++].len = g_lengths[i];
+	}
+
+	for (i = 0; i < ARRAY_SIZE(g_lengths); i++) {
+		snprintf(cases[n].name, sizeof(cases[n].name), "DecodeLen/%u", g_lengths[i]);
+		cases[n].run = run_decode_len;
+		cases[n++].len = g_lengths[i];
+	}
+	snprintf(cases[n].name, sizeof(cases[n].name), "DecodeLen/malformed");
+	cases[n].run = run_decode_len;
+	cases[n].error = true;
+	cases[n++].len = UINT32_MAX;
+
+	for (q = 0; q <= 1; q++) {
+		for (t = 0; t < ARRAY_SIZE(topics); t++) {
+			for (i = 0; i < ARRAY_SIZE(g_payloads); i++) {
+				snprintf(cases[n].name, sizeof(cases[n].name), "SerializePublish/qos%zu/topic%zu/payload%u",
+						 q, strlen(topics[t]), g_payloads[i]);
+				cases[n].run = run_serialize_publish;
+				cases[n].qos = (QoS)q;
+				cases[n].topic = topics[t];
+				cases[n++].len = g_payloads[i];
+
+				snprintf(cases[n].name, sizeof(cases[n].name), "DeserializePublish/qos%zu/topic%zu/payload%u",
+						 q, strlen(topics[t]), g_payloads[i]);
+				cases[n].run = run_deserialize_publish;
+				cases[n].qos = (QoS)q;
+				cases[n].topic = topics[t];
+				cases[n++].len = g_payloads[i];
+			}
+		}
+	}
+
+	for (i = 0; i < ARRAY_SIZE(g_filters); i++) {
+		snprintf(cases[n].name, sizeof(cases[n].name), "SerializeSubscribe/filters%u", g_filters[i]);
+		cases[n].run = run_serialize_subscribe;
+		cases[n++].len = g_filters[i];
+
+		snprintf(cases[n].name, sizeof(cases[n].name), "DeserializeSuback/filters%u", g_filters[i]);
+		cases[n].run = run_deserialize_suback;
+		cases[n++].len = g_filters[i];
+	}
+	snprintf(cases[n].name, sizeof(cases[n].name), "DeserializeSuback/overflow");
+	cases[n].run = run_deserialize_suback;
+	cases[n].error = true;
+	cases[n++].len = 8;
+
+	for (i = 0; i < ARRAY_SIZE(g_matches); i++) {
+		snprintf(cases[n].name, sizeof(cases[n].name), "TopicMatch/%s", g_matches[i].name);
+		cases[n].run = run_topic_match;
+		cases[n].filter = g_matches[i].filter;
+		cases[n++].topic = g_matches[i].topic;
+	}
+
+	return n;
+}
+
+static void codec_init(void)
+{
+	int i;
+
+	for (i = 0; i < (int)sizeof(g_payload); i++)
+		g_payload[i] = (unsigned char)i;
+
+	for (i = 0; i < CODEC_TOPIC_MAX; i++) {
+		snprintf(g_topic[i], sizeof(g_topic[i]), "$aws/things/AWS-IoT-C-SDK/cmd/%d", i);
+		g_topic_list[i] = g_topic[i];
+		g_topic_len[i] = (uint16_t)strlen(g_topic[i]);
+		g_topic_qos[i] = (QoS)(i & 1);
+	}
+}
+
+// grow the iteration count until one run takes the target time
+static void codec_run(const codec_case_t *c, uint64_t target_ns)
+{
+	unsigned long iters = 1;
+	uint64_t elapsed;
+	IoT_Error_t rc;
+
+	// a case timing an unintended error path would be meaningless
+	rc = c->run(c, 1);
+	if ((rc != SUCCESS) != c->error) {
+		fprintf(stderr, "Benchmark%s: unexpected result %d\n", c->name, rc);
+		return;
+	}
+
+	for (;;) {
+		uint64_t start = clock_ns();
+
+		c->run(c, iters);
+		elapsed = clock_ns() - start;
+
+		if (elapsed >= target_ns || iters >= 1000000000ul)
+			break;
+
+		if (elapsed < target_ns / 100)
+			iters *= 100;
+		else
+			iters = iters * target_ns / elapsed * 6 / 5 + 1;
+	}
+
+	printf("Benchmark%s %lu %.2f ns/op\n", c->name, iters, (double)elapsed / iters);
+}
+
+static bool codec_selected(const char *name, int argc, char *argv[])
+{
+	int a;
+
+	if (optind >= argc)
+		return true;
+
+	for (a = optind; a < argc; a++) {
+		if (strstr(name, argv[a]))
+			return true;
+	}
+
+	return false;
+}
+
+int main(int argc, char *argv[])
+{
+	static codec_case_t cases[128];
+	uint64_t target_ns = CODEC_TARGET_MSEC * 1000000ull;
+	int count = 1;
+	int n, i, r, opt;
+
+	while ((opt = getopt(argc, argv, "t:c:h")) != -1) {
+		switch (opt) {
+		case 't':
+			target_ns = strtoull(optarg, NULL, 0) * 1000000ull;
+			break;
+		case 'c':
+			count = atoi(optarg);
+			break;
+		default:
+			fprintf(stderr, "usage: codec-bench [-t msec] [-c count] [filter...]\n");
+			return 1;
+		}
+	}
+
+	codec_init();
+	n = codec_cases(cases);
+
+	for (r = 0; r < count; r++) {
+		for (i = 0; i < n; i++) {
+			if (codec_selected(cases[i].name, argc, argv)) {
+				codec_run(&cases[i], target_ns);
+				fflush(stdout);
+			}
+		}
+	}
+
+	return 0;
+}
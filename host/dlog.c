@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) 2018 Samsung Electronics Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+#include <dlog.h>
+
+static log_priority g_level = DLOG_UNKNOWN;
+static pthread_mutex_t g_log_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static log_priority dlog_level(void)
+{
+	const char *env;
+
+	if (g_level != DLOG_UNKNOWN)
+		return g_level;
+
+	env = getenv("HOST_LOG_LEVEL");
+	switch (env ? env[0] : 'I') {
+	case 'V': case 'v': g_level = DLOG_VERBOSE; break;
+	case 'D': case 'd': g_level = DLOG_DEBUG; break;
+	case 'W': case 'w': g_level = DLOG_WARN; break;
+	case 'E': case 'e': g_level = DLOG_ERROR; break;
+	case 'S': case 's': g_level = DLOG_SILENT; break;
+	default: g_level = DLOG_INFO; break;
+	}
+
+	return g_level;
+}
+
+int dlog_print(log_priority prio, const char *tag, const char *fmt, ...)
+{
+	static const char level_char[] = "UUVDIWEFS";
+	struct timespec ts;
+	va_list ap;
+	int ret;
+
+	if (prio < dlog_level() || prio >= DLOG_SILENT)
+		return 0;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	pthread_mutex_lock(&g_log_lock);
+	fprintf(stderr, "%5ld.%06ld %c/%s: ", (long)ts.tv_sec, ts.tv_nsec / 1000, level_char[prio], tag);
+	va_start(ap, fmt);
+	ret = vfprintf(stderr, fmt, ap);
+	va_end(ap);
+	if (ret > 0 && fmt[0] && fmt[strlen(fmt) - 1] != '\n')
+		fputc('\n', stderr);
+	pthread_mutex_unlock(&g_log_lock);
+
+	return ret;
+}
@@ -0,0 +1,205 @@
+/*
+ * Copyright (c) 2018 Samsung Electronics Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <poll.h>
+#include <pthread.h>
+#include <Ecore.h>
+
+#define FD_HANDLER_MAX	16
+
+struct _Ecore_Fd_Handler {
+	int fd;
+	Ecore_Fd_Handler_Flags flags;
+	Ecore_Fd_Cb func;
+	void *data;
+	short revents;
+	bool deleted;
+};
+
+static Ecore_Fd_Handler *g_handlers[FD_HANDLER_MAX];
+static int g_wake_pipe[2] = { -1, -1 };
+
+static short fd_flags_to_events(Ecore_Fd_Handler_Flags flags)
+{
+	short events = 0;
+
+	if (flags & ECORE_FD_READ)
+		events |= POLLIN;
+	if (flags & ECORE_FD_WRITE)
+		events |= POLLOUT;
+	if (flags & ECORE_FD_ERROR)
+		events |= POLLERR;
+
+	return events;
+}
+
+int ecore_init(void)
+{
+	if (g_wake_pipe[0] < 0 && pipe2(g_wake_pipe, O_CLOEXEC | O_NONBLOCK) != 0) {
+		fprintf(stderr, "main loop pipe failed [%d]\n", errno);
+		return 0;
+	}
+
+	return 1;
+}
+
+// handlers belong to the main loop thread, as with Ecore
+Ecore_Fd_Handler *ecore_main_fd_handler_add(int fd, Ecore_Fd_Handler_Flags flags, Ecore_Fd_Cb func, const void *data, Ecore_Fd_Cb buf_func, const void *buf_data)
+{
+	Ecore_Fd_Handler *h;
+	int i;
+
+	(void)buf_func;
+	(void)buf_data;
+
+	if (fd < 0 || !func)
+		return NULL;
+
+	for (i = 0; i < FD_HANDLER_MAX; i++) {
+		if (g_handlers[i])
+			continue;
+
+		h = calloc(1, sizeof(*h));
+		if (!h)
+			return NULL;
+
+		h->fd = fd;
+		h->flags = flags;
+		h->func = func;
+		h->data = (void *)data;
+		g_handlers[i] = h;
+
+		return h;
+	}
+
+	return NULL;
+}
+
+void *ecore_main_fd_handler_del(Ecore_Fd_Handler *fd_handler)
+{
+	void *data;
+
+	if (!fd_handler || fd_handler->deleted)
+		return NULL;
+
+	// freed by the loop, the handler may be the one being dispatched
+	data = fd_handler->data;
+	fd_handler->deleted = true;
+
+	return data;
+}
+
+int ecore_main_fd_handler_fd_get(Ecore_Fd_Handler *fd_handler)
+{
+	return fd_handler ? fd_handler->fd : -1;
+}
+
+Eina_Bool ecore_main_fd_handler_active_get(Ecore_Fd_Handler *fd_handler, Ecore_Fd_Handler_Flags flags)
+{
+	if (!fd_handler)
+		return EINA_FALSE;
+
+	return (fd_handler->revents & fd_flags_to_events(flags)) ? EINA_TRUE : EINA_FALSE;
+}
+
+static void ecore_main_loop_reap(void)
+{
+	int i;
+
+	for (i = 0; i < FD_HANDLER_MAX; i++) {
+		if (g_handlers[i] && g_handlers[i]->deleted) {
+			free(g_handlers[i]);
+			g_handlers[i] = NULL;
+		}
+	}
+}
+
+void ecore_main_loop_begin(void)
+{
+	struct pollfd pfd[FD_HANDLER_MAX + 1];
+	Ecore_Fd_Handler *owner[FD_HANDLER_MAX + 1];
+	char buf[16];
+	int n, i;
+
+	if (ecore_init() != 1)
+		return;
+
+	for (;;) {
+		ecore_main_loop_reap();
+
+		pfd[0].fd = g_wake_pipe[0];
+		pfd[0].events = POLLIN;
+		pfd[0].revents = 0;
+		n = 1;
+		for (i = 0; i < FD_HANDLER_MAX; i++) {
+			if (!g_handlers[i])
+				continue;
+			pfd[n].fd = g_handlers[i]->fd;
+			pfd[n].events = fd_flags_to_events(g_handlers[i]->flags);
+			pfd[n].revents = 0;
+			owner[n] = g_handlers[i];
+			n++;
+		}
+
+		if (poll(pfd, n, -1) < 0) {
+			if (errno == EINTR)
+				continue;
+			fprintf(stderr, "main loop poll failed [%d]\n", errno);
+			break;
+		}
+
+		if (pfd[0].revents) {
+			while (read(g_wake_pipe[0], buf, sizeof(buf)) > 0)
+				;
+			break;
+		}
+
+		for (i = 1; i < n; i++) {
+			Ecore_Fd_Handler *h = owner[i];
+
+			if (!pfd[i].revents || h->deleted)
+				continue;
+
+			h->revents = pfd[i].revents;
+			if (h->func(h->data, h) == ECORE_CALLBACK_CANCEL)
+				h->deleted = true;
+			h->revents = 0;
+		}
+	}
+
+	ecore_main_loop_reap();
+}
+
+// async-signal-safe, may be called from any thread or a signal handler
+void ecore_main_loop_quit(void)
+{
+	int saved = errno;
+	ssize_t ret;
+
+	if (g_wake_pipe[1] >= 0) {
+		ret = write(g_wake_pipe[1], "q", 1);
+		(void)ret;
+	}
+	errno = saved;
+}
@@ -0,0 +1,53 @@
+/*
+ * Copyright (c) 2018 Samsung Electronics Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/*
+ * Host stand-in for the part of Ecore used by the application:
+ * fd handlers dispatched from the service_app main loop.
+ */
+
+#ifndef __HOST_ECORE_H__
+#define __HOST_ECORE_H__
+
+typedef unsigned char Eina_Bool;
+
+#define EINA_FALSE				((Eina_Bool)0)
+#define EINA_TRUE				((Eina_Bool)1)
+
+#define ECORE_CALLBACK_CANCEL	EINA_FALSE
+#define ECORE_CALLBACK_RENEW	EINA_TRUE
+
+typedef struct _Ecore_Fd_Handler Ecore_Fd_Handler;
+
+typedef enum {
+	ECORE_FD_READ = 1,
+	ECORE_FD_WRITE = 2,
+	ECORE_FD_ERROR = 4,
+} Ecore_Fd_Handler_Flags;
+
+typedef Eina_Bool (*Ecore_Fd_Cb)(void *data, Ecore_Fd_Handler *fd_handler);
+
+Ecore_Fd_Handler *ecore_main_fd_handler_add(int fd, Ecore_Fd_Handler_Flags flags, Ecore_Fd_Cb func, const void *data, Ecore_Fd_Cb buf_func, const void *buf_data);
+void *ecore_main_fd_handler_del(Ecore_Fd_Handler *fd_handler);
+int ecore_main_fd_handler_fd_get(Ecore_Fd_Handler *fd_handler);
+Eina_Bool ecore_main_fd_handler_active_get(Ecore_Fd_Handler *fd_handler, Ecore_Fd_Handler_Flags flags);
+
+int ecore_init(void);
+void ecore_main_loop_begin(void);
+void ecore_main_loop_quit(void);
+
+#endif /* __HOST_ECORE_H__ */
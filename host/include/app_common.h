@@ -0,0 +1,30 @@
+/*
+ * Copyright (c) 2018 Samsung Electronics Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/*
+ * Host stand-in for the Tizen application paths
+ * HOST_DATA_PATH and HOST_RES_PATH override ./host-data/ and ../res/.
+ */
+
+#ifndef __HOST_APP_COMMON_H__
+#define __HOST_APP_COMMON_H__
+
+// the returned path ends with '/' and is freed by the caller
+char *app_get_data_path(void);
+char *app_get_resource_path(void);
+
+#endif /* __HOST_APP_COMMON_H__ */
@@ -0,0 +1,37 @@
+/*
+ * Copyright (c) 2018 Samsung Electronics Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/*
+ * Host stand-in for the Tizen app preference API
+ *
+ * Integer preferences only, kept in memory for the life of the process.
+ */
+
+#ifndef __HOST_APP_PREFERENCE_H__
+#define __HOST_APP_PREFERENCE_H__
+
+typedef enum {
+	PREFERENCE_ERROR_NONE = 0,
+	PREFERENCE_ERROR_INVALID_PARAMETER = -22,
+	PREFERENCE_ERROR_OUT_OF_MEMORY = -12,
+	PREFERENCE_ERROR_NO_KEY = -0x01100000 | 0x30,
+} preference_error_e;
+
+int preference_get_int(const char *key, int *value);
+int preference_set_int(const char *key, int value);
+
+#endif /* __HOST_APP_PREFERENCE_H__ */
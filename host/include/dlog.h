@@ -0,0 +1,43 @@
+/*
+ * Copyright (c) 2018 Samsung Electronics Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/*
+ * Host stand-in for the Tizen dlog API, messages go to stderr.
+ * HOST_LOG_LEVEL=D|I|W|E selects the lowest level printed, I by default.
+ */
+
+#ifndef __HOST_DLOG_H__
+#define __HOST_DLOG_H__
+
+#include <stdio.h>
+#include <strings.h>
+
+typedef enum {
+	DLOG_UNKNOWN = 0,
+	DLOG_DEFAULT,
+	DLOG_VERBOSE,
+	DLOG_DEBUG,
+	DLOG_INFO,
+	DLOG_WARN,
+	DLOG_ERROR,
+	DLOG_FATAL,
+	DLOG_SILENT,
+} log_priority;
+
+int dlog_print(log_priority prio, const char *tag, const char *fmt, ...) __attribute__((format(printf, 3, 4)));
+
+#endif /* __HOST_DLOG_H__ */
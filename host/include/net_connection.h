@@ -0,0 +1,44 @@
+/*
+ * Copyright (c) 2018 Samsung Electronics Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/*
+ * Host stand-in for the Tizen connection API
+ *
+ * The current profile is named by HOST_NETWORK, read on every call so a
+ * test can move between networks. Without it there is no network.
+ */
+
+#ifndef __HOST_NET_CONNECTION_H__
+#define __HOST_NET_CONNECTION_H__
+
+typedef void *connection_h;
+typedef void *connection_profile_h;
+
+typedef enum {
+	CONNECTION_ERROR_NONE = 0,
+	CONNECTION_ERROR_INVALID_PARAMETER = -22,
+	CONNECTION_ERROR_OUT_OF_MEMORY = -12,
+	CONNECTION_ERROR_NO_CONNECTION = -0x01C10000 | 0x0202,
+} connection_error_e;
+
+int connection_create(connection_h *connection);
+int connection_destroy(connection_h connection);
+int connection_get_current_profile(connection_h connection, connection_profile_h *profile);
+int connection_profile_get_name(connection_profile_h profile, char **profile_name);
+int connection_profile_destroy(connection_profile_h profile);
+
+#endif /* __HOST_NET_CONNECTION_H__ */
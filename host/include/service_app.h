@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) 2018 Samsung Electronics Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/*
+ * Host stand-in for the Tizen service application lifecycle
+ *
+ * service_app_main() calls create, runs the Ecore fd handler loop until
+ * service_app_exit(), SIGINT or SIGTERM, then calls terminate.
+ * System events are never raised on the host.
+ */
+
+#ifndef __HOST_SERVICE_APP_H__
+#define __HOST_SERVICE_APP_H__
+
+#include <stdbool.h>
+#include <app_common.h>
+
+typedef struct app_control_s *app_control_h;
+typedef struct app_event_info *app_event_info_h;
+typedef struct app_event_handler *app_event_handler_h;
+
+typedef enum {
+	APP_EVENT_LOW_MEMORY,
+	APP_EVENT_LOW_BATTERY,
+	APP_EVENT_LANGUAGE_CHANGED,
+	APP_EVENT_DEVICE_ORIENTATION_CHANGED,
+	APP_EVENT_REGION_FORMAT_CHANGED,
+	APP_EVENT_SUSPENDED_STATE_CHANGED,
+} app_event_type_e;
+
+typedef enum {
+	APP_ERROR_NONE = 0,
+	APP_ERROR_INVALID_PARAMETER = -22,
+	APP_ERROR_INVALID_CONTEXT = -0x01100000 | 0x02,
+} app_error_e;
+
+typedef void (*app_event_cb)(app_event_info_h event_info, void *user_data);
+
+typedef bool (*service_app_create_cb)(void *user_data);
+typedef void (*service_app_terminate_cb)(void *user_data);
+typedef void (*service_app_control_cb)(app_control_h app_control, void *user_data);
+
+typedef struct {
+	service_app_create_cb create;
+	service_app_terminate_cb terminate;
+	service_app_control_cb app_control;
+} service_app_lifecycle_callback_s;
+
+int service_app_main(int argc, char **argv, service_app_lifecycle_callback_s *callback, void *user_data);
+void service_app_exit(void);
+int service_app_add_event_handler(app_event_handler_h *event_handler, app_event_type_e event_type, app_event_cb callback, void *user_data);
+int service_app_remove_event_handler(app_event_handler_h event_handler);
+
+#endif /* __HOST_SERVICE_APP_H__ */
@@ -0,0 +1,232 @@
+/*
+ * Copyright (c) 2018 Samsung Electronics Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/*
+ * Timing check of the frames a remocon-host run put on a PWM
+ *
+ *   ir-timing-check [-p <chip.pin>] <expected> <io log>...
+ *
+ * Each line of <expected> is one frame as comma separated mark,space,...
+ * durations in usec ending with a mark, '#' starts a comment. The PWM
+ * edges of an HOST_IO_LOG are split into frames by the edge counts of the
+ * expected frames, the gap after a frame is not compared. A space stretched
+ * by a late wakeup then stays a long space instead of splitting a frame.
+ *
+ * The edges are timed by relative sleeps, so scheduling on a busy host only
+ * ever makes a duration longer. With several logs of the same command,
+ * every edge is compared by its shortest duration over the runs, so late
+ * wakeups do not fail the check while a wrong duration still does. An edge
+ * passes within the tolerance the IR receiver uses to decode a frame.
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+
+#define FRAME_MAX			16
+#define FRAME_EDGE_MAX		512
+#define RUN_MAX				16
+#define LINE_MAX_LEN		4096
+
+#define TOLERANCE			30		// percent, as resource_ir_receive.c
+#define TOLERANCE_MIN		100		// usec
+
+typedef struct {
+	unsigned int duration[FRAME_EDGE_MAX];
+	int len;
+} frame_t;
+
+typedef struct {
+	frame_t frames[FRAME_MAX];
+	int count;
+} frames_t;
+
+// the edges of every frame of a run, with the gap between frames
+typedef struct {
+	unsigned int duration[FRAME_MAX * (FRAME_EDGE_MAX + 1)];
+	int len;
+} run_t;
+
+static frames_t g_expected;
+static run_t g_runs[RUN_MAX];
+
+static int load_expected(const char *path, frames_t *out)
+{
+	char line[LINE_MAX_LEN];
+	char *save;
+	char *tok;
+	frame_t *frame;
+	FILE *fp;
+
+	fp = fopen(path, "r");
+	if (fp == NULL) {
+		perror(path);
+		return -1;
+	}
+
+	while (fgets(line, sizeof(line), fp) != NULL) {
+		if ((tok = strchr(line, '#')) != NULL)
+			*tok = '\0';
+
+		tok = strtok_r(line, ", \t\r\n", &save);
+		if (tok == NULL)
+			continue;
+
+		if (out->count == FRAME_MAX) {
+			fprintf(stderr, "%s: more than %d frames\n", path, FRAME_MAX);
+			fclose(fp);
+			return -1;
+		}
+
+		frame = &out->frames[out->count++];
+		for (; tok != NULL; tok = strtok_r(NULL, ", \t\r\n", &save)) {
+			if (frame->len == FRAME_EDGE_MAX) {
+				fprintf(stderr, "%s: frame longer than %d edges\n", path, FRAME_EDGE_MAX);
+				fclose(fp);
+				return -1;
+			}
+			frame->duration[frame->len++] = strtoul(tok, NULL, 10);
+		}
+	}
+
+	fclose(fp);
+
+	return 0;
+}
+
+/*
+ * Durations between the enable toggles of one PWM, from the first mark on
+ */
+static int load_run(const char *path, const char *pwm, run_t *out)
+{
+	char kind[16], name[16];
+	unsigned long long nsec, last = 0;
+	unsigned int value;
+	bool started = false;
+	FILE *fp;
+
+	fp = fopen(path, "r");
+	if (fp == NULL) {
+		perror(path);
+		return -1;
+	}
+
+	while (fscanf(fp, "%15s %15s %llu %u", kind, name, &nsec, &value) == 4) {
+		if (strcmp(kind, "pwm") != 0 || strcmp(name, pwm) != 0)
+			continue;
+
+		if (started) {
+			if (out->len == sizeof(out->duration) / sizeof(out->duration[0])) {
+				fprintf(stderr, "%s: more than %d frames\n", path, FRAME_MAX);
+				fclose(fp);
+				return -1;
+			}
+			out->duration[out->len++] = (unsigned int)((nsec - last) / 1000);
+		} else if (!value) {
+			continue;
+		}
+
+		started = true;
+		last = nsec;
+	}
+
+	fclose(fp);
+
+	return 0;
+}
+
+static unsigned int shortest(int edge, int runs)
+{
+	unsigned int value = g_runs[0].duration[edge];
+	int i;
+
+	for (i = 1; i < runs; i++) {
+		if (g_runs[i].duration[edge] < value)
+			value = g_runs[i].duration[edge];
+	}
+
+	return value;
+}
+
+static void usage(void)
+{
+	fprintf(stderr, "usage: ir-timing-check [-p <chip.pin>] <expected> <io log>...\n");
+}
+
+int main(int argc, char *argv[])
+{
+	const char *pwm = "0.2";
+	const frame_t *expected;
+	unsigned int measured, tolerance;
+	int runs, failed = 0;
+	int edges, offset;
+	int opt, i, f, e;
+
+	while ((opt = getopt(argc, argv, "p:")) != -1) {
+		if (opt == 'p') {
+			pwm = optarg;
+		} else {
+			usage();
+			return 2;
+		}
+	}
+
+	runs = argc - optind - 1;
+	if (runs < 1 || runs > RUN_MAX) {
+		usage();
+		return 2;
+	}
+
+	if (load_expected(argv[optind], &g_expected) != 0)
+		return 2;
+
+	// a gap between each two frames
+	edges = g_expected.count - 1;
+	for (f = 0; f < g_expected.count; f++)
+		edges += g_expected.frames[f].len;
+
+	for (i = 0; i < runs; i++) {
+		if (load_run(argv[optind + 1 + i], pwm, &g_runs[i]) != 0)
+			return 2;
+
+		if (g_runs[i].len != edges) {
+			printf("%s: %d edges, %d expected\n", argv[optind + 1 + i], g_runs[i].len, edges);
+			return 1;
+		}
+	}
+
+	for (f = 0, offset = 0; f < g_expected.count; offset += expected->len + 1, f++) {
+		expected = &g_expected.frames[f];
+		for (e = 0; e < expected->len; e++) {
+			measured = shortest(offset + e, runs);
+			tolerance = expected->duration[e] * TOLERANCE / 100 + TOLERANCE_MIN;
+
+			if (measured + tolerance < expected->duration[e] || measured > expected->duration[e] + tolerance) {
+				printf("frame %d %s %d: %u us, %u +- %u expected\n", f, (e % 2) ? "space" : "mark", e,
+					measured, expected->duration[e], tolerance);
+				failed++;
+			}
+		}
+	}
+
+	printf("%s: %d frames, %d edges out of tolerance over %d runs\n", argv[optind], g_expected.count, failed, runs);
+
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,235 @@
+/*
+ * Copyright (c) 2018 Samsung Electronics Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/*
+ * Check of the keepalive interval learned per network
+ *
+ * Drives the SDK over the loopback transport with the adaptive keepalive
+ * on, and mqtt_keepalive.c against the preference and connection
+ * stand-ins. Answered pings are fed to the adaptation directly, as the
+ * intervals take minutes of real time, while a lost link goes through the
+ * scripted broker.
+ *
+ *   keepalive-check
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "aws_iot_config.h"
+#include "sdk/aws_iot_mqtt_client_interface.h"
+#include "sdk/aws_iot_mqtt_client_common_internal.h"
+#include <app_preference.h>
+#include "mqtt_broker.h"
+
+#define CONNECT_KEEPALIVE		600
+
+#define CHECK(cond, fmt, args...) do { \
+		if (!(cond)) { \
+			printf("%s:%d: " fmt "\n", __func__, __LINE__, ##args); \
+			g_failed++; \
+		} \
+	} while (0)
+
+static AWS_IoT_Client client;
+static int g_failed;
+
+extern void mqtt_keepalive_reset(void);
+extern void mqtt_keepalive_load(AWS_IoT_Client *pClient);
+extern void mqtt_keepalive_save(AWS_IoT_Client *pClient);
+
+// there is no application here to trace or publish metrics for
+void mqtt_request_metrics(void)
+{
+}
+
+void mqtt_set_metrics_period(int period_sec)
+{
+}
+
+static int stored(const char *network)
+{
+	char key[64];
+	int value = 0;
+
+	snprintf(key, sizeof(key), "keepalive.%s", network);
+	if (preference_get_int(key, &value) != PREFERENCE_ERROR_NONE)
+		return 0;
+
+	return value;
+}
+
+// as set on the socket by the loopback transport
+static uint16_t tcp_idle(void)
+{
+	return client.networkStack.tlsConnectParams.keepAliveIdleSec;
+}
+
+static IoT_Error_t client_connect(bool adaptive)
+{
+	IoT_Client_Init_Params init = iotClientInitParamsDefault;
+	IoT_Client_Connect_Params conn = iotClientConnectParamsDefault;
+	IoT_Error_t rc;
+
+	init.enableAutoReconnect = true;
+	init.pHostURL = "loopback";
+	init.port = AWS_IOT_MQTT_PORT;
+	init.pRootCALocation = AWS_IOT_ROOT_CA_FILENAME;
+	init.pDeviceCertLocation = AWS_IOT_CERTIFICATE_FILENAME;
+	init.pDevicePrivateKeyLocation = AWS_IOT_PRIVATE_KEY_FILENAME;
+	init.mqttCommandTimeout_ms = 2000;
+	init.tlsHandshakeTimeout_ms = 2000;
+	init.isAdaptiveKeepAliveEnabled = adaptive;
+
+	rc = aws_iot_mqtt_init(&client, &init);
+	if (rc != SUCCESS)
+		return rc;
+
+	mqtt_keepalive_reset();
+	mqtt_keepalive_load(&client);
+
+	conn.keepAliveIntervalInSec = CONNECT_KEEPALIVE;
+	conn.isCleanSession = true;
+	conn.MQTTVersion = MQTT_3_1_1;
+	conn.pClientID = "keepalive-check";
+	conn.clientIDLen = strlen(conn.pClientID);
+
+	return aws_iot_mqtt_connect(&client, &conn);
+}
+
+// the adaptation as the answered PINGREQs of one interval step
+static void answer_pings(void)
+{
+	int i;
+
+	for (i = 0; i < AWS_IOT_MQTT_KEEPALIVE_STABLE_PINGS; i++)
+		aws_iot_mqtt_internal_adapt_keep_alive(&client, false);
+}
+
+static void lose_link(void)
+{
+	IoT_Error_t rc;
+	int i;
+
+	broker_drop();
+	rc = aws_iot_mqtt_yield(&client, 10);
+	CHECK(rc == NETWORK_ATTEMPTING_RECONNECT, "yield after a drop returned %d", rc);
+
+	// the first reconnect waits AWS_IOT_MQTT_MIN_RECONNECT_WAIT_INTERVAL
+	for (i = 0; i < 50 && !aws_iot_mqtt_is_client_connected(&client); i++) {
+		usleep(100 * 1000);
+		rc = aws_iot_mqtt_yield(&client, 10);
+	}
+	CHECK(aws_iot_mqtt_is_client_connected(&client), "no reconnect, yield returned %d", rc);
+}
+
+static void check_learn(void)
+{
+	uint16_t learned, lost;
+
+	setenv("HOST_NETWORK", "home", 1);
+	CHECK(client_connect(true) == SUCCESS, "connect failed");
+	CHECK(aws_iot_mqtt_get_keepalive_interval(&client) == AWS_IOT_MQTT_MIN_KEEPALIVE_INTERVAL,
+		"new network starts at %u s", aws_iot_mqtt_get_keepalive_interval(&client));
+	// TCP keepalive probes would refresh the NAT mapping the adaptation is probing for
+	CHECK(tcp_idle() == 0,
+		"TCP keepalive idle %u s while probing", tcp_idle());
+
+	answer_pings();
+	answer_pings();
+	learned = aws_iot_mqtt_get_keepalive_interval(&client);
+	CHECK(learned > AWS_IOT_MQTT_MIN_KEEPALIVE_INTERVAL, "interval did not grow, %u s", learned);
+	mqtt_keepalive_save(&client);
+	CHECK(stored("home") == learned, "stored %d s, learned %u s", stored("home"), learned);
+
+	// a lost idle link cuts the interval, it is not tried again for a while
+	lose_link();
+	lost = aws_iot_mqtt_get_keepalive_interval(&client);
+	CHECK(lost < learned, "interval %u s after losing the link at %u s", lost, learned);
+	answer_pings();
+	CHECK(aws_iot_mqtt_get_keepalive_interval(&client) < learned, "interval %u s back at the lost one %u s",
+		aws_iot_mqtt_get_keepalive_interval(&client), learned);
+	mqtt_keepalive_save(&client);
+	CHECK(stored("home") == aws_iot_mqtt_get_keepalive_interval(&client), "stored %d s, interval %u s",
+		stored("home"), aws_iot_mqtt_get_keepalive_interval(&client));
+	CHECK(tcp_idle() == 0, "TCP keepalive idle %u s while probing", tcp_idle());
+
+	// settled just below the lost interval, TCP keepalive finds an idle dead link before the next ping
+	answer_pings();
+	CHECK(aws_iot_mqtt_get_keepalive_interval(&client) == learned - 1, "interval %u s, lost at %u s",
+		aws_iot_mqtt_get_keepalive_interval(&client), learned);
+	CHECK(tcp_idle() == AWS_IOT_TCP_KEEPALIVE_IDLE, "TCP keepalive idle %u s once settled", tcp_idle());
+	mqtt_keepalive_save(&client);
+}
+
+static void check_networks(void)
+{
+	int home = stored("home");
+
+	// another network starts over, the interval of the first one is kept
+	setenv("HOST_NETWORK", "office", 1);
+	lose_link();
+	mqtt_keepalive_load(&client);
+	CHECK(aws_iot_mqtt_get_keepalive_interval(&client) == AWS_IOT_MQTT_MIN_KEEPALIVE_INTERVAL,
+		"office starts at %u s", aws_iot_mqtt_get_keepalive_interval(&client));
+	answer_pings();
+	mqtt_keepalive_save(&client);
+	CHECK(stored("office") > AWS_IOT_MQTT_MIN_KEEPALIVE_INTERVAL, "office stored %d s", stored("office"));
+	CHECK(stored("home") == home, "home changed from %d s to %d s", home, stored("home"));
+
+	// back home, the interval learned there is picked up again
+	setenv("HOST_NETWORK", "home", 1);
+	lose_link();
+	mqtt_keepalive_load(&client);
+	CHECK(aws_iot_mqtt_get_keepalive_interval(&client) == home, "home restarts at %u s, %d s stored",
+		aws_iot_mqtt_get_keepalive_interval(&client), home);
+
+	// a failed network lookup keeps the network the interval belongs to
+	unsetenv("HOST_NETWORK");
+	answer_pings();
+	mqtt_keepalive_load(&client);
+	mqtt_keepalive_save(&client);
+	CHECK(stored("home") == aws_iot_mqtt_get_keepalive_interval(&client), "home stored %d s, interval %u s",
+		stored("home"), aws_iot_mqtt_get_keepalive_interval(&client));
+
+	aws_iot_mqtt_disconnect(&client);
+}
+
+static void check_fixed(void)
+{
+	setenv("HOST_NETWORK", "home", 1);
+	CHECK(client_connect(false) == SUCCESS, "connect failed");
+	CHECK(aws_iot_mqtt_get_keepalive_interval(&client) == CONNECT_KEEPALIVE,
+		"fixed keepalive pings every %u s", aws_iot_mqtt_get_keepalive_interval(&client));
+	// an idle dead link is found well before the next ping
+	CHECK(tcp_idle() == AWS_IOT_TCP_KEEPALIVE_IDLE, "TCP keepalive idle %u s", tcp_idle());
+
+	aws_iot_mqtt_disconnect(&client);
+}
+
+int main(int argc, char *argv[])
+{
+	check_learn();
+	check_networks();
+	check_fixed();
+
+	printf("keepalive: %d checks failed\n", g_failed);
+
+	return g_failed ? 1 : 0;
+}
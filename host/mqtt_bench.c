@@ -0,0 +1,443 @@
+/*
+ * Copyright (c) 2018 Samsung Electronics Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/*
+ * MQTT client throughput over the loopback transport
+ *
+ * Drives the SDK against the scripted broker with no network in between and
+ * reports, per code path, messages per second, process CPU time per message
+ * and heap allocations per message made by the SDK and the transport.
+ *
+ *   mqtt-bench [-n count] [scenario...]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "aws_iot_config.h"
+#include "sdk/aws_iot_mqtt_client_interface.h"
+#include "sdk/aws_iot_mqtt_client_common_internal.h"
+#include "mqtt_broker.h"
+
+#define BENCH_DEFAULT_COUNT		100000
+#define BENCH_BATCH				1000	// publishes queued by the broker before the client yields
+#define BENCH_PAYLOAD			"{\"cmd\":\"TV_KEY_VOLUMEUP\",\"n\":1}"
+#define BENCH_TOPIC				"tizen/sub"
+#define BENCH_PINGS				2
+
+typedef struct {
+	const char *name;
+	unsigned long (*run)(unsigned long count);
+} bench_t;
+
+static AWS_IoT_Client client;
+static unsigned long g_received;
+static unsigned long g_allocs;
+static pDispatchHandler_t g_dispatch;
+
+extern int mqtt_dispatch_init(void);
+extern void mqtt_dispatch_close(void);
+extern IoT_Error_t mqtt_dispatch(AWS_IoT_Client *pClient, pApplicationHandler_t pApplicationHandler,
+		void *pApplicationHandlerData, char *pTopicName, uint16_t topicNameLen,
+		IoT_Publish_Message_Params *pParams, void *pDispatchHandlerData);
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t nmemb, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+
+// linked with --wrap, so only calls from the SDK and this tool are counted
+void *__wrap_malloc(size_t size)
+{
+	__atomic_add_fetch(&g_allocs, 1, __ATOMIC_RELAXED);
+	return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t nmemb, size_t size)
+{
+	__atomic_add_fetch(&g_allocs, 1, __ATOMIC_RELAXED);
+	return __real_calloc(nmemb, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size)
+{
+	__atomic_add_fetch(&g_allocs, 1, __ATOMIC_RELAXED);
+	return __real_realloc(ptr, size);
+}
+
+// there is no application here to trace or publish metrics for
+void mqtt_request_metrics(void)
+{
+}
+
+void mqtt_set_metrics_period(int period_sec)
+{
+}
+
+static uint64_t clock_ns(clockid_t id)
+{
+	struct timespec ts;
+
+	clock_gettime(id, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static void bench_callback(AWS_IoT_Client *pClient, char *topicName, uint16_t topicNameLen,
+						   IoT_Publish_Message_Params *params, void *pData)
+{
+	// runs on a dispatch worker in the dispatch scenario
+	__atomic_add_fetch(&g_received, 1, __ATOMIC_RELAXED);
+}
+
+static int bench_connect(uint16_t keepalive)
+{
+	IoT_Client_Init_Params init = iotClientInitParamsDefault;
+	IoT_Client_Connect_Params conn = iotClientConnectParamsDefault;
+	IoT_Error_t rc;
+
+	init.enableAutoReconnect = false;
+	init.pHostURL = "loopback";
+	init.port = AWS_IOT_MQTT_PORT;
+	// checked by the SDK, never opened by the loopback transport
+	init.pRootCALocation = AWS_IOT_ROOT_CA_FILENAME;
+	init.pDeviceCertLocation = AWS_IOT_CERTIFICATE_FILENAME;
+	init.pDevicePrivateKeyLocation = AWS_IOT_PRIVATE_KEY_FILENAME;
+	init.mqttCommandTimeout_ms = 20000;
+	init.tlsHandshakeTimeout_ms = 5000;
+	init.dispatchHandler = g_dispatch;
+
+	rc = aws_iot_mqtt_init(&client, &init);
+	if (rc != SUCCESS)
+		return rc;
+
+	conn.keepAliveIntervalInSec = keepalive;
+	conn.isCleanSession = true;
+	conn.MQTTVersion = MQTT_3_1_1;
+	conn.pClientID = AWS_IOT_MQTT_CLIENT_ID;
+	conn.clientIDLen = (uint16_t)strlen(AWS_IOT_MQTT_CLIENT_ID);
+
+	return aws_iot_mqtt_connect(&client, &conn);
+}
+
+static void bench_disconnect(void)
+{
+	aws_iot_mqtt_disconnect(&client);
+	aws_iot_mqtt_free(&client);
+}
+
+static int bench_subscribe(const char *topic, QoS qos)
+{
+	return aws_iot_mqtt_subscribe(&client, topic, strlen(topic), qos, bench_callback, NULL);
+}
+
+static int bench_publish(const char *topic, QoS qos)
+{
+	IoT_Publish_Message_Params params = { 0 };
+
+	params.qos = qos;
+	params.payload = (void *)BENCH_PAYLOAD;
+	params.payloadLen = sizeof(BENCH_PAYLOAD) - 1;
+
+	return aws_iot_mqtt_publish(&client, topic, strlen(topic), &params);
+}
+
+// yield until every queued publish reached the callback
+static int bench_drain(unsigned long target)
+{
+	IoT_Error_t rc = SUCCESS;
+
+	while (__atomic_load_n(&g_received, __ATOMIC_RELAXED) < target && rc == SUCCESS)
+		rc = aws_iot_mqtt_yield(&client, 1);
+
+	return rc;
+}
+
+static unsigned long bench_connect_cycle(unsigned long count)
+{
+	unsigned long i;
+
+	for (i = 0; i < count; i++) {
+		if (bench_connect(0) != SUCCESS)
+			break;
+		bench_disconnect();
+	}
+
+	return i;
+}
+
+static unsigned long bench_subscribe_cycle(unsigned long count)
+{
+	unsigned long i;
+
+	if (bench_connect(0) != SUCCESS)
+		return 0;
+
+	for (i = 0; i < count; i++) {
+		if (bench_subscribe(BENCH_TOPIC, QOS0) != SUCCESS)
+			break;
+		if (aws_iot_mqtt_unsubscribe(&client, BENCH_TOPIC, strlen(BENCH_TOPIC)) != SUCCESS)
+			break;
+	}
+
+	bench_disconnect();
+
+	return i;
+}
+
+static unsigned long bench_publish_qos(unsigned long count, QoS qos)
+{
+	unsigned long i;
+
+	if (bench_connect(0) != SUCCESS)
+		return 0;
+
+	// nobody subscribes, so nothing comes back but the PUBACK
+	for (i = 0; i < count; i++) {
+		if (bench_publish("tizen/pub", qos) != SUCCESS)
+			break;
+	}
+
+	bench_disconnect();
+
+	return i;
+}
+
+static unsigned long bench_publish_qos0(unsigned long count)
+{
+	return bench_publish_qos(count, QOS0);
+}
+
+static unsigned long bench_publish_qos1(unsigned long count)
+{
+	return bench_publish_qos(count, QOS1);
+}
+
+static unsigned long bench_receive_qos(unsigned long count, int qos)
+{
+	unsigned long i = 0, n;
+
+	if (bench_connect(0) != SUCCESS || bench_subscribe(BENCH_TOPIC, (QoS)qos) != SUCCESS)
+		return 0;
+
+	g_received = 0;
+	while (i < count) {
+		for (n = 0; n < BENCH_BATCH && i < count; n++, i++) {
+			if (broker_publish(BENCH_TOPIC, BENCH_PAYLOAD, sizeof(BENCH_PAYLOAD) - 1, qos) != 0)
+				break;
+		}
+		if (bench_drain(i) != SUCCESS)
+			break;
+	}
+
+	bench_disconnect();
+
+	return g_received;
+}
+
+static unsigned long bench_receive_qos0(unsigned long count)
+{
+	return bench_receive_qos(count, 0);
+}
+
+static unsigned long bench_receive_qos1(unsigned long count)
+{
+	return bench_receive_qos(count, 1);
+}
+
+// QoS1 receive with the callbacks handed to the dispatch workers
+static unsigned long bench_receive_dispatch(unsigned long count)
+{
+	unsigned long received;
+
+	if (mqtt_dispatch_init() != 0)
+		return 0;
+
+	g_dispatch = mqtt_dispatch;
+	received = bench_receive_qos(count, 1);
+	g_dispatch = NULL;
+
+	mqtt_dispatch_close();
+
+	return received;
+}
+
+// publish and get it back through the subscription, as the device does
+static unsigned long bench_echo(unsigned long count)
+{
+	unsigned long i = 0, n;
+
+	if (bench_connect(0) != SUCCESS || bench_subscribe(BENCH_TOPIC, QOS0) != SUCCESS)
+		return 0;
+
+	g_received = 0;
+	while (i < count) {
+		for (n = 0; n < BENCH_BATCH && i < count; n++, i++) {
+			if (bench_publish(BENCH_TOPIC, QOS0) != SUCCESS)
+				break;
+		}
+		if (bench_drain(i) != SUCCESS)
+			break;
+	}
+
+	bench_disconnect();
+
+	return g_received;
+}
+
+// idle yields until the keepalive timer has sent a few PINGREQs, real time
+static unsigned long bench_keepalive(unsigned long count)
+{
+	broker_stats_t stats;
+
+	if (bench_connect(1) != SUCCESS)
+		return 0;
+
+	do {
+		if (aws_iot_mqtt_yield(&client, 100) != SUCCESS)
+			break;
+		broker_stats(&stats);
+	} while (stats.packets_out[PINGRESP] < BENCH_PINGS);
+
+	bench_disconnect();
+
+	return stats.packets_out[PINGRESP];
+}
+
+// a dropped link noticed by yield, then a manual reconnect and resubscribe
+static unsigned long bench_reconnect(unsigned long count)
+{
+	static const char *topics[] = { "tizen/sub", "tizen/a", "tizen/b", "tizen/c" };
+	unsigned long i;
+	size_t t;
+
+	if (bench_connect(0) != SUCCESS)
+		return 0;
+
+	for (t = 0; t < sizeof(topics) / sizeof(topics[0]); t++) {
+		if (bench_subscribe(topics[t], QOS0) != SUCCESS)
+			return 0;
+	}
+
+	count /= 10;
+	for (i = 0; i < count; i++) {
+		broker_drop();
+		if (aws_iot_mqtt_yield(&client, 1) != NETWORK_DISCONNECTED_ERROR)
+			break;
+		if (aws_iot_mqtt_attempt_reconnect(&client) != NETWORK_RECONNECTED)
+			break;
+	}
+
+	bench_disconnect();
+
+	return i;
+}
+
+static const bench_t g_benches[] = {
+	{ "connect", bench_connect_cycle },
+	{ "subscribe", bench_subscribe_cycle },
+	{ "publish_qos0", bench_publish_qos0 },
+	{ "publish_qos1", bench_publish_qos1 },
+	{ "receive_qos0", bench_receive_qos0 },
+	{ "receive_qos1", bench_receive_qos1 },
+	{ "receive_dispatch", bench_receive_dispatch },
+	{ "echo", bench_echo },
+	{ "keepalive", bench_keepalive },
+	{ "reconnect", bench_reconnect },
+};
+
+#define BENCH_NUM	(sizeof(g_benches) / sizeof(g_benches[0]))
+
+static void bench_run(const bench_t *b, unsigned long count)
+{
+	uint64_t wall, cpu;
+	unsigned long msgs, allocs;
+	broker_stats_t stats;
+
+	broker_reset(NULL);
+
+	allocs = __atomic_load_n(&g_allocs, __ATOMIC_RELAXED);
+	wall = clock_ns(CLOCK_MONOTONIC);
+	cpu = clock_ns(CLOCK_PROCESS_CPUTIME_ID);
+
+	msgs = b->run(count);
+
+	cpu = clock_ns(CLOCK_PROCESS_CPUTIME_ID) - cpu;
+	wall = clock_ns(CLOCK_MONOTONIC) - wall;
+	allocs = __atomic_load_n(&g_allocs, __ATOMIC_RELAXED) - allocs;
+	broker_stats(&stats);
+
+	if (msgs == 0) {
+		printf("%-14s failed\n", b->name);
+		return;
+	}
+
+	printf("%-14s %10lu %12.0f %12.0f %10.3f %12llu %12llu\n", b->name, msgs,
+		   msgs * 1e9 / wall, (double)cpu / msgs, (double)allocs / msgs,
+		   stats.bytes_in, stats.bytes_out);
+}
+
+static void usage(void)
+{
+	size_t i;
+
+	fprintf(stderr, "usage: mqtt-bench [-n count] [scenario...]\nscenarios:");
+	for (i = 0; i < BENCH_NUM; i++)
+		fprintf(stderr, " %s", g_benches[i].name);
+	fprintf(stderr, "\n");
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned long count = BENCH_DEFAULT_COUNT;
+	size_t i;
+	int opt, a;
+
+	// the SDK logs every connect at info level
+	setenv("HOST_LOG_LEVEL", "W", 0);
+
+	while ((opt = getopt(argc, argv, "n:h")) != -1) {
+		switch (opt) {
+		case 'n':
+			count = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			usage();
+			return 1;
+		}
+	}
+
+	printf("%-14s %10s %12s %12s %10s %12s %12s\n", "scenario", "msgs", "msgs/s",
+		   "cpu_ns/msg", "allocs/msg", "bytes_in", "bytes_out");
+
+	for (i = 0; i < BENCH_NUM; i++) {
+		if (optind < argc) {
+			for (a = optind; a < argc; a++) {
+				if (!strcmp(argv[a], g_benches[i].name))
+					break;
+			}
+			if (a == argc)
+				continue;
+		}
+		bench_run(&g_benches[i], count);
+		fflush(stdout);
+	}
+
+	return 0;
+}
@@ -0,0 +1,590 @@
+/*
+ * Copyright (c) 2018 Samsung Electronics Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "mqtt_broker.h"
+
+#define BROKER_BUF_SIZE		(64 * 1024)
+#define BROKER_SUB_MAX		16
+#define BROKER_TOPIC_MAX	128
+#define BROKER_LAST_MAX		4096
+
+enum {
+	PKT_CONNECT = 1,
+	PKT_CONNACK,
+	PKT_PUBLISH,
+	PKT_PUBACK,
+	PKT_PUBREC,
+	PKT_PUBREL,
+	PKT_PUBCOMP,
+	PKT_SUBSCRIBE,
+	PKT_SUBACK,
+	PKT_UNSUBSCRIBE,
+	PKT_UNSUBACK,
+	PKT_PINGREQ,
+	PKT_PINGRESP,
+	PKT_DISCONNECT,
+};
+
+typedef struct {
+	char filter[BROKER_TOPIC_MAX];
+	int qos;
+} broker_sub_t;
+
+static const broker_script_t g_default_script = {
+	.connack_rc = 0,
+	.session_present = false,
+	.granted_qos = BROKER_QOS_AS_REQUESTED,
+	.puback = true,
+	.pingresp = true,
+	.echo = true,
+	.drop_after = 0,
+};
+
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_cond;
+static pthread_once_t g_once = PTHREAD_ONCE_INIT;
+
+static broker_script_t g_script;
+static broker_stats_t g_stats;
+static bool g_connected;
+static unsigned int g_client_packets;	// since the connection was accepted
+static uint16_t g_packet_id;
+
+static broker_sub_t g_subs[BROKER_SUB_MAX];
+static int g_sub_count;
+
+// last QoS1 publish to the client, for a redelivery
+static unsigned char g_last[BROKER_LAST_MAX];
+static size_t g_last_len;
+
+// client to broker, partial packets wait here for the rest
+static unsigned char g_in[BROKER_BUF_SIZE];
+static size_t g_in_len;
+
+// broker to client
+static unsigned char g_out[BROKER_BUF_SIZE];
+static size_t g_out_head;
+static size_t g_out_len;
+
+static void broker_once(void)
+{
+	pthread_condattr_t attr;
+
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_cond_init(&g_cond, &attr);
+	pthread_condattr_destroy(&attr);
+
+	g_script = g_default_script;
+}
+
+static void broker_disconnect_locked(void)
+{
+	g_connected = false;
+	g_in_len = 0;
+	pthread_cond_broadcast(&g_cond);
+}
+
+static unsigned char *broker_out_reserve(size_t len)
+{
+	unsigned char *p;
+
+	if (g_out_head + g_out_len + len > BROKER_BUF_SIZE) {
+		memmove(g_out, g_out + g_out_head, g_out_len);
+		g_out_head = 0;
+		if (g_out_len + len > BROKER_BUF_SIZE)
+			return NULL;
+	}
+
+	p = g_out + g_out_head + g_out_len;
+	g_out_len += len;
+
+	return p;
+}
+
+static void broker_out_commit(const unsigned char *pkt, size_t len)
+{
+	g_stats.packets_out[pkt[0] >> 4]++;
+	g_stats.bytes_out += len;
+	pthread_cond_broadcast(&g_cond);
+}
+
+static int broker_out_locked(const unsigned char *buf, size_t len)
+{
+	unsigned char *p = broker_out_reserve(len);
+
+	if (!p)
+		return -1;
+
+	memcpy(p, buf, len);
+	broker_out_commit(p, len);
+
+	return 0;
+}
+
+static size_t broker_encode_len(unsigned char *p, size_t len)
+{
+	size_t n = 0;
+
+	do {
+		unsigned char byte = len % 128;
+
+		len /= 128;
+		if (len > 0)
+			byte |= 0x80;
+		p[n++] = byte;
+	} while (len > 0);
+
+	return n;
+}
+
+static int broker_send_ack(int type, int flags, uint16_t id)
+{
+	unsigned char pkt[4] = { (unsigned char)(type << 4 | flags), 2, id >> 8, id & 0xFF };
+
+	return broker_out_locked(pkt, sizeof(pkt));
+}
+
+static int broker_publish_locked(const char *topic, size_t topic_len, const void *payload, size_t len, int qos)
+{
+	unsigned char hdr[5];
+	size_t rem = 2 + topic_len + (qos > 0 ? 2 : 0) + len;
+	size_t hdr_len = 1 + broker_encode_len(hdr + 1, rem);
+	unsigned char *p = broker_out_reserve(hdr_len + rem);
+	unsigned char *pkt = p;
+
+	if (!p)
+		return -1;
+
+	hdr[0] = PKT_PUBLISH << 4 | (qos & 3) << 1;
+	memcpy(p, hdr, hdr_len);
+	p += hdr_len;
+	*p++ = topic_len >> 8;
+	*p++ = topic_len & 0xFF;
+	memcpy(p, topic, topic_len);
+	p += topic_len;
+	if (qos > 0) {
+		if (++g_packet_id == 0)
+			g_packet_id = 1;
+		*p++ = g_packet_id >> 8;
+		*p++ = g_packet_id & 0xFF;
+	}
+	memcpy(p, payload, len);
+
+	if (qos > 0) {
+		g_last_len = hdr_len + rem <= sizeof(g_last) ? hdr_len + rem : 0;
+		memcpy(g_last, pkt, g_last_len);
+	}
+
+	broker_out_commit(pkt, hdr_len + rem);
+
+	return 0;
+}
+
+// MQTT topic filter match with '+' and '#' wildcards
+static bool broker_topic_match(const char *filter, const char *topic, size_t topic_len)
+{
+	const char *end = topic + topic_len;
+
+	while (*filter) {
+		if (*filter == '#')
+			return true;
+
+		if (*filter == '+') {
+			while (topic < end && *topic != '/')
+				topic++;
+			filter++;
+			continue;
+		}
+
+		if (topic >= end || *filter != *topic)
+			return false;
+		filter++;
+		topic++;
+	}
+
+	return topic == end;
+}
+
+static uint16_t get_u16(const unsigned char *p)
+{
+	return (uint16_t)(p[0] << 8 | p[1]);
+}
+
+static void broker_handle_connect(const unsigned char *body, size_t len)
+{
+	unsigned char connack[4] = { PKT_CONNACK << 4, 2, 0, g_script.connack_rc };
+	size_t name_len;
+	bool clean = true;
+
+	// protocol name, level, flags
+	if (len >= 2) {
+		name_len = get_u16(body);
+		if (len >= 2 + name_len + 2)
+			clean = (body[2 + name_len + 1] & 0x02) != 0;
+	}
+
+	if (clean)
+		g_sub_count = 0;
+	else if (g_script.session_present)
+		connack[2] = 1;
+
+	broker_out_locked(connack, sizeof(connack));
+
+	if (g_script.connack_rc != 0)
+		broker_disconnect_locked();
+}
+
+static void broker_handle_publish(int flags, const unsigned char *body, size_t len)
+{
+	int qos = (flags >> 1) & 3;
+	size_t topic_len, off;
+	uint16_t id = 0;
+	int i;
+
+	if (len < 2)
+		return;
+
+	topic_len = get_u16(body);
+	off = 2 + topic_len;
+	if (qos > 0) {
+		if (len < off + 2)
+			return;
+		id = get_u16(body + off);
+		off += 2;
+	}
+	if (off > len)
+		return;
+
+	if (qos == 1 && g_script.puback)
+		broker_send_ack(PKT_PUBACK, 0, id);
+
+	if (!g_script.echo)
+		return;
+
+	for (i = 0; i < g_sub_count; i++) {
+		if (broker_topic_match(g_subs[i].filter, (const char *)body + 2, topic_len)) {
+			int out_qos = qos < g_subs[i].qos ? qos : g_subs[i].qos;
+
+			broker_publish_locked((const char *)body + 2, topic_len, body + off, len - off, out_qos);
+			break;
+		}
+	}
+}
+
+static void broker_handle_subscribe(const unsigned char *body, size_t len)
+{
+	unsigned char suback[4 + BROKER_SUB_MAX] = { PKT_SUBACK << 4, 0 };
+	size_t off = 2, n = 4;
+	int i;
+
+	if (len < 2)
+		return;
+
+	suback[2] = body[0];
+	suback[3] = body[1];
+
+	while (off + 3 <= len && n < sizeof(suback)) {
+		size_t flen = get_u16(body + off);
+		int qos, granted;
+
+		if (off + 2 + flen + 1 > len)
+			break;
+
+		qos = body[off + 2 + flen] & 3;
+		granted = g_script.granted_qos == BROKER_QOS_AS_REQUESTED ? qos : g_script.granted_qos;
+		// a filter too long for the table is refused, not dropped from the SUBACK
+		if (flen >= BROKER_TOPIC_MAX)
+			granted = 0x80;
+
+		if (granted != 0x80) {
+			for (i = 0; i < g_sub_count; i++) {
+				if (strlen(g_subs[i].filter) == flen && !memcmp(g_subs[i].filter, body + off + 2, flen))
+					break;
+			}
+			if (i == g_sub_count && g_sub_count < BROKER_SUB_MAX)
+				g_sub_count++;
+			if (i < g_sub_count) {
+				memcpy(g_subs[i].filter, body + off + 2, flen);
+				g_subs[i].filter[flen] = '\0';
+				g_subs[i].qos = granted;
+			}
+		}
+
+		suback[n++] = granted;
+		off += 2 + flen + 1;
+	}
+
+	suback[1] = n - 2;
+	broker_out_locked(suback, n);
+}
+
+static void broker_handle_unsubscribe(const unsigned char *body, size_t len)
+{
+	size_t off = 2;
+	int i;
+
+	if (len < 2)
+		return;
+
+	while (off + 2 <= len) {
+		size_t flen = get_u16(body + off);
+
+		if (off + 2 + flen > len)
+			break;
+
+		for (i = 0; i < g_sub_count; i++) {
+			if (strlen(g_subs[i].filter) == flen && !memcmp(g_subs[i].filter, body + off + 2, flen)) {
+				g_subs[i] = g_subs[--g_sub_count];
+				break;
+			}
+		}
+		off += 2 + flen;
+	}
+
+	broker_send_ack(PKT_UNSUBACK, 0, get_u16(body));
+}
+
+static void broker_handle_packet(unsigned char header, const unsigned char *body, size_t len)
+{
+	int type = header >> 4;
+
+	g_stats.packets_in[type]++;
+
+	switch (type) {
+	case PKT_CONNECT:
+		broker_handle_connect(body, len);
+		break;
+	case PKT_PUBLISH:
+		broker_handle_publish(header & 0x0F, body, len);
+		break;
+	case PKT_SUBSCRIBE:
+		broker_handle_subscribe(body, len);
+		break;
+	case PKT_UNSUBSCRIBE:
+		broker_handle_unsubscribe(body, len);
+		break;
+	case PKT_PINGREQ:
+		if (g_script.pingresp) {
+			unsigned char pingresp[2] = { PKT_PINGRESP << 4, 0 };
+
+			broker_out_locked(pingresp, sizeof(pingresp));
+		}
+		break;
+	case PKT_DISCONNECT:
+		broker_disconnect_locked();
+		break;
+	default:
+		// PUBACK and the QoS2 flow need no answer
+		break;
+	}
+
+	if (g_connected && g_script.drop_after && ++g_client_packets >= g_script.drop_after) {
+		g_stats.drops++;
+		broker_disconnect_locked();
+	}
+}
+
+void broker_reset(const broker_script_t *script)
+{
+	pthread_once(&g_once, broker_once);
+
+	pthread_mutex_lock(&g_lock);
+	g_script = script ? *script : g_default_script;
+	memset(&g_stats, 0, sizeof(g_stats));
+	g_sub_count = 0;
+	g_last_len = 0;
+	g_out_head = 0;
+	g_out_len = 0;
+	g_in_len = 0;
+	g_connected = false;
+	pthread_mutex_unlock(&g_lock);
+}
+
+void broker_script(broker_script_t *script)
+{
+	pthread_once(&g_once, broker_once);
+
+	pthread_mutex_lock(&g_lock);
+	*script = g_script;
+	pthread_mutex_unlock(&g_lock);
+}
+
+void broker_stats(broker_stats_t *stats)
+{
+	pthread_mutex_lock(&g_lock);
+	*stats = g_stats;
+	pthread_mutex_unlock(&g_lock);
+}
+
+int broker_publish(const char *topic, const void *payload, size_t len, int qos)
+{
+	int ret;
+
+	pthread_mutex_lock(&g_lock);
+	ret = g_connected ? broker_publish_locked(topic, strlen(topic), payload, len, qos) : -1;
+	pthread_mutex_unlock(&g_lock);
+
+	return ret;
+}
+
+int broker_redeliver(void)
+{
+	int ret = -1;
+
+	pthread_mutex_lock(&g_lock);
+	if (g_connected && g_last_len > 0) {
+		g_last[0] |= 0x08;	// DUP
+		ret = broker_out_locked(g_last, g_last_len);
+	}
+	pthread_mutex_unlock(&g_lock);
+
+	return ret;
+}
+
+void broker_drop(void)
+{
+	pthread_mutex_lock(&g_lock);
+	if (g_connected) {
+		g_stats.drops++;
+		broker_disconnect_locked();
+	}
+	pthread_mutex_unlock(&g_lock);
+}
+
+int broker_accept(void)
+{
+	pthread_once(&g_once, broker_once);
+
+	pthread_mutex_lock(&g_lock);
+	g_connected = true;
+	g_client_packets = 0;
+	g_in_len = 0;
+	g_out_head = 0;
+	g_out_len = 0;
+	g_stats.connects++;
+	pthread_mutex_unlock(&g_lock);
+
+	return 0;
+}
+
+void broker_close(void)
+{
+	pthread_mutex_lock(&g_lock);
+	broker_disconnect_locked();
+	pthread_mutex_unlock(&g_lock);
+}
+
+bool broker_is_connected(void)
+{
+	bool connected;
+
+	pthread_mutex_lock(&g_lock);
+	connected = g_connected;
+	pthread_mutex_unlock(&g_lock);
+
+	return connected;
+}
+
+int broker_write(const unsigned char *buf, size_t len)
+{
+	size_t off = 0;
+
+	pthread_mutex_lock(&g_lock);
+	if (!g_connected || g_in_len + len > BROKER_BUF_SIZE) {
+		pthread_mutex_unlock(&g_lock);
+		return -1;
+	}
+
+	memcpy(g_in + g_in_len, buf, len);
+	g_in_len += len;
+	g_stats.bytes_in += len;
+
+	// handle every complete packet, keep a partial one for the next write
+	while (g_connected && off + 2 <= g_in_len) {
+		size_t rem = 0, hdr = 1;
+		unsigned int shift = 0;
+
+		do {
+			if (off + hdr >= g_in_len)
+				goto partial;
+			rem |= (size_t)(g_in[off + hdr] & 0x7F) << shift;
+			shift += 7;
+		} while (g_in[off + hdr++] & 0x80);
+
+		if (off + hdr + rem > g_in_len)
+			break;
+
+		broker_handle_packet(g_in[off], g_in + off + hdr, rem);
+		off += hdr + rem;
+	}
+
+partial:
+	if (g_connected) {
+		memmove(g_in, g_in + off, g_in_len - off);
+		g_in_len -= off;
+	}
+	pthread_mutex_unlock(&g_lock);
+
+	return len;
+}
+
+int broker_read(unsigned char *buf, size_t len, uint32_t timeout_ms)
+{
+	struct timespec deadline;
+	size_t n;
+
+	pthread_mutex_lock(&g_lock);
+
+	if (g_out_len == 0 && g_connected && timeout_ms > 0) {
+		clock_gettime(CLOCK_MONOTONIC, &deadline);
+		deadline.tv_sec += timeout_ms / 1000;
+		deadline.tv_nsec += (timeout_ms % 1000) * 1000000L;
+		if (deadline.tv_nsec >= 1000000000L) {
+			deadline.tv_sec++;
+			deadline.tv_nsec -= 1000000000L;
+		}
+
+		while (g_out_len == 0 && g_connected) {
+			if (pthread_cond_timedwait(&g_cond, &g_lock, &deadline) == ETIMEDOUT)
+				break;
+		}
+	}
+
+	if (g_out_len == 0) {
+		pthread_mutex_unlock(&g_lock);
+		return g_connected ? 0 : -1;
+	}
+
+	n = len < g_out_len ? len : g_out_len;
+	memcpy(buf, g_out + g_out_head, n);
+	g_out_head += n;
+	g_out_len -= n;
+	if (g_out_len == 0)
+		g_out_head = 0;
+
+	pthread_mutex_unlock(&g_lock);
+
+	return n;
+}
@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) 2018 Samsung Electronics Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/*
+ * Scripted in-process MQTT 3.1.1 broker
+ *
+ * The loopback transport hands every byte the client writes to the broker,
+ * which answers synchronously into a buffer the client reads from. The
+ * script decides how the broker answers, so error paths can be driven as
+ * deterministically as the happy path.
+ */
+
+#ifndef __HOST_MQTT_BROKER_H__
+#define __HOST_MQTT_BROKER_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define BROKER_PACKET_TYPES		16
+#define BROKER_QOS_AS_REQUESTED	-1
+
+typedef struct {
+	uint8_t connack_rc;			// CONNACK return code, non zero refuses the connection
+	bool session_present;		// reported in CONNACK when the session is not clean
+	int granted_qos;			// SUBACK return code, BROKER_QOS_AS_REQUESTED or 0, 1, 0x80
+	bool puback;				// acknowledge QoS1 publishes
+	bool pingresp;				// answer PINGREQ
+	bool echo;					// deliver client publishes to matching subscriptions
+	unsigned int drop_after;	// drop the connection after this many client packets, 0 never
+} broker_script_t;
+
+typedef struct {
+	unsigned long packets_in[BROKER_PACKET_TYPES];	// by MQTT packet type, client to broker
+	unsigned long packets_out[BROKER_PACKET_TYPES];	// broker to client
+	unsigned long long bytes_in;
+	unsigned long long bytes_out;
+	unsigned long connects;
+	unsigned long drops;
+} broker_stats_t;
+
+// the default script answers everything and echoes publishes
+void broker_reset(const broker_script_t *script);
+void broker_script(broker_script_t *script);
+void broker_stats(broker_stats_t *stats);
+
+// queue a publish for the client, fails when the client side buffer is full
+int broker_publish(const char *topic, const void *payload, size_t len, int qos);
+// send the last QoS1 publish again with DUP set, as after a lost PUBACK
+int broker_redeliver(void);
+// close the connection as a network failure would
+void broker_drop(void);
+
+// transport side, used by the loopback Network
+int broker_accept(void);
+void broker_close(void);
+bool broker_is_connected(void);
+int broker_write(const unsigned char *buf, size_t len);
+// copies up to len queued bytes, waits up to timeout_ms when there are none
+int broker_read(unsigned char *buf, size_t len, uint32_t timeout_ms);
+
+#endif /* __HOST_MQTT_BROKER_H__ */
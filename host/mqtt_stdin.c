@@ -0,0 +1,170 @@
+/*
+ * Copyright (c) 2018 Samsung Electronics Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/*
+ * Host stand-in for mqtt_main.c
+ *
+ * Every line read from stdin is handled as a payload received on the
+ * command topic, and metrics are written to stdout instead of being
+ * published. Once stdin is closed the application exits after
+ * HOST_DRAIN_MS (1000 by default), letting queued frames finish.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <pthread.h>
+#include <time.h>
+#include <service_app.h>
+
+#include "log.h"
+#include "latency.h"
+
+#define CMD_LINE_MAX		4096
+#define POLL_INTERVAL_MSEC	100
+
+bool terminate_yield_thread;
+static pthread_t g_stdin_thread;
+static bool g_started = false;
+
+static bool metrics_requested = false;
+static int metrics_period_sec = 0;
+static time_t metrics_next = 0;
+
+extern bool process_command(int length, char *payload);
+extern int latency_dump(char *buf, size_t size);
+
+void mqtt_request_metrics(void)
+{
+	__atomic_store_n(&metrics_requested, true, __ATOMIC_RELAXED);
+}
+
+void mqtt_set_metrics_period(int period_sec)
+{
+	__atomic_store_n(&metrics_period_sec, period_sec, __ATOMIC_RELAXED);
+}
+
+static void publish_metrics(void)
+{
+	char payload[1024];
+	int period = __atomic_load_n(&metrics_period_sec, __ATOMIC_RELAXED);
+	time_t now = time(NULL);
+
+	if (!__atomic_exchange_n(&metrics_requested, false, __ATOMIC_RELAXED)) {
+		if (period <= 0 || now < metrics_next)
+			return;
+	}
+	metrics_next = now + period;
+
+	if (latency_dump(payload, sizeof(payload)) < 0)
+		return;
+
+	printf("%s\n", payload);
+	fflush(stdout);
+}
+
+static void handle_line(char *line)
+{
+	int length = strcspn(line, "\r\n");
+
+	line[length] = '\0';
+	if (length == 0 || line[0] == '#')
+		return;
+
+	// the whole line arrived at once, it is readable and framed together
+	latency_stamp(LATENCY_READABLE);
+	latency_stamp(LATENCY_FRAMED);
+	latency_stamp(LATENCY_CALLBACK);
+
+	if (process_command(length, line) == false)
+		ERR("cmd [%s] send failed", line);
+}
+
+static void *stdin_thread_runner(void *ptr)
+{
+	static char buf[CMD_LINE_MAX];
+	struct pollfd pfd = { .fd = STDIN_FILENO, .events = POLLIN };
+	const char *env = getenv("HOST_DRAIN_MS");
+	int drain_ms = env ? atoi(env) : 1000;
+	size_t fill = 0;
+
+	(void)ptr;
+
+	while (!terminate_yield_thread) {
+		int ret = poll(&pfd, 1, POLL_INTERVAL_MSEC);
+
+		if (ret > 0) {
+			ssize_t n = read(STDIN_FILENO, buf + fill, sizeof(buf) - 1 - fill);
+			char *line, *end;
+
+			if (n <= 0)
+				break;
+			fill += n;
+			buf[fill] = '\0';
+
+			line = buf;
+			while ((end = strchr(line, '\n')) != NULL) {
+				*end = '\0';
+				handle_line(line);
+				line = end + 1;
+			}
+
+			fill -= line - buf;
+			if (fill == sizeof(buf) - 1) {
+				WARN("command line too long, dropped");
+				fill = 0;
+			}
+			memmove(buf, line, fill);
+		}
+
+		publish_metrics();
+	}
+
+	if (!terminate_yield_thread) {
+		if (fill > 0) {
+			buf[fill] = '\0';
+			handle_line(buf);
+		}
+		INFO("stdin closed, exiting in %d ms", drain_ms);
+		usleep(drain_ms * 1000);
+		publish_metrics();
+		service_app_exit();
+	}
+
+	return NULL;
+}
+
+int init_mqtt(void)
+{
+	terminate_yield_thread = false;
+
+	if (g_started)
+		return 0;
+
+	if (pthread_create(&g_stdin_thread, NULL, stdin_thread_runner, NULL) != 0) {
+		ERR("pthread_create failed");
+		return -1;
+	}
+	pthread_detach(g_stdin_thread);
+	g_started = true;
+
+	INFO("reading commands from stdin");
+
+	return 0;
+}
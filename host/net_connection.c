@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2018 Samsung Electronics Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <stdlib.h>
+#include <string.h>
+#include <net_connection.h>
+
+// a profile is its name, the connection handle carries nothing
+static char g_connection;
+
+int connection_create(connection_h *connection)
+{
+	if (!connection)
+		return CONNECTION_ERROR_INVALID_PARAMETER;
+
+	*connection = &g_connection;
+
+	return CONNECTION_ERROR_NONE;
+}
+
+int connection_destroy(connection_h connection)
+{
+	return connection ? CONNECTION_ERROR_NONE : CONNECTION_ERROR_INVALID_PARAMETER;
+}
+
+int connection_get_current_profile(connection_h connection, connection_profile_h *profile)
+{
+	const char *name = getenv("HOST_NETWORK");
+
+	if (!connection || !profile)
+		return CONNECTION_ERROR_INVALID_PARAMETER;
+
+	if (!name || !name[0])
+		return CONNECTION_ERROR_NO_CONNECTION;
+
+	*profile = strdup(name);
+
+	return *profile ? CONNECTION_ERROR_NONE : CONNECTION_ERROR_OUT_OF_MEMORY;
+}
+
+int connection_profile_get_name(connection_profile_h profile, char **profile_name)
+{
+	if (!profile || !profile_name)
+		return CONNECTION_ERROR_INVALID_PARAMETER;
+
+	*profile_name = strdup(profile);
+
+	return *profile_name ? CONNECTION_ERROR_NONE : CONNECTION_ERROR_OUT_OF_MEMORY;
+}
+
+int connection_profile_destroy(connection_profile_h profile)
+{
+	if (!profile)
+		return CONNECTION_ERROR_INVALID_PARAMETER;
+
+	free(profile);
+
+	return CONNECTION_ERROR_NONE;
+}
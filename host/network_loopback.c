@@ -0,0 +1,146 @@
+/*
+ * Copyright (c) 2018 Samsung Electronics Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/*
+ * In-memory loopback transport, a host stand-in for the mbedTLS wrapper
+ *
+ * The Network function pointers lead to the scripted broker instead of a
+ * socket, with the same return codes as network_mbedtls_wrapper.c.
+ */
+
+#include <string.h>
+
+#include "sdk/network_interface.h"
+#include "mqtt_broker.h"
+
+// between connect and disconnect, as the socket of the mbedTLS wrapper
+static bool g_open;
+
+IoT_Error_t iot_tls_init(Network *pNetwork, char *pRootCALocation, char *pDeviceCertLocation,
+						 char *pDevicePrivateKeyLocation, char *pDestinationURL,
+						 uint16_t destinationPort, uint32_t timeout_ms, bool ServerVerificationFlag)
+{
+	pNetwork->tlsConnectParams.pRootCALocation = pRootCALocation;
+	pNetwork->tlsConnectParams.pDeviceCertLocation = pDeviceCertLocation;
+	pNetwork->tlsConnectParams.pDevicePrivateKeyLocation = pDevicePrivateKeyLocation;
+	pNetwork->tlsConnectParams.pDestinationURL = pDestinationURL;
+	pNetwork->tlsConnectParams.DestinationPort = destinationPort;
+	pNetwork->tlsConnectParams.timeout_ms = timeout_ms;
+	pNetwork->tlsConnectParams.ServerVerificationFlag = ServerVerificationFlag;
+	pNetwork->tlsConnectParams.keepAliveIdleSec = 0;
+
+	pNetwork->connect = iot_tls_connect;
+	pNetwork->read = iot_tls_read;
+	pNetwork->write = iot_tls_write;
+	pNetwork->disconnect = iot_tls_disconnect;
+	pNetwork->isConnected = iot_tls_is_connected;
+	pNetwork->destroy = iot_tls_destroy;
+	pNetwork->setKeepAlive = iot_tls_set_keepalive;
+
+	pNetwork->tlsDataParams.flags = 0;
+
+	return SUCCESS;
+}
+
+// a dropped connection shows while it is open, as the socket error of the mbedTLS wrapper
+IoT_Error_t iot_tls_is_connected(Network *pNetwork)
+{
+	if (g_open && !broker_is_connected())
+		return NETWORK_PHYSICAL_LAYER_DISCONNECTED;
+
+	return NETWORK_PHYSICAL_LAYER_CONNECTED;
+}
+
+// there is no socket to probe, the idle time is only kept for the checks
+IoT_Error_t iot_tls_set_keepalive(Network *pNetwork, uint16_t idleSec)
+{
+	pNetwork->tlsConnectParams.keepAliveIdleSec = idleSec;
+
+	return SUCCESS;
+}
+
+IoT_Error_t iot_tls_connect(Network *pNetwork, TLSConnectParams *params)
+{
+	if (params != NULL)
+		pNetwork->tlsConnectParams = *params;
+
+	if (broker_accept() != 0)
+		return TCP_CONNECTION_ERROR;
+
+	g_open = true;
+
+	return SUCCESS;
+}
+
+IoT_Error_t iot_tls_write(Network *pNetwork, unsigned char *pMsg, size_t len, Timer *timer, size_t *written_len)
+{
+	int ret = broker_write(pMsg, len);
+
+	if (ret < 0) {
+		*written_len = 0;
+		return NETWORK_SSL_WRITE_ERROR;
+	}
+
+	*written_len = ret;
+
+	return SUCCESS;
+}
+
+IoT_Error_t iot_tls_read(Network *pNetwork, unsigned char *pMsg, size_t len, Timer *timer, size_t *read_len)
+{
+	size_t rxLen = 0;
+	int ret;
+
+	while (len > 0) {
+		ret = broker_read(pMsg, len, left_ms(timer));
+		if (ret < 0)
+			return NETWORK_SSL_READ_ERROR;
+
+		rxLen += ret;
+		pMsg += ret;
+		len -= ret;
+
+		// evaluate timeout after the read to make sure read is done at least once
+		if (has_timer_expired(timer))
+			break;
+	}
+
+	if (len == 0) {
+		*read_len = rxLen;
+		return SUCCESS;
+	}
+
+	if (rxLen == 0)
+		return NETWORK_SSL_NOTHING_TO_READ;
+	else
+		return NETWORK_SSL_READ_TIMEOUT_ERROR;
+}
+
+IoT_Error_t iot_tls_disconnect(Network *pNetwork)
+{
+	broker_close();
+	g_open = false;
+
+	return SUCCESS;
+}
+
+IoT_Error_t iot_tls_destroy(Network *pNetwork)
+{
+	g_open = false;
+
+	return SUCCESS;
+}
@@ -0,0 +1,294 @@
+/*
+ * Copyright (c) 2018 Samsung Electronics Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <time.h>
+#include <peripheral_io.h>
+
+// events kept per handle, later ones are counted as dropped
+#define IO_EVENT_MAX	(1 << 20)
+
+typedef struct {
+	uint64_t nsec;
+	uint32_t value;
+} io_event_t;
+
+typedef struct {
+	io_event_t *events;
+	unsigned int count;
+	unsigned int dropped;
+} io_log_t;
+
+struct _peripheral_pwm_s {
+	int chip;
+	int pin;
+	uint32_t period;
+	uint32_t duty_cycle;
+	peripheral_pwm_polarity_e polarity;
+	bool enabled;
+	io_log_t log;
+};
+
+struct _peripheral_gpio_s {
+	int pin;
+	peripheral_gpio_direction_e direction;
+	peripheral_gpio_edge_e edge;
+	uint32_t value;
+	peripheral_gpio_interrupted_cb cb;
+	void *cb_data;
+	io_log_t log;
+};
+
+static pthread_mutex_t g_dump_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static uint64_t io_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static int io_log_init(io_log_t *log)
+{
+	// allocated up front so recording never allocates on the transmit path
+	log->events = malloc(IO_EVENT_MAX * sizeof(io_event_t));
+	log->count = 0;
+	log->dropped = 0;
+
+	return log->events ? 0 : -1;
+}
+
+static void io_log_add(io_log_t *log, uint32_t value)
+{
+	uint64_t now = io_now();
+
+	if (log->count >= IO_EVENT_MAX) {
+		log->dropped++;
+		return;
+	}
+
+	log->events[log->count].nsec = now;
+	log->events[log->count].value = value;
+	log->count++;
+}
+
+static void io_log_dump(io_log_t *log, const char *kind, const char *name)
+{
+	const char *path = getenv("HOST_IO_LOG");
+	unsigned int i;
+	FILE *fp;
+
+	if (log->dropped)
+		fprintf(stderr, "%s %s: %u events dropped\n", kind, name, log->dropped);
+
+	if (path && log->count) {
+		pthread_mutex_lock(&g_dump_lock);
+		fp = fopen(path, "a");
+		if (fp) {
+			for (i = 0; i < log->count; i++)
+				fprintf(fp, "%s %s %llu %u\n", kind, name,
+						(unsigned long long)log->events[i].nsec, log->events[i].value);
+			fclose(fp);
+		} else {
+			fprintf(stderr, "can not open %s\n", path);
+		}
+		pthread_mutex_unlock(&g_dump_lock);
+	}
+
+	free(log->events);
+	log->events = NULL;
+}
+
+int peripheral_pwm_open(int chip, int pin, peripheral_pwm_h *pwm)
+{
+	peripheral_pwm_h h;
+
+	if (chip < 0 || pin < 0 || !pwm)
+		return PERIPHERAL_ERROR_INVALID_PARAMETER;
+
+	h = calloc(1, sizeof(*h));
+	if (!h || io_log_init(&h->log) != 0) {
+		free(h);
+		return PERIPHERAL_ERROR_OUT_OF_MEMORY;
+	}
+
+	h->chip = chip;
+	h->pin = pin;
+	*pwm = h;
+
+	return PERIPHERAL_ERROR_NONE;
+}
+
+int peripheral_pwm_close(peripheral_pwm_h pwm)
+{
+	char name[32];
+
+	if (!pwm)
+		return PERIPHERAL_ERROR_INVALID_PARAMETER;
+
+	snprintf(name, sizeof(name), "%d.%d", pwm->chip, pwm->pin);
+	io_log_dump(&pwm->log, "pwm", name);
+	free(pwm);
+
+	return PERIPHERAL_ERROR_NONE;
+}
+
+int peripheral_pwm_set_period(peripheral_pwm_h pwm, uint32_t period_ns)
+{
+	if (!pwm)
+		return PERIPHERAL_ERROR_INVALID_PARAMETER;
+
+	pwm->period = period_ns;
+
+	return PERIPHERAL_ERROR_NONE;
+}
+
+int peripheral_pwm_set_duty_cycle(peripheral_pwm_h pwm, uint32_t duty_cycle_ns)
+{
+	if (!pwm)
+		return PERIPHERAL_ERROR_INVALID_PARAMETER;
+
+	pwm->duty_cycle = duty_cycle_ns;
+
+	return PERIPHERAL_ERROR_NONE;
+}
+
+int peripheral_pwm_set_polarity(peripheral_pwm_h pwm, peripheral_pwm_polarity_e polarity)
+{
+	if (!pwm)
+		return PERIPHERAL_ERROR_INVALID_PARAMETER;
+
+	pwm->polarity = polarity;
+
+	return PERIPHERAL_ERROR_NONE;
+}
+
+int peripheral_pwm_set_enabled(peripheral_pwm_h pwm, bool enabled)
+{
+	if (!pwm)
+		return PERIPHERAL_ERROR_INVALID_PARAMETER;
+
+	io_log_add(&pwm->log, enabled);
+	pwm->enabled = enabled;
+
+	return PERIPHERAL_ERROR_NONE;
+}
+
+int peripheral_gpio_open(int gpio_pin, peripheral_gpio_h *gpio)
+{
+	peripheral_gpio_h h;
+
+	if (gpio_pin < 0 || !gpio)
+		return PERIPHERAL_ERROR_INVALID_PARAMETER;
+
+	h = calloc(1, sizeof(*h));
+	if (!h || io_log_init(&h->log) != 0) {
+		free(h);
+		return PERIPHERAL_ERROR_OUT_OF_MEMORY;
+	}
+
+	h->pin = gpio_pin;
+	*gpio = h;
+
+	return PERIPHERAL_ERROR_NONE;
+}
+
+int peripheral_gpio_close(peripheral_gpio_h gpio)
+{
+	char name[16];
+
+	if (!gpio)
+		return PERIPHERAL_ERROR_INVALID_PARAMETER;
+
+	snprintf(name, sizeof(name), "%d", gpio->pin);
+	io_log_dump(&gpio->log, "gpio", name);
+	free(gpio);
+
+	return PERIPHERAL_ERROR_NONE;
+}
+
+int peripheral_gpio_set_direction(peripheral_gpio_h gpio, peripheral_gpio_direction_e direction)
+{
+	if (!gpio)
+		return PERIPHERAL_ERROR_INVALID_PARAMETER;
+
+	gpio->direction = direction;
+	if (direction == PERIPHERAL_GPIO_DIRECTION_OUT_INITIALLY_HIGH)
+		gpio->value = 1;
+	else if (direction == PERIPHERAL_GPIO_DIRECTION_OUT_INITIALLY_LOW)
+		gpio->value = 0;
+
+	return PERIPHERAL_ERROR_NONE;
+}
+
+int peripheral_gpio_set_edge_mode(peripheral_gpio_h gpio, peripheral_gpio_edge_e edge)
+{
+	if (!gpio || gpio->direction != PERIPHERAL_GPIO_DIRECTION_IN)
+		return PERIPHERAL_ERROR_INVALID_PARAMETER;
+
+	gpio->edge = edge;
+
+	return PERIPHERAL_ERROR_NONE;
+}
+
+// the callback is kept but never raised, there are no input edges on the host
+int peripheral_gpio_set_interrupted_cb(peripheral_gpio_h gpio, peripheral_gpio_interrupted_cb callback, void *user_data)
+{
+	if (!gpio || !callback)
+		return PERIPHERAL_ERROR_INVALID_PARAMETER;
+
+	gpio->cb = callback;
+	gpio->cb_data = user_data;
+
+	return PERIPHERAL_ERROR_NONE;
+}
+
+int peripheral_gpio_unset_interrupted_cb(peripheral_gpio_h gpio)
+{
+	if (!gpio)
+		return PERIPHERAL_ERROR_INVALID_PARAMETER;
+
+	gpio->cb = NULL;
+	gpio->cb_data = NULL;
+
+	return PERIPHERAL_ERROR_NONE;
+}
+
+int peripheral_gpio_read(peripheral_gpio_h gpio, uint32_t *value)
+{
+	if (!gpio || !value)
+		return PERIPHERAL_ERROR_INVALID_PARAMETER;
+
+	*value = gpio->value;
+
+	return PERIPHERAL_ERROR_NONE;
+}
+
+int peripheral_gpio_write(peripheral_gpio_h gpio, uint32_t value)
+{
+	if (!gpio || gpio->direction == PERIPHERAL_GPIO_DIRECTION_IN)
+		return PERIPHERAL_ERROR_INVALID_PARAMETER;
+
+	io_log_add(&gpio->log, value);
+	gpio->value = value;
+
+	return PERIPHERAL_ERROR_NONE;
+}
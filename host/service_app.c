@@ -0,0 +1,125 @@
+/*
+ * Copyright (c) 2018 Samsung Electronics Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <Ecore.h>
+#include <service_app.h>
+
+static char *host_path(const char *env, const char *fallback, bool create)
+{
+	const char *dir = getenv(env);
+	size_t len;
+	char *path;
+
+	if (!dir || !dir[0])
+		dir = fallback;
+
+	len = strlen(dir);
+	path = malloc(len + 2);
+	if (!path)
+		return NULL;
+
+	memcpy(path, dir, len + 1);
+	if (path[len - 1] != '/') {
+		path[len] = '/';
+		path[len + 1] = '\0';
+	}
+
+	if (create && mkdir(path, 0755) != 0 && errno != EEXIST)
+		fprintf(stderr, "can not create %s [%d]\n", path, errno);
+
+	return path;
+}
+
+char *app_get_data_path(void)
+{
+	return host_path("HOST_DATA_PATH", "host-data", true);
+}
+
+char *app_get_resource_path(void)
+{
+	return host_path("HOST_RES_PATH", "../res", false);
+}
+
+static void service_app_signal(int signo)
+{
+	(void)signo;
+	ecore_main_loop_quit();
+}
+
+int service_app_main(int argc, char **argv, service_app_lifecycle_callback_s *callback, void *user_data)
+{
+	struct sigaction sa;
+
+	(void)argc;
+	(void)argv;
+
+	if (!callback || !callback->create || !callback->terminate)
+		return APP_ERROR_INVALID_PARAMETER;
+
+	if (ecore_init() != 1)
+		return APP_ERROR_INVALID_CONTEXT;
+
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = service_app_signal;
+	sigemptyset(&sa.sa_mask);
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+	signal(SIGPIPE, SIG_IGN);
+
+	// as on the device, a failed create ends the application without terminate
+	if (!callback->create(user_data))
+		return APP_ERROR_NONE;
+
+	if (callback->app_control)
+		callback->app_control(NULL, user_data);
+
+	ecore_main_loop_begin();
+
+	callback->terminate(user_data);
+
+	return APP_ERROR_NONE;
+}
+
+void service_app_exit(void)
+{
+	ecore_main_loop_quit();
+}
+
+int service_app_add_event_handler(app_event_handler_h *event_handler, app_event_type_e event_type, app_event_cb callback, void *user_data)
+{
+	(void)event_type;
+	(void)user_data;
+
+	if (!event_handler || !callback)
+		return APP_ERROR_INVALID_PARAMETER;
+
+	// a non-NULL token, events are never raised on the host
+	*event_handler = (app_event_handler_h)callback;
+
+	return APP_ERROR_NONE;
+}
+
+int service_app_remove_event_handler(app_event_handler_h event_handler)
+{
+	return event_handler ? APP_ERROR_NONE : APP_ERROR_INVALID_PARAMETER;
+}
@@ -0,0 +1,54 @@
+#!/bin/sh
+#
+# IR timing regression test of the host build
+#
+#   ir_timing.sh <remocon-host> <ir-timing-check> <tests dir> [runs]
+#
+# Every <command>.frames in the tests dir names a command. It is sent
+# through remocon-host 'runs' times (5 by default) with HOST_IO_LOG set,
+# and the PWM edges are checked against the frames in the file.
+
+HOST=$1
+CHECK=$2
+TESTS=$3
+RUNS=${4:-5}
+
+if [ ! -x "$HOST" ] || [ ! -x "$CHECK" ] || [ ! -d "$TESTS" ]; then
+	echo "usage: $0 <remocon-host> <ir-timing-check> <tests dir> [runs]" >&2
+	exit 2
+fi
+
+HOST=$(cd "$(dirname "$HOST")" && pwd)/$(basename "$HOST")
+CHECK=$(cd "$(dirname "$CHECK")" && pwd)/$(basename "$CHECK")
+TESTS=$(cd "$TESTS" && pwd)
+
+WORK=$(mktemp -d) || exit 2
+trap 'rm -rf "$WORK"' EXIT
+
+failed=0
+
+for frames in "$TESTS"/*.frames; do
+	cmd=$(basename "$frames" .frames)
+	logs=""
+
+	run=1
+	while [ $run -le "$RUNS" ]; do
+		# an empty data path, so no codebook, emitter map or lirc device is picked up
+		rm -rf "$WORK/data"
+		mkdir "$WORK/data"
+		log="$WORK/$cmd.$run.log"
+
+		(cd "$WORK" && echo "$cmd" | HOST_DATA_PATH="$WORK/data" HOST_IO_LOG="$log" \
+			HOST_DRAIN_MS=500 "$HOST" > /dev/null 2>&1)
+
+		logs="$logs $log"
+		run=$((run + 1))
+	done
+
+	if ! "$CHECK" "$frames" $logs; then
+		echo "$cmd: FAILED"
+		failed=1
+	fi
+done
+
+exit $failed
@@ -0,0 +1,149 @@
+/*
+ * Copyright (c) 2018 Samsung Electronics Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/*
+ * PWM toggle latency of the transmitter
+ *
+ * Times resource_transmit_data() on the pre-opened sysfs enable attribute
+ * and on peripheral-io, the two paths the PWM transmitter toggles through.
+ * The transmitter source is included here to switch between them. Results
+ * use the Go benchmark line format, as codec-bench does.
+ *
+ *   toggle-bench [-n count] [-e emitter]
+ *
+ * On the host the sysfs path is timed when a file is put at the enable
+ * path under HOST_DATA_PATH. Built for a device, this drives the real PWM,
+ * so keep the emitter covered.
+ */
+
+#include "../src/resource/resource_ir_transmit.c"
+
+#include <stdlib.h>
+
+#define TOGGLE_DEFAULT_COUNT	1000
+
+// there is no application here to trace or publish metrics for
+void mqtt_request_metrics(void)
+{
+}
+
+void mqtt_set_metrics_period(int period_sec)
+{
+}
+
+bool irtrace_enabled = false;
+
+uint64_t irtrace_now(void)
+{
+	return 0;
+}
+
+void irtrace_record(int emitter, int edge, bool level, uint64_t intended, uint64_t actual)
+{
+}
+
+void mysleep_microsec(int microsec)
+{
+}
+
+// every emitter is opened, not only the ones a device faces
+bool remocon_emitter_used(int emitter)
+{
+	return true;
+}
+
+static uint64_t clock_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static void toggle_run(int emitter, const char *name, int count)
+{
+	uint64_t start, elapsed, total = 0, min = UINT64_MAX, max = 0;
+	int i;
+
+	for (i = 0; i < count; i++) {
+		start = clock_ns();
+		resource_transmit_data(emitter, i % 2 == 0);
+		elapsed = clock_ns() - start;
+
+		total += elapsed;
+		if (elapsed < min)
+			min = elapsed;
+		if (elapsed > max)
+			max = elapsed;
+	}
+	resource_transmit_data(emitter, false);
+
+	printf("BenchmarkToggle/%s\t%d\t%llu ns/op\t%llu min-ns\t%llu max-ns\n", name, count,
+		(unsigned long long)(total / count), (unsigned long long)min, (unsigned long long)max);
+}
+
+int main(int argc, char *argv[])
+{
+	irtx_emitter_t *e;
+	int count = TOGGLE_DEFAULT_COUNT;
+	int emitter = EMITTER_MAIN;
+	int fd, opt;
+
+	while ((opt = getopt(argc, argv, "n:e:h")) != -1) {
+		switch (opt) {
+		case 'n':
+			count = atoi(optarg);
+			break;
+		case 'e':
+			emitter = atoi(optarg);
+			break;
+		default:
+			fprintf(stderr, "usage: toggle-bench [-n count] [-e emitter]\n");
+			return 1;
+		}
+	}
+
+	if (count <= 0 || emitter < 0 || emitter >= EMITTER_NUM) {
+		fprintf(stderr, "usage: toggle-bench [-n count] [-e emitter]\n");
+		return 1;
+	}
+
+	if (resource_irtx_init() != PERIPHERAL_ERROR_NONE || !resource_irtx_is_available(emitter)) {
+		fprintf(stderr, "emitter %d is not available\n", emitter);
+		return 1;
+	}
+
+	e = &g_emitters[emitter];
+	if (e->lirc_fd >= 0) {
+		fprintf(stderr, "emitter %d transmits through lirc, there is no PWM to toggle\n", emitter);
+		resource_irtx_close();
+		return 1;
+	}
+
+	fd = e->enable_fd;
+	if (fd >= 0)
+		toggle_run(emitter, "sysfs", count);
+
+	e->enable_fd = -1;
+	toggle_run(emitter, "peripheral-io", count);
+	e->enable_fd = fd;
+
+	resource_irtx_close();
+
+	return 0;
+}
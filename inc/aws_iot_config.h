@@ -36,6 +36,7 @@
 #define AWS_IOT_MQTT_TX_BUF_LEN 512 ///< Any time a message is sent out through the MQTT layer. The message is copied into this buffer anytime a publish is done. This will also be used in the case of Thing Shadow
 #define AWS_IOT_MQTT_RX_BUF_LEN 512 ///< Any message that comes into the device should be less than this buffer size. If a received message is bigger than this buffer size the message will be dropped.
 #define AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS 5 ///< Maximum number of topic filters the MQTT client can handle at any given time. This should be increased appropriately when using Thing Shadow
+#define AWS_IOT_MQTT_DEDUPE_WINDOW 16 ///< Packet ids of the last inbound QoS1 messages remembered. A redelivered message (DUP set) with one of these ids and the same topic and payload is acknowledged but not delivered again
 
 // Thing Shadow specific configs
 #define SHADOW_MAX_SIZE_OF_RX_BUFFER (AWS_IOT_MQTT_RX_BUF_LEN+1) ///< Maximum size of the SHADOW buffer to store the received Shadow message, including terminating NULL byte.
@@ -53,6 +54,17 @@
 #define AWS_IOT_MQTT_MIN_RECONNECT_WAIT_INTERVAL 1000 ///< Minimum time before the First reconnect attempt is made as part of the exponential back-off algorithm
 #define AWS_IOT_MQTT_MAX_RECONNECT_WAIT_INTERVAL 128000 ///< Maximum time interval after which exponential back-off will stop attempting to reconnect.
 
+// Adaptive keepalive specific config, the keepalive sent on connect is the longest ping interval
+#define AWS_IOT_MQTT_MIN_KEEPALIVE_INTERVAL 60 ///< Shortest ping interval in seconds, probing for a longer one starts here
+#define AWS_IOT_MQTT_KEEPALIVE_STABLE_PINGS 3 ///< Pings answered at one interval before a 25% longer one is tried
+#define AWS_IOT_MQTT_KEEPALIVE_REPROBE_PINGS 48 ///< Pings answered just below an interval the link was lost at before that interval is tried again
+
+// TCP keepalive of the MQTT socket, off while the adaptive keepalive probes for a longer ping interval
+#define AWS_IOT_TCP_KEEPALIVE_IDLE 120 ///< Seconds of idle time before the first keepalive probe is sent
+#define AWS_IOT_TCP_KEEPALIVE_INTERVAL 10 ///< Seconds between unanswered keepalive probes
+#define AWS_IOT_TCP_KEEPALIVE_COUNT 3 ///< Unanswered probes after which the connection is dropped
+#define AWS_IOT_TCP_USER_TIMEOUT 30000 ///< Milliseconds sent data may stay unacknowledged before the connection is dropped
+
 #define DISABLE_METRICS false ///< Disable the collection of metrics by setting this to true
 
 #endif /* SRC_SHADOW_IOT_SHADOW_CONFIG_H_ */
@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2018 Samsung Electronics Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __IR_CODEBOOK_H__
+#define __IR_CODEBOOK_H__
+
+#include <stdint.h>
+
+/*
+ * Compiled IR codebook file
+ *
+ * The file is used as is from a read-only mapping, all offsets are in bytes
+ * from the start of the file and all values are little endian.
+ *
+ * +---------------------+
+ * | codebook_header_t   |
+ * | codebook_entry_t [] |  entry_count entries
+ * | uint32_t buckets [] |  hash_size buckets, entry index + 1, 0 when empty
+ * | uint32_t durations[]|  mark/space arrays of all entries, usec
+ * | string table        |  NUL terminated key names
+ * +---------------------+
+ */
+
+#define CODEBOOK_MAGIC			0x4B425249	// "IRBK"
+#define CODEBOOK_VERSION		1
+#define CODEBOOK_FILE_NAME		"codebook.bin"
+
+// accepted carrier of an entry, the compiler and the loader agree on it
+#define CODEBOOK_MIN_CARRIER	20000		// Hz
+#define CODEBOOK_MAX_CARRIER	60000		// Hz
+
+typedef struct {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t file_size;
+	uint32_t entry_count;
+	uint32_t hash_size;				// power of 2
+	uint32_t entries_offset;
+	uint32_t buckets_offset;
+	uint32_t durations_offset;
+	uint32_t strings_offset;
+	uint32_t strings_size;
+} codebook_header_t;
+
+typedef struct {
+	uint32_t name_offset;			// from strings_offset
+	uint32_t name_hash;
+	uint32_t next;					// entry index + 1 in the same bucket, 0 at the end
+	uint32_t carrier;				// Hz
+	uint32_t frame_offset;			// index into durations
+	uint32_t repeat_offset;			// index into durations
+	uint16_t frame_len;
+	uint16_t repeat_len;			// 0 when a held key repeats the frame
+	uint8_t device;					// below DEVICE_NUM
+	uint8_t priority;
+	uint8_t send_count;				// frames sent for a single press
+	uint8_t reserved;
+} codebook_entry_t;
+
+// mapped codebook file, shared by reference with queued jobs
+typedef struct ir_codebook ir_codebook_t;
+
+// FNV-1a of a key name
+static inline uint32_t codebook_hash(const char *name)
+{
+	uint32_t hash = 2166136261u;
+
+	while (*name) {
+		hash ^= (unsigned char)*name++;
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+#endif /* __IR_CODEBOOK_H__ */
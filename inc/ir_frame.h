@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) 2018 Samsung Electronics Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __IR_FRAME_H__
+#define __IR_FRAME_H__
+
+#include <stdint.h>
+
+#define IR_FRAME_MAX_LEN		256
+#define IR_CARRIER_38KHZ		38000
+
+/*
+ * Precomputed IR frame
+ * duration[] holds alternating mark/space times in micro seconds,
+ * starting with a mark. Even entries are marks, odd entries are spaces.
+ */
+typedef struct {
+	unsigned int carrier;		// carrier frequency in Hz
+	int len;
+	int overflow;				// an edge did not fit, the frame must not be sent
+	unsigned int duration[IR_FRAME_MAX_LEN];
+} ir_frame_t;
+
+// frame compiled from a raw or Pronto payload, cached by content
+typedef struct ir_raw ir_raw_t;
+
+static inline void ir_frame_init(ir_frame_t *frame, unsigned int carrier)
+{
+	frame->carrier = carrier;
+	frame->len = 0;
+	frame->overflow = 0;
+}
+
+// -1 once the frame is full, the frame then stays marked as overflowed
+static inline int ir_frame_add(ir_frame_t *frame, int is_mark, unsigned int time)
+{
+	// two marks or two spaces in a row are one longer edge
+	if (frame->len > 0 && ((frame->len - 1) % 2 == 0) == (is_mark != 0)) {
+		frame->duration[frame->len - 1] += time;
+		return 0;
+	}
+
+	// a frame never starts with a space
+	if (frame->len == 0 && !is_mark)
+		return 0;
+
+	if (frame->len >= IR_FRAME_MAX_LEN) {
+		frame->overflow = 1;
+		return -1;
+	}
+
+	frame->duration[frame->len++] = time;
+
+	return 0;
+}
+
+#endif /* __IR_FRAME_H__ */
@@ -0,0 +1,41 @@
+/*
+ * Copyright (c) 2018 Samsung Electronics Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __IR_PROTOCOL_H__
+#define __IR_PROTOCOL_H__
+
+#include <stdint.h>
+
+/*
+ * Pulse distance protocol descriptor
+ * A frame is header, pre data bits, key bits (MSB first) and a stop mark.
+ */
+typedef struct {
+	const char *name;
+	int device;
+	unsigned int header_mark;
+	unsigned int header_space;
+	unsigned int one_mark;
+	unsigned int one_space;
+	unsigned int zero_mark;
+	unsigned int zero_space;
+	unsigned int stop_mark;
+	int pre_data_bits;
+	uint32_t pre_data;
+	int bits;
+} ir_protocol_t;
+
+#endif /* __IR_PROTOCOL_H__ */
@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) 2018 Samsung Electronics Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef __LATENCY_H__
+#define __LATENCY_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Points a command passes from the socket to the IR LED. The stamps of a
+ * command follow it from the MQTT thread to the transmit worker.
+ */
+typedef enum {
+	LATENCY_READABLE,		// first byte of the packet read from the socket
+	LATENCY_FRAMED,			// whole packet read
+	LATENCY_CALLBACK,		// subscribe callback entered
+	LATENCY_RESOLVED,		// command resolved and queued
+	LATENCY_FIRST_EDGE,		// first IR edge
+	LATENCY_LAST_EDGE,		// end of the last mark
+	LATENCY_POINT_NUM,
+} latency_point_e;
+
+typedef struct {
+	uint64_t stamp[LATENCY_POINT_NUM];	// CLOCK_MONOTONIC nsec, 0 when not passed
+} latency_trace_t;
+
+extern bool latency_enabled;
+
+void latency_stamp_now(latency_point_e point);
+
+// cheap enough for the hot paths, a load and a branch when disabled
+static inline void latency_stamp(latency_point_e point)
+{
+	if (__atomic_load_n(&latency_enabled, __ATOMIC_RELAXED))
+		latency_stamp_now(point);
+}
+
+void latency_trace_get(latency_trace_t *trace);
+void latency_trace_set(const latency_trace_t *trace);
+void latency_trace_commit(void);
+
+#endif /* __LATENCY_H__ */
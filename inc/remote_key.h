@@ -14,6 +14,11 @@
  * limitations under the License.
  */
 
+#ifndef __REMOTE_KEY_H__
+#define __REMOTE_KEY_H__
+
+#include <stdint.h>
+
 // Samsung TV Remote code
 // Remote Model : BN59-01180A
 #define TV_KEY_POWER			0x40BF
@@ -40,8 +45,35 @@
 #define VA_KEY_SCHED	0x906F
 #define VA_KEY_HOME		0x40BF
 
+// Target devices
+#define DEVICE_TV		0
+#define DEVICE_VACUUM	1
+#define DEVICE_NUM		2
+
+// IR emitters, each one is driven by its own transmit worker
+#define EMITTER_MAIN	0
+#define EMITTER_SUB		1
+#define EMITTER_NUM		2
+
+// Command priority classes, a lower value is served first
+#define PRIORITY_URGENT	0
+#define PRIORITY_NORMAL	1
+#define PRIORITY_LOW	2
+#define PRIORITY_NUM	3
+
+// Command flags
+#define CMD_FLAG_MAILBOX	0x01	// latest wins over a not yet started command of the device
+
 typedef struct {
 	int index;
 	char cmd[20];
 	uint16_t key_value;
+	int device;
+	int flags;
+	int priority;
 } cmd_t;
+
+// called by the transmit worker once a queued command is sent or dropped
+typedef void (*remocon_done_cb)(void *data);
+
+#endif /* __REMOTE_KEY_H__ */
@@ -74,7 +74,8 @@ typedef struct _Client AWS_IoT_Client;
  */
 typedef enum QoS {
 	QOS0 = 0,
-	QOS1 = 1
+	QOS1 = 1,
+	QOS_SUBACK_FAILURE = 0x80	///< Granted QoS of a topic filter refused by the server
 } QoS;
 
 /**
@@ -147,6 +148,28 @@ extern const IoT_Client_Connect_Params iotClientConnectParamsDefault;
 #define IoT_Client_Connect_Params_initializer { {'M', 'Q', 'T', 'C'}, MQTT_3_1_1, NULL, 0, 60, true, false, \
         IoT_MQTT_Will_Options_Initializer, NULL, 0, NULL, 0 }
 
+/**
+ * @brief Application Callback Handler Type
+ *
+ * Defining a TYPE for definition of application callback function pointers.
+ * Used to send incoming data to the application
+ *
+ */
+typedef void (*pApplicationHandler_t)(AWS_IoT_Client *pClient, char *pTopicName, uint16_t topicNameLen,
+									  IoT_Publish_Message_Params *pParams, void *pClientData);
+
+/**
+ * @brief Dispatch Handler Type
+ *
+ * Called in place of a matching application handler when set, so the handler can run elsewhere.
+ * The topic and payload point into the client's read buffer and have to be copied before return.
+ * The application handler must not call the client unless thread support is enabled.
+ *
+ */
+typedef IoT_Error_t (*pDispatchHandler_t)(AWS_IoT_Client *pClient, pApplicationHandler_t pApplicationHandler,
+										  void *pApplicationHandlerData, char *pTopicName, uint16_t topicNameLen,
+										  IoT_Publish_Message_Params *pParams, void *pDispatchHandlerData);
+
 /**
  * @brief Disconnect Callback Handler Type
  *
@@ -155,6 +178,26 @@ extern const IoT_Client_Connect_Params iotClientConnectParamsDefault;
  */
 typedef void (*iot_disconnect_handler)(AWS_IoT_Client *, void *);
 
+/**
+ * @brief Inbound packet read progress
+ *
+ * Points of an inbound packet reported to the packet read handler.
+ *
+ */
+typedef enum {
+	MQTT_PACKET_READ_STARTED = 0,	///< First byte of the packet read from the network
+	MQTT_PACKET_READ_COMPLETE = 1	///< Whole packet read, before it is handled
+} MqttPacketReadEvent;
+
+/**
+ * @brief Packet Read Callback Handler Type
+ *
+ * Defining a TYPE for definition of packet read callback function pointers.
+ * Called from the thread reading the packet, so it must return quickly.
+ *
+ */
+typedef void (*iot_packet_read_handler)(AWS_IoT_Client *, MqttPacketReadEvent, void *);
+
 /**
  * @brief MQTT Initialization Parameters
  *
@@ -175,6 +218,9 @@ typedef struct {
 	bool isSSLHostnameVerify;			///< Client should perform server certificate hostname validation
 	iot_disconnect_handler disconnectHandler;	///< Callback to be invoked upon connection loss
 	void *disconnectHandlerData;			///< Data to pass as argument when disconnect handler is called
+	pDispatchHandler_t dispatchHandler;		///< Hands matching messages to the application handlers, NULL calls them inline
+	void *dispatchHandlerData;			///< Data to pass as argument when dispatch handler is called
+	bool isAdaptiveKeepAliveEnabled;		///< Ping at the longest interval, up to the connect keepalive, that the network keeps an idle link for
 #ifdef _ENABLE_THREAD_SUPPORT_
 	bool isBlockOnThreadLockEnabled;		///< Timeout for Thread blocking calls. Set to 0 to block until lock is obtained. In milliseconds
 #endif
@@ -182,9 +228,9 @@ typedef struct {
 extern const IoT_Client_Init_Params iotClientInitParamsDefault;
 
 #ifdef _ENABLE_THREAD_SUPPORT_
-#define IoT_Client_Init_Params_initializer { true, NULL, 0, NULL, NULL, NULL, 2000, 20000, 5000, true, NULL, NULL, false }
+#define IoT_Client_Init_Params_initializer { true, NULL, 0, NULL, NULL, NULL, 2000, 20000, 5000, true, NULL, NULL, NULL, NULL, false, false }
 #else
-#define IoT_Client_Init_Params_initializer { true, NULL, 0, NULL, NULL, NULL, 2000, 20000, 5000, true, NULL, NULL }
+#define IoT_Client_Init_Params_initializer { true, NULL, 0, NULL, NULL, NULL, 2000, 20000, 5000, true, NULL, NULL, NULL, NULL, false }
 #endif
 
 /**
@@ -210,16 +256,6 @@ typedef enum _ClientState {
 	CLIENT_STATE_PENDING_RECONNECT = 13
 } ClientState;
 
-/**
- * @brief Application Callback Handler Type
- *
- * Defining a TYPE for definition of application callback function pointers.
- * Used to send incoming data to the application
- *
- */
-typedef void (*pApplicationHandler_t)(AWS_IoT_Client *pClient, char *pTopicName, uint16_t topicNameLen,
-									  IoT_Publish_Message_Params *pParams, void *pClientData);
-
 /**
  * @brief MQTT Message Handler
  *
@@ -235,6 +271,34 @@ typedef struct _MessageHandlers {
 	void *pApplicationHandlerData;
 } MessageHandlers;   /* Message handlers are indexed by subscription topic */
 
+/**
+ * @brief Inbound QoS1 Message
+ *
+ * Identity of an inbound QoS1 message kept in the dedupe window.
+ * The hash covers the topic and the payload, so a reused packet id of a different message is not a duplicate.
+ *
+ */
+typedef struct {
+	uint16_t packetId;	///< Packet id of the message, 0 is an empty entry
+	uint32_t hash;		///< Hash of the topic and the payload
+} InboundMessage;
+
+/**
+ * @brief MQTT Subscription
+ *
+ * One topic filter of a multi-topic subscribe request.
+ * The granted QoS is filled in from the SUBACK, QOS_SUBACK_FAILURE when the server refused the filter.
+ *
+ */
+typedef struct {
+	const char *pTopicName;                      ///< Topic filter, needs to be static in memory
+	uint16_t topicNameLen;                       ///< Length of the topic filter
+	QoS qos;                                     ///< Requested QoS
+	pApplicationHandler_t pApplicationHandler;   ///< Handler for messages matching the filter
+	void *pApplicationHandlerData;               ///< Data passed to the handler, needs to be static in memory
+	QoS grantedQoS;                              ///< Returned granted QoS
+} IoT_MQTT_Subscription;
+
 /**
  * @brief MQTT Client Status
  *
@@ -246,6 +310,7 @@ typedef struct _ClientStatus {
 	ClientState clientState;
 	bool isPingOutstanding;
 	bool isAutoReconnectEnabled;
+	bool isSessionPresent;		///< The server resumed a stored session on the last connect
 } ClientStatus;
 
 /**
@@ -261,8 +326,11 @@ typedef struct _ClientData {
 	uint32_t packetTimeoutMs;
 	uint32_t commandTimeoutMs;
 	uint16_t keepAliveInterval;
+	uint16_t keepAliveCeiling;		///< Shortest ping interval an idle link was lost at, 0 when none
+	uint32_t keepAliveStableCount;	///< Pings answered since the ping interval last changed
 	uint32_t currentReconnectWaitInterval;
 	uint32_t counterNetworkDisconnected;
+	bool isAdaptiveKeepAliveEnabled;
 
 	/* The below values are initialized with the
 	 * lengths of the TX/RX buffers and never modified
@@ -284,6 +352,14 @@ typedef struct _ClientData {
 
 	MessageHandlers messageHandlers[AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS];
 	iot_disconnect_handler disconnectHandler;
+	iot_packet_read_handler packetReadHandler;
+	void *packetReadHandlerData;
+	pDispatchHandler_t dispatchHandler;
+	void *dispatchHandlerData;
+
+	/* The last inbound QoS1 messages */
+	InboundMessage inboundMessages[AWS_IOT_MQTT_DEDUPE_WINDOW];
+	uint32_t inboundMessageIndex;
 
 	void *disconnectHandlerData;
 } ClientData;
@@ -379,6 +455,21 @@ bool aws_iot_is_autoreconnect_enabled(AWS_IoT_Client *pClient);
 IoT_Error_t aws_iot_mqtt_set_disconnect_handler(AWS_IoT_Client *pClient, iot_disconnect_handler pDisconnectHandler,
 												void *pDisconnectHandlerData);
 
+/**
+ * @brief Set the IoT Client packet read handler
+ *
+ * Called to set a handler told when an inbound packet starts and finishes being read,
+ * e.g. to timestamp it. NULL removes the handler.
+ *
+ * @param pClient Reference to the IoT Client
+ * @param pPacketReadHandler Reference to the new Packet Read Handler
+ * @param pPacketReadHandlerData Reference to the data to be passed as argument when packet read handler is called
+ *
+ * @return IoT_Error_t Type defining successful/failed API call
+ */
+IoT_Error_t aws_iot_mqtt_set_packet_read_handler(AWS_IoT_Client *pClient, iot_packet_read_handler pPacketReadHandler,
+												 void *pPacketReadHandlerData);
+
 /**
  * @brief Enable or Disable AutoReconnect on Network Disconnect
  *
@@ -391,6 +482,32 @@ IoT_Error_t aws_iot_mqtt_set_disconnect_handler(AWS_IoT_Client *pClient, iot_dis
  */
 IoT_Error_t aws_iot_mqtt_autoreconnect_set_status(AWS_IoT_Client *pClient, bool newStatus);
 
+/**
+ * @brief Get the keepalive ping interval
+ *
+ * With the adaptive keepalive this is the interval learned on the current network,
+ * which can be stored and given back with aws_iot_mqtt_set_keepalive_interval on a later run
+ *
+ * @param pClient Reference to the IoT Client
+ *
+ * @return uint16_t the ping interval in seconds, 0 when not connected yet or keepalive is off
+ */
+uint16_t aws_iot_mqtt_get_keepalive_interval(AWS_IoT_Client *pClient);
+
+/**
+ * @brief Set the keepalive ping interval of the adaptive keepalive
+ *
+ * Starts the adaptive keepalive from an interval learned before instead of probing up from
+ * AWS_IOT_MQTT_MIN_KEEPALIVE_INTERVAL. The interval is capped by the keepalive sent on connect
+ * and applies from the next ping.
+ *
+ * @param pClient Reference to the IoT Client
+ * @param intervalInSec Ping interval in seconds
+ *
+ * @return IoT_Error_t Type defining successful/failed API call, FAILURE when the adaptive keepalive is off
+ */
+IoT_Error_t aws_iot_mqtt_set_keepalive_interval(AWS_IoT_Client *pClient, uint16_t intervalInSec);
+
 /**
  * @brief Get count of Network Disconnects
  *
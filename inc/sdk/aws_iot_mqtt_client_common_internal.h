@@ -118,6 +118,38 @@ IoT_Error_t aws_iot_mqtt_internal_deserialize_publish(uint8_t *dup, QoS *qos,
 
 IoT_Error_t aws_iot_mqtt_set_client_state(AWS_IoT_Client *pClient, ClientState expectedCurrentState,
 										  ClientState newState);
+void aws_iot_mqtt_internal_reset_inbound_window(AWS_IoT_Client *pClient);
+void aws_iot_mqtt_internal_adapt_keep_alive(AWS_IoT_Client *pClient, bool isLinkLost);
+uint16_t aws_iot_mqtt_internal_tcp_keep_alive_idle(AWS_IoT_Client *pClient);
+void aws_iot_mqtt_internal_update_tcp_keep_alive(AWS_IoT_Client *pClient);
+
+/**
+ * SUBSCRIBE packets for the registered topic filters, serialized in as few
+ * writes as possible and acknowledged by one round of SUBACKs. The connect
+ * path appends them to the CONNECT packet.
+ */
+typedef struct {
+	uint32_t topicCount;										/**< registered filters */
+	uint32_t nextTopic;											/**< first filter not serialized yet */
+	uint32_t packetCount;										/**< SUBSCRIBE packets serialized so far */
+	bool isSessionResume;										/**< only sent when the server kept no session */
+	const char *topicList[AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS];
+	uint16_t topicLenList[AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS];
+	QoS qosList[AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS];
+	uint32_t handlerIndex[AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS];	/**< message handler slot of each filter */
+	QoS grantedQoS[AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS];		/**< from the SUBACKs, QOS_SUBACK_FAILURE until acknowledged */
+	uint16_t packetIdList[AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS];
+	uint32_t packetFirstTopic[AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS];
+	uint32_t packetTopicCount[AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS];
+} MQTTSubscribeBatch;
+
+void aws_iot_mqtt_internal_subscribe_batch_init(AWS_IoT_Client *pClient, MQTTSubscribeBatch *pBatch);
+IoT_Error_t aws_iot_mqtt_internal_subscribe_batch_serialize(AWS_IoT_Client *pClient, MQTTSubscribeBatch *pBatch,
+															size_t offset, size_t *pSerializedLen);
+IoT_Error_t aws_iot_mqtt_internal_subscribe_batch_send(AWS_IoT_Client *pClient, MQTTSubscribeBatch *pBatch,
+													   Timer *pTimer);
+IoT_Error_t aws_iot_mqtt_internal_subscribe_batch_wait(AWS_IoT_Client *pClient, MQTTSubscribeBatch *pBatch,
+													   Timer *pTimer);
 
 #ifdef _ENABLE_THREAD_SUPPORT_
 
@@ -93,6 +93,27 @@ IoT_Error_t aws_iot_mqtt_init(AWS_IoT_Client *pClient, IoT_Client_Init_Params *p
  */
 IoT_Error_t aws_iot_mqtt_connect(AWS_IoT_Client *pClient, IoT_Client_Connect_Params *pConnectParams);
 
+/**
+ * @brief MQTT Connection Function with pipelined subscriptions
+ *
+ * Called to establish an MQTT connection with the AWS IoT Service and subscribe to the
+ * given topic filters in the same round trip. The SUBSCRIBE is written together with the
+ * CONNECT packet instead of after the CONNACK.
+ * @note Call is blocking.  The call returns after the receipt of the CONNACK and SUBACK control packets.
+ * Refused filters are reported with a granted QoS of QOS_SUBACK_FAILURE and are not registered.
+ * If the connection fails none of the given filters stay registered.
+ * @warning The topic filters and handler data need to be static in memory.
+ *
+ * @param pClient Reference to the IoT Client
+ * @param pConnectParams Pointer to MQTT connection parameters
+ * @param pSubscriptions Array of filters and handlers, granted QoS is returned in it
+ * @param subscriptionCount Number of entries in pSubscriptions
+ *
+ * @return An IoT Error Type defining successful/failed connection
+ */
+IoT_Error_t aws_iot_mqtt_connect_subscribe(AWS_IoT_Client *pClient, IoT_Client_Connect_Params *pConnectParams,
+										   IoT_MQTT_Subscription *pSubscriptions, uint32_t subscriptionCount);
+
 /**
  * @brief Publish an MQTT message on a topic
  *
@@ -132,6 +153,25 @@ IoT_Error_t aws_iot_mqtt_publish(AWS_IoT_Client *pClient, const char *pTopicName
 IoT_Error_t aws_iot_mqtt_subscribe(AWS_IoT_Client *pClient, const char *pTopicName, uint16_t topicNameLen,
 								   QoS qos, pApplicationHandler_t pApplicationHandler, void *pApplicationHandlerData);
 
+/**
+ * @brief Subscribe to several MQTT topics at once.
+ *
+ * Called to send a single subscribe message to the broker requesting subscriptions
+ * to all the given topic filters.
+ * @note Call is blocking.  The call returns after the receipt of the SUBACK control packet.
+ * Filters the broker refused are reported with a granted QoS of QOS_SUBACK_FAILURE and
+ * are not registered, the others are.
+ * @warning The topic filters and handler data need to be static in memory.
+ *
+ * @param pClient Reference to the IoT Client
+ * @param pSubscriptions Array of filters and handlers, granted QoS is returned in it
+ * @param subscriptionCount Number of entries in pSubscriptions
+ *
+ * @return An IoT Error Type defining successful/failed subscription
+ */
+IoT_Error_t aws_iot_mqtt_subscribe_multi(AWS_IoT_Client *pClient, IoT_MQTT_Subscription *pSubscriptions,
+										 uint32_t subscriptionCount);
+
 /**
  * @brief Subscribe to an MQTT topic.
  *
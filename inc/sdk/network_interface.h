@@ -55,6 +55,7 @@ typedef struct {
 	uint16_t DestinationPort;            ///< Integer defining the connection port of the MQTT service.
 	uint32_t timeout_ms;                ///< Unsigned integer defining the TLS handshake timeout value in milliseconds.
 	bool ServerVerificationFlag;        ///< Boolean.  True = perform server certificate hostname validation.  False = skip validation \b NOT recommended.
+	uint16_t keepAliveIdleSec;            ///< Idle seconds before the first TCP keepalive probe.  0 = TCP keepalive off.
 } TLSConnectParams;
 
 /**
@@ -70,6 +71,7 @@ struct Network {
 	IoT_Error_t (*disconnect)(Network *);    ///< Function pointer pointing to the network function to disconnect from the network
 	IoT_Error_t (*isConnected)(Network *);    ///< Function pointer pointing to the network function to check if TLS is connected
 	IoT_Error_t (*destroy)(Network *);        ///< Function pointer pointing to the network function to destroy the network object
+	IoT_Error_t (*setKeepAlive)(Network *, uint16_t);    ///< Function pointer pointing to the network function to change the TCP keepalive of the connection
 
 	TLSConnectParams tlsConnectParams;        ///< TLSConnect params structure containing the common connection parameters
 	TLSDataParams tlsDataParams;            ///< TLSData params structure containing the connection data parameters that are specific to the library being used
@@ -160,6 +162,17 @@ IoT_Error_t iot_tls_destroy(Network *pNetwork);
  */
 IoT_Error_t iot_tls_is_connected(Network *pNetwork);
 
+/**
+ * @brief Change the TCP keepalive of the connection
+ *
+ * Applies to the open connection, if any, and to the following ones.
+ *
+ * @param Network - Pointer to a Network struct defining the network interface
+ * @param idleSec - Idle seconds before the first TCP keepalive probe, 0 turns TCP keepalive off
+ * @return IoT_Error_t - successful change or TLS error code
+ */
+IoT_Error_t iot_tls_set_keepalive(Network *pNetwork, uint16_t idleSec);
+
 #ifdef __cplusplus
 }
 #endif
@@ -19,6 +19,10 @@ extern "C" {
 
 #include <stdbool.h>
 #include <string.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include "aws_iot_config.h"
 #include "sdk/timer_platform.h"
 #include "sdk/network_interface.h"
 
@@ -84,14 +88,76 @@ IoT_Error_t iot_tls_init(Network *pNetwork, char *pRootCALocation, char *pDevice
 	pNetwork->disconnect = iot_tls_disconnect;
 	pNetwork->isConnected = iot_tls_is_connected;
 	pNetwork->destroy = iot_tls_destroy;
+	pNetwork->setKeepAlive = iot_tls_set_keepalive;
 
+	pNetwork->tlsConnectParams.keepAliveIdleSec = 0;
 	pNetwork->tlsDataParams.flags = 0;
 
 	return SUCCESS;
 }
 
+/*
+ * Let the kernel find a dead link. Keepalive probes find an idle one idleSec after the last
+ * traffic instead of at the next MQTT ping. Failures are not fatal, the MQTT keepalive still applies.
+ */
+static void _iot_tls_set_keepalive(int fd, uint16_t idleSec) {
+	int on = (0 != idleSec);
+	int idle = idleSec;
+	int interval = AWS_IOT_TCP_KEEPALIVE_INTERVAL;
+	int count = AWS_IOT_TCP_KEEPALIVE_COUNT;
+
+	if(0 != setsockopt(fd, SOL_SOCKET, SO_KEEPALIVE, &on, sizeof(on)) ||
+	   (on && (0 != setsockopt(fd, IPPROTO_TCP, TCP_KEEPIDLE, &idle, sizeof(idle)) ||
+			   0 != setsockopt(fd, IPPROTO_TCP, TCP_KEEPINTVL, &interval, sizeof(interval)) ||
+			   0 != setsockopt(fd, IPPROTO_TCP, TCP_KEEPCNT, &count, sizeof(count))))) {
+		IOT_WARN(" TCP keepalive not set on the socket\n");
+	}
+}
+
+/*
+ * The user timeout drops the connection soon after a write, such as a PINGREQ, went
+ * unacknowledged instead of a full ping interval later.
+ */
+static void _iot_tls_set_user_timeout(int fd) {
+	unsigned int userTimeout = AWS_IOT_TCP_USER_TIMEOUT;
+
+	if(0 != setsockopt(fd, IPPROTO_TCP, TCP_USER_TIMEOUT, &userTimeout, sizeof(userTimeout))) {
+		IOT_WARN(" TCP user timeout not set on the socket\n");
+	}
+}
+
+IoT_Error_t iot_tls_set_keepalive(Network *pNetwork, uint16_t idleSec) {
+	int fd = pNetwork->tlsDataParams.server_fd.fd;
+
+	pNetwork->tlsConnectParams.keepAliveIdleSec = idleSec;
+	if(fd >= 0) {
+		_iot_tls_set_keepalive(fd, idleSec);
+	}
+
+	return SUCCESS;
+}
+
 IoT_Error_t iot_tls_is_connected(Network *pNetwork) {
-	/* Use this to add implementation which can check for physical layer disconnect */
+	int fd = pNetwork->tlsDataParams.server_fd.fd;
+	int error = 0;
+	socklen_t len = sizeof(error);
+	struct tcp_info info;
+
+	/* No socket yet or any more, a reconnect may be tried */
+	if(fd < 0) {
+		return NETWORK_PHYSICAL_LAYER_CONNECTED;
+	}
+
+	/* Set by a failed keepalive probe or an expired user timeout */
+	if(0 == getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &len) && 0 != error) {
+		return NETWORK_PHYSICAL_LAYER_DISCONNECTED;
+	}
+
+	len = sizeof(info);
+	if(0 == getsockopt(fd, IPPROTO_TCP, TCP_INFO, &info, &len) && TCP_ESTABLISHED != info.tcpi_state) {
+		return NETWORK_PHYSICAL_LAYER_DISCONNECTED;
+	}
+
 	return NETWORK_PHYSICAL_LAYER_CONNECTED;
 }
 
@@ -179,6 +245,9 @@ IoT_Error_t iot_tls_connect(Network *pNetwork, TLSConnectParams *params) {
 		return SSL_CONNECTION_ERROR;
 	} IOT_DEBUG(" ok\n");
 
+	_iot_tls_set_keepalive(tlsDataParams->server_fd.fd, pNetwork->tlsConnectParams.keepAliveIdleSec);
+	_iot_tls_set_user_timeout(tlsDataParams->server_fd.fd);
+
 	IOT_DEBUG("  . Setting up the SSL/TLS structure...");
 	if((ret = mbedtls_ssl_config_defaults(&(tlsDataParams->conf), MBEDTLS_SSL_IS_CLIENT, MBEDTLS_SSL_TRANSPORT_STREAM,
 										  MBEDTLS_SSL_PRESET_DEFAULT)) != 0) {
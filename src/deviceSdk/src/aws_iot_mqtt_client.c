@@ -43,6 +43,7 @@ extern "C" {
 
 #include "sdk/aws_iot_log.h"
 #include "sdk/aws_iot_mqtt_client_interface.h"
+#include "sdk/aws_iot_mqtt_client_common_internal.h"
 #include "sdk/aws_iot_version.h"
 
 #if !DISABLE_METRICS
@@ -229,8 +230,18 @@ IoT_Error_t aws_iot_mqtt_init(AWS_IoT_Client *pClient, IoT_Client_Init_Params *p
 	pClient->clientData.counterNetworkDisconnected = 0;
 	pClient->clientData.disconnectHandler = pInitParams->disconnectHandler;
 	pClient->clientData.disconnectHandlerData = pInitParams->disconnectHandlerData;
+	pClient->clientData.packetReadHandler = NULL;
+	pClient->clientData.packetReadHandlerData = NULL;
+	pClient->clientData.dispatchHandler = pInitParams->dispatchHandler;
+	pClient->clientData.dispatchHandlerData = pInitParams->dispatchHandlerData;
+	pClient->clientData.isAdaptiveKeepAliveEnabled = pInitParams->isAdaptiveKeepAliveEnabled;
+	pClient->clientData.keepAliveInterval = 0;
+	pClient->clientData.keepAliveCeiling = 0;
+	pClient->clientData.keepAliveStableCount = 0;
 	pClient->clientData.nextPacketId = 1;
 
+	aws_iot_mqtt_internal_reset_inbound_window(pClient);
+
 	/* Initialize default connection options */
 	rc = aws_iot_mqtt_set_connect_params(pClient, &default_options);
 	if(SUCCESS != rc) {
@@ -258,6 +269,7 @@ IoT_Error_t aws_iot_mqtt_init(AWS_IoT_Client *pClient, IoT_Client_Init_Params *p
 
 	pClient->clientStatus.isPingOutstanding = 0;
 	pClient->clientStatus.isAutoReconnectEnabled = pInitParams->enableAutoReconnect;
+	pClient->clientStatus.isSessionPresent = false;
 
 	rc = iot_tls_init(&(pClient->networkStack), pInitParams->pRootCALocation, pInitParams->pDeviceCertLocation,
 					  pInitParams->pDevicePrivateKeyLocation, pInitParams->pHostURL, pInitParams->port,
@@ -354,6 +366,53 @@ IoT_Error_t aws_iot_mqtt_set_disconnect_handler(AWS_IoT_Client *pClient, iot_dis
 	FUNC_EXIT_RC(SUCCESS);
 }
 
+IoT_Error_t aws_iot_mqtt_set_packet_read_handler(AWS_IoT_Client *pClient, iot_packet_read_handler pPacketReadHandler,
+												 void *pPacketReadHandlerData) {
+	FUNC_ENTRY;
+	if(NULL == pClient) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	pClient->clientData.packetReadHandler = pPacketReadHandler;
+	pClient->clientData.packetReadHandlerData = pPacketReadHandlerData;
+	FUNC_EXIT_RC(SUCCESS);
+}
+
+uint16_t aws_iot_mqtt_get_keepalive_interval(AWS_IoT_Client *pClient) {
+	if(NULL == pClient) {
+		return 0;
+	}
+
+	return pClient->clientData.keepAliveInterval;
+}
+
+IoT_Error_t aws_iot_mqtt_set_keepalive_interval(AWS_IoT_Client *pClient, uint16_t intervalInSec) {
+	FUNC_ENTRY;
+	if(NULL == pClient) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	if(!pClient->clientData.isAdaptiveKeepAliveEnabled) {
+		FUNC_EXIT_RC(FAILURE);
+	}
+
+	if(AWS_IOT_MQTT_MIN_KEEPALIVE_INTERVAL > intervalInSec) {
+		intervalInSec = AWS_IOT_MQTT_MIN_KEEPALIVE_INTERVAL;
+	}
+
+	/* once connected the interval stays within the keepalive the server was told */
+	if(aws_iot_mqtt_is_client_connected(pClient) &&
+	   intervalInSec > pClient->clientData.options.keepAliveIntervalInSec) {
+		intervalInSec = pClient->clientData.options.keepAliveIntervalInSec;
+	}
+
+	pClient->clientData.keepAliveInterval = intervalInSec;
+	pClient->clientData.keepAliveCeiling = 0;
+	pClient->clientData.keepAliveStableCount = 0;
+	aws_iot_mqtt_internal_update_tcp_keep_alive(pClient);
+	FUNC_EXIT_RC(SUCCESS);
+}
+
 uint32_t aws_iot_mqtt_get_network_disconnected_count(AWS_IoT_Client *pClient) {
 	return pClient->clientData.counterNetworkDisconnected;
 }
@@ -399,6 +399,10 @@ static IoT_Error_t _aws_iot_mqtt_internal_read_packet(AWS_IoT_Client *pClient, T
 	} else if(SUCCESS != rc) {
 		return rc;
 	}
+	if(NULL != pClient->clientData.packetReadHandler) {
+		pClient->clientData.packetReadHandler(pClient, MQTT_PACKET_READ_STARTED,
+											  pClient->clientData.packetReadHandlerData);
+	}
 
 	/* 2. read the remaining length.  This is variable in itself */
 	rc = _aws_iot_mqtt_internal_decode_packet_remaining_len(pClient, &offset, &rem_len, pTimer);
@@ -444,6 +448,10 @@ static IoT_Error_t _aws_iot_mqtt_internal_read_packet(AWS_IoT_Client *pClient, T
 
     /* Pack has been received, we can flush the buffers for next call. */
     aws_iot_mqtt_internal_flushBuffers( pClient );
+	if(NULL != pClient->clientData.packetReadHandler) {
+		pClient->clientData.packetReadHandler(pClient, MQTT_PACKET_READ_COMPLETE,
+											  pClient->clientData.packetReadHandlerData);
+	}
 	header.byte = pClient->clientData.readBuf[0];
 	*pPacketType = MQTT_HEADER_FIELD_TYPE(header.byte);
 
@@ -493,11 +501,12 @@ static IoT_Error_t _aws_iot_mqtt_internal_deliver_message(AWS_IoT_Client *pClien
 														  uint16_t topicNameLen,
 														  IoT_Publish_Message_Params *pMessageParams) {
 	uint32_t itr;
-	IoT_Error_t rc;
+	IoT_Error_t rc, deliverRc;
 	ClientState clientState;
 
 	FUNC_ENTRY;
 
+	deliverRc = SUCCESS;
 	if(NULL == pTopicName) {
 		FUNC_EXIT_RC(NULL_VALUE_ERROR);
 	}
@@ -516,7 +525,21 @@ static IoT_Error_t _aws_iot_mqtt_internal_deliver_message(AWS_IoT_Client *pClien
 				(strncmp(pTopicName, (char *) pClient->clientData.messageHandlers[itr].topicName, topicNameLen) == 0))
 			   || _aws_iot_mqtt_internal_is_topic_matched((char *) pClient->clientData.messageHandlers[itr].topicName,
 														  pTopicName, topicNameLen)) {
-				if(NULL != pClient->clientData.messageHandlers[itr].pApplicationHandler) {
+				if(NULL == pClient->clientData.messageHandlers[itr].pApplicationHandler) {
+					continue;
+				}
+				if(NULL != pClient->clientData.dispatchHandler) {
+					/* the handler runs later, the message is copied out of the read buffer */
+					rc = pClient->clientData.dispatchHandler(pClient,
+															 pClient->clientData.messageHandlers[itr].pApplicationHandler,
+															 pClient->clientData.messageHandlers[itr].pApplicationHandlerData,
+															 pTopicName, topicNameLen, pMessageParams,
+															 pClient->clientData.dispatchHandlerData);
+					if(SUCCESS != rc) {
+						IOT_ERROR("Dispatch of %.*s failed : %d", topicNameLen, pTopicName, rc);
+						deliverRc = rc;
+					}
+				} else {
 					pClient->clientData.messageHandlers[itr].pApplicationHandler(pClient, pTopicName, topicNameLen,
 																				 pMessageParams,
 																				 pClient->clientData.messageHandlers[itr].pApplicationHandlerData);
@@ -525,14 +548,153 @@ static IoT_Error_t _aws_iot_mqtt_internal_deliver_message(AWS_IoT_Client *pClien
 		}
 	}
 	rc = aws_iot_mqtt_set_client_state(pClient, CLIENT_STATE_CONNECTED_WAIT_FOR_CB_RETURN, clientState);
+	if(SUCCESS == rc) {
+		rc = deliverRc;
+	}
 
 	FUNC_EXIT_RC(rc);
 }
 
+/**
+ * @brief Forget the inbound QoS1 messages
+ *
+ * Called when the client is initialized and when the server starts a new session,
+ * the messages of the old one are not redelivered.
+ *
+ * @param pClient Reference to the IoT Client
+ */
+void aws_iot_mqtt_internal_reset_inbound_window(AWS_IoT_Client *pClient) {
+	uint32_t itr;
+
+	for(itr = 0; itr < AWS_IOT_MQTT_DEDUPE_WINDOW; itr++) {
+		pClient->clientData.inboundMessages[itr].packetId = 0;
+		pClient->clientData.inboundMessages[itr].hash = 0;
+	}
+	pClient->clientData.inboundMessageIndex = 0;
+}
+
+/**
+ * @brief FNV-1a hash of the topic and the payload of an inbound message
+ *
+ * @param pTopicName Topic of the message, not NULL terminated
+ * @param topicNameLen Length of the topic
+ * @param pMsg Deserialized message
+ *
+ * @return the 32 bit hash
+ */
+static uint32_t _aws_iot_mqtt_internal_message_hash(const char *pTopicName, uint16_t topicNameLen,
+													IoT_Publish_Message_Params *pMsg) {
+	const unsigned char *pPayload = (const unsigned char *) pMsg->payload;
+	uint32_t hash = 2166136261u;
+	size_t itr;
+
+	for(itr = 0; itr < topicNameLen; itr++) {
+		hash = (hash ^ (unsigned char) pTopicName[itr]) * 16777619u;
+	}
+	/* the separator keeps topic "a/b" + "c" apart from topic "a/bc" + "" */
+	hash = (hash ^ 0xFF) * 16777619u;
+	for(itr = 0; itr < pMsg->payloadLen; itr++) {
+		hash = (hash ^ pPayload[itr]) * 16777619u;
+	}
+
+	return hash;
+}
+
+/**
+ * @brief Find the dedupe window entry of a packet id
+ *
+ * @param pClient Reference to the IoT Client
+ * @param packetId Packet id of an inbound message
+ *
+ * @return the entry, NULL when the id is not in the window
+ */
+static InboundMessage *_aws_iot_mqtt_internal_find_inbound(AWS_IoT_Client *pClient, uint16_t packetId) {
+	uint32_t itr;
+
+	for(itr = 0; itr < AWS_IOT_MQTT_DEDUPE_WINDOW; itr++) {
+		if(pClient->clientData.inboundMessages[itr].packetId == packetId) {
+			return &pClient->clientData.inboundMessages[itr];
+		}
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief Check an inbound QoS1 message against the dedupe window
+ *
+ * A message with DUP set whose packet id and hash are in the window was delivered before and only its
+ * PUBACK got lost. Any other message is new.
+ *
+ * @param pClient Reference to the IoT Client
+ * @param pMsg Deserialized message
+ * @param hash Hash of the topic and the payload of the message
+ *
+ * @return true when the message was already delivered
+ */
+static bool _aws_iot_mqtt_internal_is_duplicate(AWS_IoT_Client *pClient, IoT_Publish_Message_Params *pMsg,
+												uint32_t hash) {
+	InboundMessage *pEntry = _aws_iot_mqtt_internal_find_inbound(pClient, pMsg->id);
+
+	/* the server only reuses an id without DUP after it got our PUBACK */
+	return NULL != pEntry && pEntry->hash == hash && 0 != pMsg->isDup;
+}
+
+/**
+ * @brief Add a delivered QoS1 message to the dedupe window
+ *
+ * It replaces the entry of its packet id, or the oldest one.
+ *
+ * @param pClient Reference to the IoT Client
+ * @param pMsg Deserialized message
+ * @param hash Hash of the topic and the payload of the message
+ */
+static void _aws_iot_mqtt_internal_add_inbound(AWS_IoT_Client *pClient, IoT_Publish_Message_Params *pMsg,
+											   uint32_t hash) {
+	InboundMessage *pEntry = _aws_iot_mqtt_internal_find_inbound(pClient, pMsg->id);
+
+	if(NULL == pEntry) {
+		pEntry = &pClient->clientData.inboundMessages[pClient->clientData.inboundMessageIndex];
+		pClient->clientData.inboundMessageIndex = (pClient->clientData.inboundMessageIndex + 1) % AWS_IOT_MQTT_DEDUPE_WINDOW;
+	}
+	pEntry->packetId = pMsg->id;
+	pEntry->hash = hash;
+}
+
+/**
+ * @brief Acknowledge an inbound QoS1 message
+ *
+ * @param pClient Reference to the IoT Client
+ * @param packetId Packet id of the message
+ * @param pTimer Timer of the read cycle
+ *
+ * @return An IoT Error Type defining successful/failed send of the PUBACK
+ */
+static IoT_Error_t _aws_iot_mqtt_internal_send_puback(AWS_IoT_Client *pClient, uint16_t packetId, Timer *pTimer) {
+	uint32_t len;
+	IoT_Error_t rc;
+
+	FUNC_ENTRY;
+
+	len = 0;
+	rc = aws_iot_mqtt_internal_serialize_ack(pClient->clientData.writeBuf, pClient->clientData.writeBufSize,
+											 PUBACK, 0, packetId, &len);
+	if(SUCCESS != rc) {
+		FUNC_EXIT_RC(rc);
+	}
+
+	rc = aws_iot_mqtt_internal_send_packet(pClient, len, pTimer);
+	if(SUCCESS != rc) {
+		FUNC_EXIT_RC(rc);
+	}
+
+	FUNC_EXIT_RC(SUCCESS);
+}
+
 static IoT_Error_t _aws_iot_mqtt_internal_handle_publish(AWS_IoT_Client *pClient, Timer *pTimer) {
 	char *topicName;
 	uint16_t topicNameLen;
-	uint32_t len;
+	uint32_t hash;
 	IoT_Error_t rc;
 	IoT_Publish_Message_Params msg;
 
@@ -540,7 +702,6 @@ static IoT_Error_t _aws_iot_mqtt_internal_handle_publish(AWS_IoT_Client *pClient
 
 	topicName = NULL;
 	topicNameLen = 0;
-	len = 0;
 
 	rc = aws_iot_mqtt_internal_deserialize_publish(&msg.isDup, &msg.qos, &msg.isRetained,
 												   &msg.id, &topicName, &topicNameLen,
@@ -552,30 +713,29 @@ static IoT_Error_t _aws_iot_mqtt_internal_handle_publish(AWS_IoT_Client *pClient
 		FUNC_EXIT_RC(rc);
 	}
 
-	rc = _aws_iot_mqtt_internal_deliver_message(pClient, topicName, topicNameLen, &msg);
-	if(SUCCESS != rc) {
-		FUNC_EXIT_RC(rc);
-	}
-
 	if(QOS0 == msg.qos) {
 		/* No further processing required for QoS0 */
-		FUNC_EXIT_RC(SUCCESS);
+		rc = _aws_iot_mqtt_internal_deliver_message(pClient, topicName, topicNameLen, &msg);
+		FUNC_EXIT_RC(rc);
 	}
 
 	/* Message assumed to be QoS1 since we do not support QoS2 at this time */
-	rc = aws_iot_mqtt_internal_serialize_ack(pClient->clientData.writeBuf, pClient->clientData.writeBufSize,
-											 PUBACK, 0, msg.id, &len);
-
-	if(SUCCESS != rc) {
-		FUNC_EXIT_RC(rc);
+	hash = _aws_iot_mqtt_internal_message_hash(topicName, topicNameLen, &msg);
+	if(_aws_iot_mqtt_internal_is_duplicate(pClient, &msg, hash)) {
+		/* delivered before, acknowledge it again */
+		IOT_DEBUG("Dropping redelivered PUBLISH %u", msg.id);
+	} else {
+		/* not acknowledged, so the server keeps the message and sends it again */
+		rc = _aws_iot_mqtt_internal_deliver_message(pClient, topicName, topicNameLen, &msg);
+		if(SUCCESS != rc) {
+			FUNC_EXIT_RC(rc);
+		}
+		_aws_iot_mqtt_internal_add_inbound(pClient, &msg, hash);
 	}
 
-	rc = aws_iot_mqtt_internal_send_packet(pClient, len, pTimer);
-	if(SUCCESS != rc) {
-		FUNC_EXIT_RC(rc);
-	}
+	rc = _aws_iot_mqtt_internal_send_puback(pClient, msg.id, pTimer);
 
-	FUNC_EXIT_RC(SUCCESS);
+	FUNC_EXIT_RC(rc);
 }
 
 IoT_Error_t aws_iot_mqtt_internal_cycle_read(AWS_IoT_Client *pClient, Timer *pTimer, uint8_t *pPacketType) {
@@ -630,6 +790,7 @@ IoT_Error_t aws_iot_mqtt_internal_cycle_read(AWS_IoT_Client *pClient, Timer *pTi
 			break;
 		case PINGRESP: {
 			pClient->clientStatus.isPingOutstanding = 0;
+			aws_iot_mqtt_internal_adapt_keep_alive(pClient, false);
 			countdown_sec(&pClient->pingTimer, pClient->clientData.keepAliveInterval);
 			break;
 		}
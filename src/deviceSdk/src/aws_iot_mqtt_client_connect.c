@@ -81,17 +81,17 @@ typedef union {
 typedef union {
 	uint8_t all;                            /**< all connack flags */
 #if defined(REVERSED)
-	struct
-	{
-		unsigned int sessionpresent : 1;	/**< session present flag */
-		unsigned int : 7;					/**< unused */
-	} bits;
-#else
 	struct {
 		unsigned int : 7;
 		/**< unused */
 		unsigned int sessionpresent : 1;    /**< session present flag */
 	} bits;
+#else
+	struct
+	{
+		unsigned int sessionpresent : 1;	/**< session present flag, bit 0 */
+		unsigned int : 7;					/**< unused */
+	} bits;
 #endif
 } MQTT_Connack_Header_Flags;
 /**< connack flags byte */
@@ -375,17 +375,26 @@ static bool _aws_iot_mqtt_is_client_state_valid_for_connect(ClientState clientSt
  * Called to establish an MQTT connection with the AWS IoT Service
  * This is the internal function which is called by the connect API to perform the operation.
  * Not meant to be called directly as it doesn't do validations or client state changes
+ * When a subscribe batch is given its SUBSCRIBE packets go out in the same write as the
+ * CONNECT packet, without waiting for the CONNACK, and their SUBACKs are collected after it.
+ * A refused CONNACK fails the connect as usual, the server drops the pipelined packets with
+ * the connection. A session resume batch instead waits for the CONNACK and is only sent when
+ * the server did not keep the session.
  *
  * @param pClient Reference to the IoT Client
  * @param pConnectParams Pointer to MQTT connection parameters
+ * @param pBatch Topic filters to subscribe in the same round trip, NULL for none
  *
  * @return An IoT Error Type defining successful/failed connection
  */
-static IoT_Error_t _aws_iot_mqtt_internal_connect(AWS_IoT_Client *pClient, IoT_Client_Connect_Params *pConnectParams) {
+static IoT_Error_t _aws_iot_mqtt_internal_connect(AWS_IoT_Client *pClient, IoT_Client_Connect_Params *pConnectParams,
+												  MQTTSubscribeBatch *pBatch) {
 	Timer connect_timer;
 	IoT_Error_t connack_rc = FAILURE;
 	char sessionPresent = 0;
 	size_t len = 0;
+	size_t subscribeLen = 0;
+	uint32_t itr;
 	IoT_Error_t rc = FAILURE;
 
 	FUNC_ENTRY;
@@ -398,6 +407,21 @@ static IoT_Error_t _aws_iot_mqtt_internal_connect(AWS_IoT_Client *pClient, IoT_C
 		}
 	}
 
+	if(pClient->clientData.isAdaptiveKeepAliveEnabled) {
+		/* the learned ping interval survives reconnects, probing starts from the shortest one */
+		if(0 == pClient->clientData.keepAliveInterval) {
+			pClient->clientData.keepAliveInterval = AWS_IOT_MQTT_MIN_KEEPALIVE_INTERVAL;
+		}
+		if(pClient->clientData.keepAliveInterval > pClient->clientData.options.keepAliveIntervalInSec) {
+			pClient->clientData.keepAliveInterval = pClient->clientData.options.keepAliveIntervalInSec;
+		}
+	} else {
+		pClient->clientData.keepAliveInterval = pClient->clientData.options.keepAliveIntervalInSec;
+	}
+
+	/* applied by the network when it opens the socket */
+	pClient->networkStack.tlsConnectParams.keepAliveIdleSec = aws_iot_mqtt_internal_tcp_keep_alive_idle(pClient);
+
 	rc = pClient->networkStack.connect(&(pClient->networkStack), NULL);
 	if(SUCCESS != rc) {
 		/* TLS Connect failed, return error */
@@ -407,19 +431,34 @@ static IoT_Error_t _aws_iot_mqtt_internal_connect(AWS_IoT_Client *pClient, IoT_C
 	init_timer(&connect_timer);
 	countdown_ms(&connect_timer, pClient->clientData.commandTimeoutMs);
 
-	pClient->clientData.keepAliveInterval = pClient->clientData.options.keepAliveIntervalInSec;
 	rc = _aws_iot_mqtt_serialize_connect(pClient->clientData.writeBuf, pClient->clientData.writeBufSize,
 										 &(pClient->clientData.options), &len);
 	if(SUCCESS != rc || 0 >= len) {
 		FUNC_EXIT_RC(rc);
 	}
 
+	/* as many SUBSCRIBEs as fit ride along with the CONNECT */
+	if(NULL != pBatch && !pBatch->isSessionResume) {
+		rc = aws_iot_mqtt_internal_subscribe_batch_serialize(pClient, pBatch, len, &subscribeLen);
+		if(SUCCESS != rc) {
+			FUNC_EXIT_RC(rc);
+		}
+		len += subscribeLen;
+	}
+
 	/* send the connect packet */
 	rc = aws_iot_mqtt_internal_send_packet(pClient, len, &connect_timer);
 	if(SUCCESS != rc) {
 		FUNC_EXIT_RC(rc);
 	}
 
+	if(NULL != pBatch && !pBatch->isSessionResume) {
+		rc = aws_iot_mqtt_internal_subscribe_batch_send(pClient, pBatch, &connect_timer);
+		if(SUCCESS != rc) {
+			FUNC_EXIT_RC(rc);
+		}
+	}
+
 	/* this will be a blocking call, wait for the CONNACK */
 	rc = aws_iot_mqtt_internal_wait_for_read(pClient, CONNACK, &connect_timer);
 	if(SUCCESS != rc) {
@@ -437,6 +476,33 @@ static IoT_Error_t _aws_iot_mqtt_internal_connect(AWS_IoT_Client *pClient, IoT_C
 		FUNC_EXIT_RC(connack_rc);
 	}
 
+	pClient->clientStatus.isSessionPresent = (0 != sessionPresent);
+	if(!pClient->clientStatus.isSessionPresent) {
+		aws_iot_mqtt_internal_reset_inbound_window(pClient);
+	}
+
+	if(NULL != pBatch && pBatch->isSessionResume) {
+		if(pClient->clientStatus.isSessionPresent) {
+			/* the server kept the subscriptions */
+			for(itr = 0; itr < pBatch->topicCount; itr++) {
+				pBatch->grantedQoS[itr] = pBatch->qosList[itr];
+			}
+			pBatch = NULL;
+		} else {
+			rc = aws_iot_mqtt_internal_subscribe_batch_send(pClient, pBatch, &connect_timer);
+			if(SUCCESS != rc) {
+				FUNC_EXIT_RC(rc);
+			}
+		}
+	}
+
+	if(NULL != pBatch) {
+		rc = aws_iot_mqtt_internal_subscribe_batch_wait(pClient, pBatch, &connect_timer);
+		if(SUCCESS != rc) {
+			FUNC_EXIT_RC(rc);
+		}
+	}
+
 	pClient->clientStatus.isPingOutstanding = false;
 	countdown_sec(&pClient->pingTimer, pClient->clientData.keepAliveInterval);
 
@@ -446,23 +512,21 @@ static IoT_Error_t _aws_iot_mqtt_internal_connect(AWS_IoT_Client *pClient, IoT_C
 /**
  * @brief MQTT Connection Function
  *
- * Called to establish an MQTT connection with the AWS IoT Service
- * This is the outer function which does the validations and calls the internal connect above
- * to perform the actual operation. It is also responsible for client state changes
+ * Validates the client state, connects and does the client state changes.
+ * Shared by the connect APIs and the reconnect.
  *
  * @param pClient Reference to the IoT Client
  * @param pConnectParams Pointer to MQTT connection parameters
+ * @param pBatch Topic filters to subscribe in the same round trip, NULL for none
  *
  * @return An IoT Error Type defining successful/failed connection
  */
-IoT_Error_t aws_iot_mqtt_connect(AWS_IoT_Client *pClient, IoT_Client_Connect_Params *pConnectParams) {
+static IoT_Error_t _aws_iot_mqtt_connect(AWS_IoT_Client *pClient, IoT_Client_Connect_Params *pConnectParams,
+										 MQTTSubscribeBatch *pBatch) {
 	IoT_Error_t rc, disconRc;
 	ClientState clientState;
 	FUNC_ENTRY;
 
-	if(NULL == pClient) {
-		FUNC_EXIT_RC(NULL_VALUE_ERROR);
-	}
     aws_iot_mqtt_internal_flushBuffers( pClient );
 	clientState = aws_iot_mqtt_get_client_state(pClient);
 
@@ -474,7 +538,7 @@ IoT_Error_t aws_iot_mqtt_connect(AWS_IoT_Client *pClient, IoT_Client_Connect_Par
 
 	aws_iot_mqtt_set_client_state(pClient, clientState, CLIENT_STATE_CONNECTING);
 
-	rc = _aws_iot_mqtt_internal_connect(pClient, pConnectParams);
+	rc = _aws_iot_mqtt_internal_connect(pClient, pConnectParams, pBatch);
 
 	if(SUCCESS != rc) {
 		pClient->networkStack.disconnect(&(pClient->networkStack));
@@ -490,6 +554,110 @@ IoT_Error_t aws_iot_mqtt_connect(AWS_IoT_Client *pClient, IoT_Client_Connect_Par
 	FUNC_EXIT_RC(rc);
 }
 
+/**
+ * @brief MQTT Connection Function
+ *
+ * Called to establish an MQTT connection with the AWS IoT Service
+ * This is the outer function which does the validations and calls the internal connect above
+ * to perform the actual operation. It is also responsible for client state changes
+ *
+ * @param pClient Reference to the IoT Client
+ * @param pConnectParams Pointer to MQTT connection parameters
+ *
+ * @return An IoT Error Type defining successful/failed connection
+ */
+IoT_Error_t aws_iot_mqtt_connect(AWS_IoT_Client *pClient, IoT_Client_Connect_Params *pConnectParams) {
+	FUNC_ENTRY;
+
+	if(NULL == pClient) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	FUNC_EXIT_RC(_aws_iot_mqtt_connect(pClient, pConnectParams, NULL));
+}
+
+/**
+ * @brief MQTT Connection Function with pipelined subscriptions
+ *
+ * Called to establish an MQTT connection and subscribe in a single round trip.
+ * The SUBSCRIBE for the given filters, and for any filters still registered on the client,
+ * is written together with the CONNECT packet. The call returns after the CONNACK and the
+ * SUBACKs were received. Refused filters get QOS_SUBACK_FAILURE and are not registered.
+ * On any failure, including a refused CONNACK, none of the given filters stay registered.
+ *
+ * @param pClient Reference to the IoT Client
+ * @param pConnectParams Pointer to MQTT connection parameters
+ * @param pSubscriptions Array of filters and handlers, granted QoS is returned in it
+ * @param subscriptionCount Number of entries in pSubscriptions
+ *
+ * @return An IoT Error Type defining successful/failed connection
+ */
+IoT_Error_t aws_iot_mqtt_connect_subscribe(AWS_IoT_Client *pClient, IoT_Client_Connect_Params *pConnectParams,
+										   IoT_MQTT_Subscription *pSubscriptions, uint32_t subscriptionCount) {
+	MQTTSubscribeBatch batch;
+	uint32_t slot[AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS];
+	uint32_t itr, count, i;
+	MessageHandlers *pHandler;
+	IoT_Error_t rc;
+
+	FUNC_ENTRY;
+
+	if(NULL == pClient || (NULL == pSubscriptions && 0 != subscriptionCount)) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	for(itr = 0; itr < subscriptionCount; itr++) {
+		if(NULL == pSubscriptions[itr].pTopicName || NULL == pSubscriptions[itr].pApplicationHandler) {
+			FUNC_EXIT_RC(NULL_VALUE_ERROR);
+		}
+	}
+
+	/* register the filters up front, the batch is built from the registered handlers */
+	count = 0;
+	for(itr = 0; itr < AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS && count < subscriptionCount; itr++) {
+		if(NULL == pClient->clientData.messageHandlers[itr].topicName) {
+			slot[count++] = itr;
+		}
+	}
+	if(count < subscriptionCount) {
+		FUNC_EXIT_RC(MQTT_MAX_SUBSCRIPTIONS_REACHED_ERROR);
+	}
+
+	for(itr = 0; itr < subscriptionCount; itr++) {
+		pHandler = &pClient->clientData.messageHandlers[slot[itr]];
+		pHandler->topicName = pSubscriptions[itr].pTopicName;
+		pHandler->topicNameLen = pSubscriptions[itr].topicNameLen;
+		pHandler->pApplicationHandler = pSubscriptions[itr].pApplicationHandler;
+		pHandler->pApplicationHandlerData = pSubscriptions[itr].pApplicationHandlerData;
+		pHandler->qos = pSubscriptions[itr].qos;
+		pSubscriptions[itr].grantedQoS = QOS_SUBACK_FAILURE;
+	}
+
+	aws_iot_mqtt_internal_subscribe_batch_init(pClient, &batch);
+	rc = _aws_iot_mqtt_connect(pClient, pConnectParams, 0 < batch.topicCount ? &batch : NULL);
+
+	for(itr = 0; itr < subscriptionCount; itr++) {
+		if(SUCCESS == rc) {
+			for(i = 0; i < batch.topicCount; i++) {
+				if(batch.handlerIndex[i] == slot[itr]) {
+					pSubscriptions[itr].grantedQoS = batch.grantedQoS[i];
+					break;
+				}
+			}
+		}
+
+		if(SUCCESS != rc || QOS_SUBACK_FAILURE == pSubscriptions[itr].grantedQoS) {
+			pHandler = &pClient->clientData.messageHandlers[slot[itr]];
+			pHandler->topicName = NULL;
+			pHandler->pApplicationHandler = NULL;
+			pHandler->pApplicationHandlerData = NULL;
+			pHandler->qos = QOS0;
+		}
+	}
+
+	FUNC_EXIT_RC(rc);
+}
+
 /**
  * @brief Disconnect an MQTT Connection
  *
@@ -593,7 +761,8 @@ IoT_Error_t aws_iot_mqtt_disconnect(AWS_IoT_Client *pClient) {
  * @return An IoT Error Type defining successful/failed connection
  */
 IoT_Error_t aws_iot_mqtt_attempt_reconnect(AWS_IoT_Client *pClient) {
-	IoT_Error_t rc;
+	MQTTSubscribeBatch batch;
+	uint32_t itr;
 
 	FUNC_ENTRY;
 
@@ -605,8 +774,13 @@ IoT_Error_t aws_iot_mqtt_attempt_reconnect(AWS_IoT_Client *pClient) {
 		FUNC_EXIT_RC(NETWORK_ALREADY_CONNECTED_ERROR);
 	}
 
+	/* the registered filters are resubscribed in the same round trip as the CONNECT,
+	 * or after the CONNACK when a persistent session may have kept them */
+	aws_iot_mqtt_internal_subscribe_batch_init(pClient, &batch);
+	batch.isSessionResume = !pClient->clientData.options.isCleanSession;
+
 	/* Ignoring return code. failures expected if network is disconnected */
-	rc = aws_iot_mqtt_connect(pClient, NULL);
+	(void)_aws_iot_mqtt_connect(pClient, NULL, 0 < batch.topicCount ? &batch : NULL);
 
 	/* If still disconnected handle disconnect */
 	if(CLIENT_STATE_CONNECTED_IDLE != aws_iot_mqtt_get_client_state(pClient)) {
@@ -614,9 +788,10 @@ IoT_Error_t aws_iot_mqtt_attempt_reconnect(AWS_IoT_Client *pClient) {
 		FUNC_EXIT_RC(NETWORK_ATTEMPTING_RECONNECT);
 	}
 
-	rc = aws_iot_mqtt_resubscribe(pClient);
-	if(SUCCESS != rc) {
-		FUNC_EXIT_RC(rc);
+	for(itr = 0; itr < batch.topicCount; itr++) {
+		if(QOS_SUBACK_FAILURE == batch.grantedQoS[itr]) {
+			IOT_WARN("Resubscribe refused for %.*s", batch.topicLenList[itr], batch.topicList[itr]);
+		}
 	}
 
 	FUNC_EXIT_RC(NETWORK_RECONNECTED);
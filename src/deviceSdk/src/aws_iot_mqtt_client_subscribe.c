@@ -160,7 +160,7 @@ static IoT_Error_t _aws_iot_mqtt_deserialize_suback(uint16_t *pPacketId, uint32_
 
 	*pGrantedQoSCount = 0;
 	while(curData < endData) {
-		if(*pGrantedQoSCount > maxExpectedQoSCount) {
+		if(*pGrantedQoSCount >= maxExpectedQoSCount) {
 			FUNC_EXIT_RC(FAILURE);
 		}
 		pGrantedQoSs[(*pGrantedQoSCount)++] = (QoS) aws_iot_mqtt_internal_read_char(&curData);
@@ -169,52 +169,55 @@ static IoT_Error_t _aws_iot_mqtt_deserialize_suback(uint16_t *pPacketId, uint32_
 	FUNC_EXIT_RC(SUCCESS);
 }
 
-/* Returns MAX_MESSAGE_HANDLERS value if no free index is available */
-static uint32_t _aws_iot_mqtt_get_free_message_handler_index(AWS_IoT_Client *pClient) {
-	uint32_t itr;
-
-	FUNC_ENTRY;
-
-	for(itr = 0; itr < AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS; itr++) {
-		if(pClient->clientData.messageHandlers[itr].topicName == NULL) {
-			break;
-		}
-	}
-
-	FUNC_EXIT_RC(itr);
-}
-
 /**
- * @brief Subscribe to an MQTT topic.
+ * @brief Subscribe to MQTT topics.
  *
- * Called to send a subscribe message to the broker requesting a subscription
- * to an MQTT topic. This is the internal function which is called by the
- * subscribe API to perform the operation. Not meant to be called directly as
+ * Called to send a subscribe message to the broker requesting subscriptions
+ * to one or more MQTT topics in a single packet. This is the internal function which is called by the
+ * subscribe APIs to perform the operation. Not meant to be called directly as
  * it doesn't do validations or client state changes
  * @note Call is blocking.  The call returns after the receipt of the SUBACK control packet.
- * @warning pTopicName and pApplicationHandlerData need to be static in memory.
+ * @warning The topic filters and pApplicationHandlerData need to be static in memory.
  *
  * @param pClient Reference to the IoT Client
- * @param pTopicName Topic Name to publish to. pTopicName needs to be static in memory since 
- *     no malloc are performed by the SDK
- * @param topicNameLen Length of the topic name
- * @param pApplicationHandler_t Reference to the handler function for this subscription
- * @param pApplicationHandlerData Point to data passed to the callback. 
- *    pApplicationHandlerData also needs to be static in memory  since no malloc are performed by the SDK
+ * @param pSubscriptions Filters and handlers to register, the granted QoS is returned in them
+ * @param subscriptionCount Number of filters
  *
  * @return An IoT Error Type defining successful/failed subscription
  */
-static IoT_Error_t _aws_iot_mqtt_internal_subscribe(AWS_IoT_Client *pClient, const char *pTopicName,
-													uint16_t topicNameLen, QoS qos,
-													pApplicationHandler_t pApplicationHandler,
-													void *pApplicationHandlerData) {
+static IoT_Error_t _aws_iot_mqtt_internal_subscribe(AWS_IoT_Client *pClient, IoT_MQTT_Subscription *pSubscriptions,
+													uint32_t subscriptionCount) {
+	const char *topicList[AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS];
+	uint16_t topicLenList[AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS];
+	QoS qosList[AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS];
+	QoS grantedQoS[AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS];
+	uint32_t freeIndex[AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS];
 	uint16_t txPacketId, rxPacketId;
-	uint32_t serializedLen, indexOfFreeMessageHandler, count;
+	uint32_t serializedLen, count, freeCount, itr;
 	IoT_Error_t rc;
 	Timer timer;
-	QoS grantedQoS[3] = {QOS0, QOS0, QOS0};
+	MessageHandlers *pHandler;
 
 	FUNC_ENTRY;
+
+	/* every filter needs a free handler slot, checked before anything is sent */
+	freeCount = 0;
+	for(itr = 0; itr < AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS && freeCount < subscriptionCount; itr++) {
+		if(pClient->clientData.messageHandlers[itr].topicName == NULL) {
+			freeIndex[freeCount++] = itr;
+		}
+	}
+	if(freeCount < subscriptionCount) {
+		FUNC_EXIT_RC(MQTT_MAX_SUBSCRIPTIONS_REACHED_ERROR);
+	}
+
+	for(itr = 0; itr < subscriptionCount; itr++) {
+		topicList[itr] = pSubscriptions[itr].pTopicName;
+		topicLenList[itr] = pSubscriptions[itr].topicNameLen;
+		qosList[itr] = pSubscriptions[itr].qos;
+		pSubscriptions[itr].grantedQoS = QOS_SUBACK_FAILURE;
+	}
+
 	init_timer(&timer);
 	countdown_ms(&timer, pClient->clientData.commandTimeoutMs);
 
@@ -224,16 +227,12 @@ static IoT_Error_t _aws_iot_mqtt_internal_subscribe(AWS_IoT_Client *pClient, con
 	rxPacketId = 0;
 
 	rc = _aws_iot_mqtt_serialize_subscribe(pClient->clientData.writeBuf, pClient->clientData.writeBufSize, 0,
-										   txPacketId, 1, &pTopicName, &topicNameLen, &qos, &serializedLen);
+										   txPacketId, subscriptionCount, topicList, topicLenList, qosList,
+										   &serializedLen);
 	if(SUCCESS != rc) {
 		FUNC_EXIT_RC(rc);
 	}
 
-	indexOfFreeMessageHandler = _aws_iot_mqtt_get_free_message_handler_index(pClient);
-	if(AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS <= indexOfFreeMessageHandler) {
-		FUNC_EXIT_RC(MQTT_MAX_SUBSCRIPTIONS_REACHED_ERROR);
-	}
-
 	/* send the subscribe packet */
 	rc = aws_iot_mqtt_internal_send_packet(pClient, serializedLen, &timer);
 	if(SUCCESS != rc) {
@@ -246,9 +245,9 @@ static IoT_Error_t _aws_iot_mqtt_internal_subscribe(AWS_IoT_Client *pClient, con
 		FUNC_EXIT_RC(rc);
 	}
 
-	/* Granted QoS can be 0, 1 or 2 */
-	rc = _aws_iot_mqtt_deserialize_suback(&rxPacketId, 1, &count, grantedQoS, pClient->clientData.readBuf,
-										  pClient->clientData.readBufSize);
+	/* Granted QoS can be 0, 1 or 2, 0x80 is a failure */
+	rc = _aws_iot_mqtt_deserialize_suback(&rxPacketId, subscriptionCount, &count, grantedQoS,
+										  pClient->clientData.readBuf, pClient->clientData.readBufSize);
 	if(SUCCESS != rc) {
 		FUNC_EXIT_RC(rc);
 	}
@@ -260,50 +259,45 @@ static IoT_Error_t _aws_iot_mqtt_internal_subscribe(AWS_IoT_Client *pClient, con
 	//	return RX_MESSAGE_INVALID_ERROR;
 	//}
 
-	pClient->clientData.messageHandlers[indexOfFreeMessageHandler].topicName =
-			pTopicName;
-	pClient->clientData.messageHandlers[indexOfFreeMessageHandler].topicNameLen =
-			topicNameLen;
-	pClient->clientData.messageHandlers[indexOfFreeMessageHandler].pApplicationHandler =
-			pApplicationHandler;
-	pClient->clientData.messageHandlers[indexOfFreeMessageHandler].pApplicationHandlerData =
-			pApplicationHandlerData;
-	pClient->clientData.messageHandlers[indexOfFreeMessageHandler].qos = qos;
+	if(count != subscriptionCount) {
+		FUNC_EXIT_RC(FAILURE);
+	}
+
+	for(itr = 0; itr < subscriptionCount; itr++) {
+		pSubscriptions[itr].grantedQoS = grantedQoS[itr];
+		if(QOS_SUBACK_FAILURE == grantedQoS[itr]) {
+			continue;
+		}
+
+		pHandler = &pClient->clientData.messageHandlers[freeIndex[itr]];
+		pHandler->topicName = pSubscriptions[itr].pTopicName;
+		pHandler->topicNameLen = pSubscriptions[itr].topicNameLen;
+		pHandler->pApplicationHandler = pSubscriptions[itr].pApplicationHandler;
+		pHandler->pApplicationHandlerData = pSubscriptions[itr].pApplicationHandlerData;
+		pHandler->qos = pSubscriptions[itr].qos;
+	}
 
 	FUNC_EXIT_RC(SUCCESS);
 }
 
 /**
- * @brief Subscribe to an MQTT topic.
+ * @brief Validate the client and move it to the subscribe state, then subscribe.
  *
- * Called to send a subscribe message to the broker requesting a subscription
- * to an MQTT topic. This is the outer function which does the validations and
- * calls the internal subscribe above to perform the actual operation.
- * It is also responsible for client state changes
- * @note Call is blocking.  The call returns after the receipt of the SUBACK control packet.
- * @warning pTopicName and pApplicationHandlerData need to be static in memory.
+ * Shared by the single and multi-topic subscribe APIs.
  *
  * @param pClient Reference to the IoT Client
- * @param pTopicName Topic Name to publish to. pTopicName needs to be static in memory since 
- *     no malloc are performed by the SDK
- * @param topicNameLen Length of the topic name
- * @param pApplicationHandler_t Reference to the handler function for this subscription
- * @param pApplicationHandlerData Point to data passed to the callback. 
- *    pApplicationHandlerData also needs to be static in memory  since no malloc are performed by the SDK
+ * @param pSubscriptions Filters and handlers to register
+ * @param subscriptionCount Number of filters
  *
  * @return An IoT Error Type defining successful/failed subscription
  */
-IoT_Error_t aws_iot_mqtt_subscribe(AWS_IoT_Client *pClient, const char *pTopicName, uint16_t topicNameLen,
-								   QoS qos, pApplicationHandler_t pApplicationHandler, void *pApplicationHandlerData) {
+static IoT_Error_t _aws_iot_mqtt_subscribe(AWS_IoT_Client *pClient, IoT_MQTT_Subscription *pSubscriptions,
+										   uint32_t subscriptionCount) {
 	ClientState clientState;
 	IoT_Error_t rc, subRc;
 
 	FUNC_ENTRY;
 
-	if(NULL == pClient || NULL == pTopicName || NULL == pApplicationHandler) {
-		FUNC_EXIT_RC(NULL_VALUE_ERROR);
-	}
-
 	if(!aws_iot_mqtt_is_client_connected(pClient)) {
 		FUNC_EXIT_RC(NETWORK_DISCONNECTED_ERROR);
 	}
@@ -318,8 +312,7 @@ IoT_Error_t aws_iot_mqtt_subscribe(AWS_IoT_Client *pClient, const char *pTopicNa
 		FUNC_EXIT_RC(rc);
 	}
 
-	subRc = _aws_iot_mqtt_internal_subscribe(pClient, pTopicName, topicNameLen, qos,
-											 pApplicationHandler, pApplicationHandlerData);
+	subRc = _aws_iot_mqtt_internal_subscribe(pClient, pSubscriptions, subscriptionCount);
 
 	rc = aws_iot_mqtt_set_client_state(pClient, CLIENT_STATE_CONNECTED_SUBSCRIBE_IN_PROGRESS, clientState);
 	if(SUCCESS == subRc && SUCCESS != rc) {
@@ -333,64 +326,316 @@ IoT_Error_t aws_iot_mqtt_subscribe(AWS_IoT_Client *pClient, const char *pTopicNa
  * @brief Subscribe to an MQTT topic.
  *
  * Called to send a subscribe message to the broker requesting a subscription
- * to an MQTT topic.
- * This is the internal function which is called by the resubscribe API to perform the operation.
- * Not meant to be called directly as it doesn't do validations or client state changes
+ * to an MQTT topic. This is the outer function which does the validations and
+ * calls the internal subscribe above to perform the actual operation.
+ * It is also responsible for client state changes
  * @note Call is blocking.  The call returns after the receipt of the SUBACK control packet.
+ * @warning pTopicName and pApplicationHandlerData need to be static in memory.
  *
  * @param pClient Reference to the IoT Client
+ * @param pTopicName Topic Name to publish to. pTopicName needs to be static in memory since 
+ *     no malloc are performed by the SDK
+ * @param topicNameLen Length of the topic name
+ * @param pApplicationHandler_t Reference to the handler function for this subscription
+ * @param pApplicationHandlerData Point to data passed to the callback. 
+ *    pApplicationHandlerData also needs to be static in memory  since no malloc are performed by the SDK
  *
  * @return An IoT Error Type defining successful/failed subscription
  */
-static IoT_Error_t _aws_iot_mqtt_internal_resubscribe(AWS_IoT_Client *pClient) {
-	uint16_t packetId;
-	uint32_t len, count, existingSubCount, itr;
+IoT_Error_t aws_iot_mqtt_subscribe(AWS_IoT_Client *pClient, const char *pTopicName, uint16_t topicNameLen,
+								   QoS qos, pApplicationHandler_t pApplicationHandler, void *pApplicationHandlerData) {
+	IoT_MQTT_Subscription subscription;
 	IoT_Error_t rc;
-	Timer timer;
-	QoS grantedQoS[3] = {QOS0, QOS0, QOS0};
 
 	FUNC_ENTRY;
 
-	packetId = 0;
-	len = 0;
-	count = 0;
-	existingSubCount = _aws_iot_mqtt_get_free_message_handler_index(pClient);
+	if(NULL == pClient || NULL == pTopicName || NULL == pApplicationHandler) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	subscription.pTopicName = pTopicName;
+	subscription.topicNameLen = topicNameLen;
+	subscription.qos = qos;
+	subscription.pApplicationHandler = pApplicationHandler;
+	subscription.pApplicationHandlerData = pApplicationHandlerData;
+
+	rc = _aws_iot_mqtt_subscribe(pClient, &subscription, 1);
+	if(SUCCESS == rc && QOS_SUBACK_FAILURE == subscription.grantedQoS) {
+		rc = FAILURE;
+	}
+
+	FUNC_EXIT_RC(rc);
+}
+
+/**
+ * @brief Subscribe to several MQTT topics at once.
+ *
+ * Called to send a single subscribe message to the broker requesting subscriptions
+ * to all the given topic filters, with one round trip for all of them.
+ * @note Call is blocking.  The call returns after the receipt of the SUBACK control packet.
+ * @warning The topic filters and handler data need to be static in memory.
+ *
+ * @param pClient Reference to the IoT Client
+ * @param pSubscriptions Array of filters and handlers, granted QoS is returned in it
+ * @param subscriptionCount Number of entries in pSubscriptions
+ *
+ * @return An IoT Error Type defining successful/failed subscription
+ */
+IoT_Error_t aws_iot_mqtt_subscribe_multi(AWS_IoT_Client *pClient, IoT_MQTT_Subscription *pSubscriptions,
+										 uint32_t subscriptionCount) {
+	uint32_t itr;
+
+	FUNC_ENTRY;
+
+	if(NULL == pClient || NULL == pSubscriptions || 0 == subscriptionCount) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	if(AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS < subscriptionCount) {
+		FUNC_EXIT_RC(MQTT_MAX_SUBSCRIPTIONS_REACHED_ERROR);
+	}
+
+	for(itr = 0; itr < subscriptionCount; itr++) {
+		if(NULL == pSubscriptions[itr].pTopicName || NULL == pSubscriptions[itr].pApplicationHandler) {
+			FUNC_EXIT_RC(NULL_VALUE_ERROR);
+		}
+	}
 
-	for(itr = 0; itr < existingSubCount; itr++) {
+	FUNC_EXIT_RC(_aws_iot_mqtt_subscribe(pClient, pSubscriptions, subscriptionCount));
+}
+
+/**
+ * @brief Collect the registered topic filters into a subscribe batch.
+ *
+ * @param pClient Reference to the IoT Client
+ * @param pBatch Batch to initialize
+ */
+void aws_iot_mqtt_internal_subscribe_batch_init(AWS_IoT_Client *pClient, MQTTSubscribeBatch *pBatch) {
+	uint32_t itr;
+
+	pBatch->topicCount = 0;
+	pBatch->nextTopic = 0;
+	pBatch->packetCount = 0;
+	pBatch->isSessionResume = false;
+
+	for(itr = 0; itr < AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS; itr++) {
 		if(pClient->clientData.messageHandlers[itr].topicName == NULL) {
 			continue;
 		}
+		pBatch->topicList[pBatch->topicCount] = pClient->clientData.messageHandlers[itr].topicName;
+		pBatch->topicLenList[pBatch->topicCount] = pClient->clientData.messageHandlers[itr].topicNameLen;
+		pBatch->qosList[pBatch->topicCount] = pClient->clientData.messageHandlers[itr].qos;
+		pBatch->handlerIndex[pBatch->topicCount] = itr;
+		pBatch->grantedQoS[pBatch->topicCount] = QOS_SUBACK_FAILURE;
+		pBatch->topicCount++;
+	}
+}
 
-		init_timer(&timer);
-		countdown_ms(&timer, pClient->clientData.commandTimeoutMs);
+/**
+ * @brief Serialize the next SUBSCRIBE packets of a batch.
+ *
+ * Packs the filters not serialized yet into SUBSCRIBE packets written back to back
+ * into the TX buffer from offset on, as many as the rest of the buffer holds.
+ * A serialized length of 0 with offset > 0 means the buffer has to be sent first.
+ *
+ * @param pClient Reference to the IoT Client
+ * @param pBatch Batch to serialize from
+ * @param offset Start of the packets in the TX buffer
+ * @param pSerializedLen Returned length of the packets
+ *
+ * @return An IoT Error Type, MQTT_TX_BUFFER_TOO_SHORT_ERROR when a filter never fits
+ */
+IoT_Error_t aws_iot_mqtt_internal_subscribe_batch_serialize(AWS_IoT_Client *pClient, MQTTSubscribeBatch *pBatch,
+															size_t offset, size_t *pSerializedLen) {
+	uint32_t first, count, rem_len, next_len, len;
+	size_t bufLen;
+	IoT_Error_t rc;
+
+	FUNC_ENTRY;
 
-		rc = _aws_iot_mqtt_serialize_subscribe(pClient->clientData.writeBuf, pClient->clientData.writeBufSize, 0,
-											   aws_iot_mqtt_get_next_packet_id(pClient), 1,
-											   &(pClient->clientData.messageHandlers[itr].topicName),
-											   &(pClient->clientData.messageHandlers[itr].topicNameLen),
-											   &(pClient->clientData.messageHandlers[itr].qos), &len);
+	*pSerializedLen = 0;
+
+	while(pBatch->nextTopic < pBatch->topicCount) {
+		first = pBatch->nextTopic;
+		bufLen = pClient->clientData.writeBufSize - offset - *pSerializedLen;
+
+		rem_len = 2; /* packetId */
+		for(count = 0; first + count < pBatch->topicCount; count++) {
+			next_len = rem_len + pBatch->topicLenList[first + count] + 2 + 1;
+			if(aws_iot_mqtt_internal_get_final_packet_length_from_remaining_length(next_len) > bufLen) {
+				break;
+			}
+			rem_len = next_len;
+		}
+
+		if(0 == count) {
+			if(0 == offset && 0 == *pSerializedLen) {
+				FUNC_EXIT_RC(MQTT_TX_BUFFER_TOO_SHORT_ERROR);
+			}
+			/* the rest goes into the next write */
+			break;
+		}
+
+		pBatch->packetIdList[pBatch->packetCount] = aws_iot_mqtt_get_next_packet_id(pClient);
+		pBatch->packetFirstTopic[pBatch->packetCount] = first;
+		pBatch->packetTopicCount[pBatch->packetCount] = count;
+
+		len = 0;
+		rc = _aws_iot_mqtt_serialize_subscribe(pClient->clientData.writeBuf + offset + *pSerializedLen, bufLen, 0,
+											   pBatch->packetIdList[pBatch->packetCount], count,
+											   &pBatch->topicList[first], &pBatch->topicLenList[first],
+											   &pBatch->qosList[first], &len);
+		if(SUCCESS != rc) {
+			FUNC_EXIT_RC(rc);
+		}
+
+		*pSerializedLen += len;
+		pBatch->packetCount++;
+		pBatch->nextTopic += count;
+	}
+
+	FUNC_EXIT_RC(SUCCESS);
+}
+
+/**
+ * @brief Send the SUBSCRIBE packets of a batch not sent yet.
+ *
+ * @param pClient Reference to the IoT Client
+ * @param pBatch Batch to send
+ * @param pTimer Timeout of the whole batch
+ *
+ * @return An IoT Error Type defining successful/failed send
+ */
+IoT_Error_t aws_iot_mqtt_internal_subscribe_batch_send(AWS_IoT_Client *pClient, MQTTSubscribeBatch *pBatch,
+													   Timer *pTimer) {
+	size_t len;
+	IoT_Error_t rc;
+
+	FUNC_ENTRY;
+
+	while(pBatch->nextTopic < pBatch->topicCount) {
+		rc = aws_iot_mqtt_internal_subscribe_batch_serialize(pClient, pBatch, 0, &len);
 		if(SUCCESS != rc) {
 			FUNC_EXIT_RC(rc);
 		}
 
-		/* send the subscribe packet */
-		rc = aws_iot_mqtt_internal_send_packet(pClient, len, &timer);
+		rc = aws_iot_mqtt_internal_send_packet(pClient, len, pTimer);
 		if(SUCCESS != rc) {
 			FUNC_EXIT_RC(rc);
 		}
+	}
+
+	FUNC_EXIT_RC(SUCCESS);
+}
+
+/**
+ * @brief Wait for the SUBACKs of a batch.
+ *
+ * SUBACKs are matched to the sent packets by packet id and the granted QoS of
+ * every filter is stored in the batch.
+ *
+ * @param pClient Reference to the IoT Client
+ * @param pBatch Batch the SUBSCRIBE packets were sent from
+ * @param pTimer Timeout of the whole batch
+ *
+ * @return An IoT Error Type defining successful/failed subscription
+ */
+IoT_Error_t aws_iot_mqtt_internal_subscribe_batch_wait(AWS_IoT_Client *pClient, MQTTSubscribeBatch *pBatch,
+													   Timer *pTimer) {
+	QoS grantedQoS[AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS];
+	uint32_t acked[AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS];
+	uint16_t packetId;
+	uint32_t count, pendingCount, itr, i;
+	IoT_Error_t rc;
+
+	FUNC_ENTRY;
 
-		/* wait for suback */
-		rc = aws_iot_mqtt_internal_wait_for_read(pClient, SUBACK, &timer);
+	for(itr = 0; itr < pBatch->packetCount; itr++) {
+		acked[itr] = 0;
+	}
+
+	pendingCount = pBatch->packetCount;
+	while(pendingCount > 0) {
+		rc = aws_iot_mqtt_internal_wait_for_read(pClient, SUBACK, pTimer);
 		if(SUCCESS != rc) {
 			FUNC_EXIT_RC(rc);
 		}
 
-		/* Granted QoS can be 0, 1 or 2 */
-		rc = _aws_iot_mqtt_deserialize_suback(&packetId, 1, &count, grantedQoS, pClient->clientData.readBuf,
-											  pClient->clientData.readBufSize);
+		packetId = 0;
+		count = 0;
+		/* Granted QoS can be 0, 1 or 2, 0x80 is a failure */
+		rc = _aws_iot_mqtt_deserialize_suback(&packetId, AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS, &count, grantedQoS,
+											  pClient->clientData.readBuf, pClient->clientData.readBufSize);
 		if(SUCCESS != rc) {
 			FUNC_EXIT_RC(rc);
 		}
+
+		for(itr = 0; itr < pBatch->packetCount; itr++) {
+			if(!acked[itr] && pBatch->packetIdList[itr] == packetId) {
+				break;
+			}
+		}
+		if(itr == pBatch->packetCount) {
+			IOT_WARN("Unexpected SUBACK %u", packetId);
+			continue;
+		}
+
+		acked[itr] = 1;
+		pendingCount--;
+		for(i = 0; i < count && i < pBatch->packetTopicCount[itr]; i++) {
+			pBatch->grantedQoS[pBatch->packetFirstTopic[itr] + i] = grantedQoS[i];
+		}
+	}
+
+	FUNC_EXIT_RC(SUCCESS);
+}
+
+/**
+ * @brief Resubscribe to all the active topic filters.
+ *
+ * Called to send subscribe messages to the broker for every registered message handler,
+ * typically after a reconnect.
+ * This is the internal function which is called by the resubscribe API to perform the operation.
+ * Not meant to be called directly as it doesn't do validations or client state changes
+ * @note Call is blocking.  The filters are packed into as few SUBSCRIBE packets and writes as the
+ * TX buffer allows and all of them are sent before waiting for the SUBACKs, so the call returns
+ * after a single round trip.
+ *
+ * @param pClient Reference to the IoT Client
+ *
+ * @return An IoT Error Type defining successful/failed subscription
+ */
+static IoT_Error_t _aws_iot_mqtt_internal_resubscribe(AWS_IoT_Client *pClient) {
+	MQTTSubscribeBatch batch;
+	uint32_t itr;
+	IoT_Error_t rc;
+	Timer timer;
+
+	FUNC_ENTRY;
+
+	aws_iot_mqtt_internal_subscribe_batch_init(pClient, &batch);
+	if(0 == batch.topicCount) {
+		FUNC_EXIT_RC(SUCCESS);
+	}
+
+	/* one timer for the whole batch, it takes a single round trip */
+	init_timer(&timer);
+	countdown_ms(&timer, pClient->clientData.commandTimeoutMs);
+
+	rc = aws_iot_mqtt_internal_subscribe_batch_send(pClient, &batch, &timer);
+	if(SUCCESS != rc) {
+		FUNC_EXIT_RC(rc);
+	}
+
+	rc = aws_iot_mqtt_internal_subscribe_batch_wait(pClient, &batch, &timer);
+	if(SUCCESS != rc) {
+		FUNC_EXIT_RC(rc);
+	}
+
+	for(itr = 0; itr < batch.topicCount; itr++) {
+		if(QOS_SUBACK_FAILURE == batch.grantedQoS[itr]) {
+			IOT_WARN("Resubscribe refused for %.*s", batch.topicLenList[itr], batch.topicList[itr]);
+		}
 	}
 
 	FUNC_EXIT_RC(SUCCESS);
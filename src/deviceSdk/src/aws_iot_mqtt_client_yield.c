@@ -55,6 +55,8 @@ static IoT_Error_t _aws_iot_mqtt_handle_disconnect(AWS_IoT_Client *pClient) {
 
 	FUNC_ENTRY;
 
+	aws_iot_mqtt_internal_adapt_keep_alive(pClient, true);
+
 	rc = aws_iot_mqtt_disconnect(pClient);
 	if(rc != SUCCESS) {
 		// If the aws_iot_mqtt_internal_send_packet prevents us from sending a disconnect packet then we have to clean the stack
@@ -108,6 +110,135 @@ static IoT_Error_t _aws_iot_mqtt_handle_reconnect(AWS_IoT_Client *pClient) {
 	FUNC_EXIT_RC(rc);
 }
 
+/**
+ * @brief Adapt the keepalive ping interval to the network
+ *
+ * A link lost without a disconnect request is taken as a NAT or firewall dropping
+ * the idle mapping, the ping interval is cut by a quarter and the lost one becomes
+ * the ceiling. After AWS_IOT_MQTT_KEEPALIVE_STABLE_PINGS answered pings a 25% longer
+ * interval is tried, staying below the ceiling until AWS_IOT_MQTT_KEEPALIVE_REPROBE_PINGS
+ * pings were answered, as the network may have changed since.
+ *
+ * @param pClient Reference to the IoT Client
+ * @param isLinkLost true on an unrequested disconnect, false on a PINGRESP
+ */
+void aws_iot_mqtt_internal_adapt_keep_alive(AWS_IoT_Client *pClient, bool isLinkLost) {
+	ClientData *pData = &(pClient->clientData);
+	uint16_t interval = pData->keepAliveInterval;
+	uint16_t next;
+
+	if(!pData->isAdaptiveKeepAliveEnabled || 0 == interval) {
+		return;
+	}
+
+	if(isLinkLost) {
+		pData->keepAliveCeiling = interval;
+		pData->keepAliveStableCount = 0;
+		next = interval - interval / 4;
+		if(AWS_IOT_MQTT_MIN_KEEPALIVE_INTERVAL > next) {
+			next = AWS_IOT_MQTT_MIN_KEEPALIVE_INTERVAL;
+		}
+		if(next > interval) {
+			next = interval;
+		}
+	} else {
+		pData->keepAliveStableCount++;
+		if(AWS_IOT_MQTT_KEEPALIVE_STABLE_PINGS > pData->keepAliveStableCount) {
+			return;
+		}
+
+		if(0 != pData->keepAliveCeiling && AWS_IOT_MQTT_KEEPALIVE_REPROBE_PINGS <= pData->keepAliveStableCount) {
+			pData->keepAliveCeiling = 0;
+		}
+
+		next = interval + (interval + 3) / 4;
+		if(next < interval || next > pData->options.keepAliveIntervalInSec) {
+			next = pData->options.keepAliveIntervalInSec;
+		}
+		if(0 != pData->keepAliveCeiling && next >= pData->keepAliveCeiling) {
+			next = pData->keepAliveCeiling - 1;
+		}
+		if(next <= interval) {
+			return;
+		}
+		pData->keepAliveStableCount = 0;
+	}
+
+	if(next != interval) {
+		IOT_INFO("keepalive ping interval %u s -> %u s", interval, next);
+		pData->keepAliveInterval = next;
+	}
+
+	if(!isLinkLost) {
+		aws_iot_mqtt_internal_update_tcp_keep_alive(pClient);
+	}
+}
+
+/**
+ * @brief TCP keepalive idle time for the current ping interval
+ *
+ * While the adaptive keepalive probes for a longer ping interval, TCP keepalive probes
+ * would refresh the NAT mapping being measured, so they are off and an idle dead link is
+ * found at the next ping. Otherwise the probes find it after AWS_IOT_TCP_KEEPALIVE_IDLE.
+ *
+ * @param pClient Reference to the IoT Client
+ *
+ * @return idle seconds before the first TCP keepalive probe, 0 for none
+ */
+uint16_t aws_iot_mqtt_internal_tcp_keep_alive_idle(AWS_IoT_Client *pClient) {
+	ClientData *pData = &(pClient->clientData);
+
+	if(pData->isAdaptiveKeepAliveEnabled && pData->keepAliveInterval < pData->options.keepAliveIntervalInSec &&
+	   (0 == pData->keepAliveCeiling || pData->keepAliveInterval + 1 < pData->keepAliveCeiling)) {
+		return 0;
+	}
+
+	return AWS_IOT_TCP_KEEPALIVE_IDLE;
+}
+
+/**
+ * @brief Apply the TCP keepalive idle time of the current ping interval to the connection
+ *
+ * Before a connection is open there is nothing to apply, connecting sets the idle time.
+ *
+ * @param pClient Reference to the IoT Client
+ */
+void aws_iot_mqtt_internal_update_tcp_keep_alive(AWS_IoT_Client *pClient) {
+	uint16_t idle = aws_iot_mqtt_internal_tcp_keep_alive_idle(pClient);
+
+	if(NULL == pClient->networkStack.setKeepAlive || !aws_iot_mqtt_is_client_connected(pClient) ||
+	   idle == pClient->networkStack.tlsConnectParams.keepAliveIdleSec) {
+		return;
+	}
+
+	IOT_DEBUG("TCP keepalive idle %u s", idle);
+	(void) pClient->networkStack.setKeepAlive(&(pClient->networkStack), idle);
+}
+
+/**
+ * @brief Check that the network still has the connection
+ *
+ * The kernel drops a connection whose keepalive probes or data went unanswered
+ * before any read or write on it fails, so it is checked before the read and the ping.
+ *
+ * @param pClient Reference to the IoT Client
+ *
+ * @return SUCCESS while connected, otherwise the result of handling the disconnect
+ */
+static IoT_Error_t _aws_iot_mqtt_check_link(AWS_IoT_Client *pClient) {
+	IoT_Error_t rc = SUCCESS;
+
+	FUNC_ENTRY;
+
+	if(NULL != pClient->networkStack.isConnected &&
+	   NETWORK_PHYSICAL_LAYER_DISCONNECTED == pClient->networkStack.isConnected(&(pClient->networkStack))) {
+		IOT_WARN("Network dropped the connection");
+		rc = _aws_iot_mqtt_handle_disconnect(pClient);
+	}
+
+	FUNC_EXIT_RC(rc);
+}
+
 static IoT_Error_t _aws_iot_mqtt_keep_alive(AWS_IoT_Client *pClient) {
 	IoT_Error_t rc = SUCCESS;
 	Timer timer;
@@ -203,13 +334,16 @@ static IoT_Error_t _aws_iot_mqtt_internal_yield(AWS_IoT_Client *pClient, uint32_
 			continue;
 		}
 
-		yieldRc = aws_iot_mqtt_internal_cycle_read(pClient, &timer, &packet_type);
+		yieldRc = _aws_iot_mqtt_check_link(pClient);
 		if(SUCCESS == yieldRc) {
-			yieldRc = _aws_iot_mqtt_keep_alive(pClient);
-		} else {
-			// SSL read and write errors are terminal, connection must be closed and retried
-			if(NETWORK_SSL_READ_ERROR == yieldRc || NETWORK_SSL_WRITE_ERROR == yieldRc || NETWORK_SSL_WRITE_TIMEOUT_ERROR == yieldRc) {
-				yieldRc = _aws_iot_mqtt_handle_disconnect(pClient);
+			yieldRc = aws_iot_mqtt_internal_cycle_read(pClient, &timer, &packet_type);
+			if(SUCCESS == yieldRc) {
+				yieldRc = _aws_iot_mqtt_keep_alive(pClient);
+			} else {
+				// SSL read and write errors are terminal, connection must be closed and retried
+				if(NETWORK_SSL_READ_ERROR == yieldRc || NETWORK_SSL_WRITE_ERROR == yieldRc || NETWORK_SSL_WRITE_TIMEOUT_ERROR == yieldRc) {
+					yieldRc = _aws_iot_mqtt_handle_disconnect(pClient);
+				}
 			}
 		}
 
@@ -335,35 +335,48 @@ IoT_Error_t subscribeToShadowActionAcks(const char *pThingName, ShadowActions_t
 	bool clearBothEntriesFromList = true;
 	int16_t indexAcceptedSubList = 0;
 	int16_t indexRejectedSubList = 0;
+	IoT_MQTT_Subscription subscriptions[2];
 	Timer subSettlingtimer;
 	indexAcceptedSubList = getNextFreeIndexOfSubscriptionList();
 	indexRejectedSubList = getNextFreeIndexOfSubscriptionList();
 
 	if(indexAcceptedSubList >= 0 && indexRejectedSubList >= 0) {
+		SubscriptionList[indexAcceptedSubList].count = 0;
+		SubscriptionList[indexRejectedSubList].count = 0;
 		topicNameFromThingAndAction(SubscriptionList[indexAcceptedSubList].Topic, pThingName, action, SHADOW_ACCEPTED);
-		ret_val = aws_iot_mqtt_subscribe(pMqttClient, SubscriptionList[indexAcceptedSubList].Topic,
-										 (uint16_t) strlen(SubscriptionList[indexAcceptedSubList].Topic), QOS0,
-										 AckStatusCallback, NULL);
+		topicNameFromThingAndAction(SubscriptionList[indexRejectedSubList].Topic, pThingName, action, SHADOW_REJECTED);
+
+		// accepted and rejected share one SUBSCRIBE and one SUBACK
+		subscriptions[0].pTopicName = SubscriptionList[indexAcceptedSubList].Topic;
+		subscriptions[0].topicNameLen = (uint16_t) strlen(SubscriptionList[indexAcceptedSubList].Topic);
+		subscriptions[1].pTopicName = SubscriptionList[indexRejectedSubList].Topic;
+		subscriptions[1].topicNameLen = (uint16_t) strlen(SubscriptionList[indexRejectedSubList].Topic);
+		subscriptions[0].qos = subscriptions[1].qos = QOS0;
+		subscriptions[0].pApplicationHandler = subscriptions[1].pApplicationHandler = AckStatusCallback;
+		subscriptions[0].pApplicationHandlerData = subscriptions[1].pApplicationHandlerData = NULL;
+
+		ret_val = aws_iot_mqtt_subscribe_multi(pMqttClient, subscriptions, 2);
 		if(ret_val == SUCCESS) {
-			SubscriptionList[indexAcceptedSubList].count = 1;
-			SubscriptionList[indexAcceptedSubList].isSticky = isSticky;
-			topicNameFromThingAndAction(SubscriptionList[indexRejectedSubList].Topic, pThingName, action,
-										SHADOW_REJECTED);
-			ret_val = aws_iot_mqtt_subscribe(pMqttClient, SubscriptionList[indexRejectedSubList].Topic,
-											 (uint16_t) strlen(SubscriptionList[indexRejectedSubList].Topic), QOS0,
-											 AckStatusCallback, NULL);
-			if(ret_val == SUCCESS) {
+			if(QOS_SUBACK_FAILURE != subscriptions[0].grantedQoS) {
+				SubscriptionList[indexAcceptedSubList].count = 1;
+				SubscriptionList[indexAcceptedSubList].isSticky = isSticky;
+			}
+			if(QOS_SUBACK_FAILURE != subscriptions[1].grantedQoS) {
 				SubscriptionList[indexRejectedSubList].count = 1;
 				SubscriptionList[indexRejectedSubList].isSticky = isSticky;
-				clearBothEntriesFromList = false;
-
-				// wait for SUBSCRIBE_SETTLING_TIME seconds to let the subscription take effect
-				init_timer(&subSettlingtimer);
-				countdown_sec(&subSettlingtimer, SUBSCRIBE_SETTLING_TIME);
-				while(!has_timer_expired(&subSettlingtimer));
-
+			}
+			if(QOS_SUBACK_FAILURE == subscriptions[0].grantedQoS || QOS_SUBACK_FAILURE == subscriptions[1].grantedQoS) {
+				ret_val = FAILURE;
 			}
 		}
+		if(ret_val == SUCCESS) {
+			clearBothEntriesFromList = false;
+
+			// wait for SUBSCRIBE_SETTLING_TIME seconds to let the subscription take effect
+			init_timer(&subSettlingtimer);
+			countdown_sec(&subSettlingtimer, SUBSCRIBE_SETTLING_TIME);
+			while(!has_timer_expired(&subSettlingtimer));
+		}
 	}
 
 	if(clearBothEntriesFromList) {
@@ -377,6 +390,11 @@ IoT_Error_t subscribeToShadowActionAcks(const char *pThingName, ShadowActions_t
 		}
 		if(indexRejectedSubList >= 0) {
 			SubscriptionList[indexRejectedSubList].isFree = true;
+
+			if(SubscriptionList[indexRejectedSubList].count == 1) {
+				aws_iot_mqtt_unsubscribe(pMqttClient, SubscriptionList[indexRejectedSubList].Topic,
+				(uint16_t) strlen(SubscriptionList[indexRejectedSubList].Topic));
+			}
 		}
 
 	}
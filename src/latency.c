@@ -0,0 +1,238 @@
+/*
+ * Copyright (c) 2018 Samsung Electronics Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "latency.h"
+#include "log.h"
+
+#define LATENCY_PREFIX		"LATENCY:"
+#define LATENCY_BUCKETS		32		// log2 of usec, the last one is open ended
+
+/*
+ * Stages are measured between two points, a command which did not pass
+ * both (e.g. one sent by a macro) is not counted in that stage.
+ */
+typedef struct {
+	const char *name;
+	latency_point_e from;
+	latency_point_e to;
+} latency_stage_t;
+
+static const latency_stage_t g_stages[] = {
+	{"read",     LATENCY_READABLE,   LATENCY_FRAMED},
+	{"dispatch", LATENCY_FRAMED,     LATENCY_CALLBACK},
+	{"resolve",  LATENCY_CALLBACK,   LATENCY_RESOLVED},
+	{"queue",    LATENCY_RESOLVED,   LATENCY_FIRST_EDGE},
+	{"air",      LATENCY_FIRST_EDGE, LATENCY_LAST_EDGE},
+	{"total",    LATENCY_READABLE,   LATENCY_LAST_EDGE},
+};
+
+#define LATENCY_STAGE_NUM	(int)(sizeof(g_stages) / sizeof(g_stages[0]))
+
+// updated with relaxed atomics from any thread, never locked
+typedef struct {
+	unsigned long count;
+	unsigned long long sum;		// usec
+	unsigned long max;			// usec
+	unsigned long bucket[LATENCY_BUCKETS];
+} latency_hist_t;
+
+// off until LATENCY:ON
+bool latency_enabled = false;
+
+static latency_hist_t g_hist[LATENCY_STAGE_NUM];
+static __thread latency_trace_t t_trace;
+
+void latency_stamp_now(latency_point_e point)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	// a new packet starts a new trace
+	if (point == LATENCY_READABLE)
+		memset(&t_trace, 0, sizeof(t_trace));
+
+	// a job sends several frames, only the first edge of the first one counts
+	if (point == LATENCY_FIRST_EDGE && t_trace.stamp[point] != 0)
+		return;
+
+	t_trace.stamp[point] = (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/*
+ * The trace of the command being handled by this thread, handed over
+ * with a queued job
+ */
+void latency_trace_get(latency_trace_t *trace)
+{
+	*trace = t_trace;
+}
+
+void latency_trace_set(const latency_trace_t *trace)
+{
+	t_trace = *trace;
+}
+
+static int latency_bucket(unsigned long usec)
+{
+	int bucket = 0;
+
+	while (usec > 1 && bucket < LATENCY_BUCKETS - 1) {
+		usec >>= 1;
+		bucket++;
+	}
+
+	return bucket;
+}
+
+static void latency_hist_add(latency_hist_t *hist, unsigned long usec)
+{
+	unsigned long max = __atomic_load_n(&hist->max, __ATOMIC_RELAXED);
+
+	__atomic_fetch_add(&hist->count, 1, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&hist->sum, usec, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&hist->bucket[latency_bucket(usec)], 1, __ATOMIC_RELAXED);
+
+	while (usec > max &&
+		!__atomic_compare_exchange_n(&hist->max, &max, usec, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+		;
+}
+
+/*
+ * Account the trace of the job just sent by this thread
+ */
+void latency_trace_commit(void)
+{
+	const latency_stage_t *stage;
+	uint64_t from, to;
+	int i;
+
+	if (!__atomic_load_n(&latency_enabled, __ATOMIC_RELAXED))
+		return;
+
+	for (i = 0; i < LATENCY_STAGE_NUM; i++) {
+		stage = &g_stages[i];
+		from = t_trace.stamp[stage->from];
+		to = t_trace.stamp[stage->to];
+		if (from != 0 && to >= from)
+			latency_hist_add(&g_hist[i], (to - from) / 1000);
+	}
+
+	memset(&t_trace, 0, sizeof(t_trace));
+}
+
+// upper bound in usec of the bucket holding the p-th percentile, at most the max
+static unsigned long latency_percentile(const latency_hist_t *hist, unsigned long count, int p)
+{
+	unsigned long target = (count * p + 99) / 100;
+	unsigned long max = __atomic_load_n(&hist->max, __ATOMIC_RELAXED);
+	unsigned long seen = 0;
+	int i;
+
+	for (i = 0; i < LATENCY_BUCKETS - 1; i++) {
+		seen += __atomic_load_n(&hist->bucket[i], __ATOMIC_RELAXED);
+		if (seen >= target)
+			return ((2UL << i) - 1 < max) ? (2UL << i) - 1 : max;
+	}
+
+	return max;
+}
+
+/*
+ * JSON summary of every stage in usec, p50 and p99 are log2 bucket bounds
+ */
+int latency_dump(char *buf, size_t size)
+{
+	const latency_hist_t *hist;
+	unsigned long count;
+	size_t len;
+	int i;
+
+	len = snprintf(buf, size, "{\"unit\":\"us\"");
+
+	for (i = 0; i < LATENCY_STAGE_NUM && len < size; i++) {
+		hist = &g_hist[i];
+		count = __atomic_load_n(&hist->count, __ATOMIC_RELAXED);
+		len += snprintf(buf + len, size - len,
+			",\"%s\":{\"n\":%lu,\"mean\":%llu,\"p50\":%lu,\"p99\":%lu,\"max\":%lu}",
+			g_stages[i].name, count,
+			count ? __atomic_load_n(&hist->sum, __ATOMIC_RELAXED) / count : 0,
+			count ? latency_percentile(hist, count, 50) : 0,
+			count ? latency_percentile(hist, count, 99) : 0,
+			__atomic_load_n(&hist->max, __ATOMIC_RELAXED));
+	}
+
+	if (len < size)
+		len += snprintf(buf + len, size - len, "}");
+
+	return (len < size) ? (int)len : -1;
+}
+
+static void latency_reset(void)
+{
+	int i, j;
+
+	for (i = 0; i < LATENCY_STAGE_NUM; i++) {
+		__atomic_store_n(&g_hist[i].count, 0, __ATOMIC_RELAXED);
+		__atomic_store_n(&g_hist[i].sum, 0, __ATOMIC_RELAXED);
+		__atomic_store_n(&g_hist[i].max, 0, __ATOMIC_RELAXED);
+		for (j = 0; j < LATENCY_BUCKETS; j++)
+			__atomic_store_n(&g_hist[i].bucket[j], 0, __ATOMIC_RELAXED);
+	}
+}
+
+extern void mqtt_request_metrics(void);
+extern void mqtt_set_metrics_period(int period_sec);
+
+bool latency_is_latency(const char *cmd)
+{
+	return (0 == strncmp(cmd, LATENCY_PREFIX, strlen(LATENCY_PREFIX)));
+}
+
+/*
+ * LATENCY:ON, LATENCY:OFF, LATENCY:RESET
+ * LATENCY:DUMP publishes the histograms once to the metrics topic,
+ * LATENCY:PUBLISH <sec> every <sec> seconds, 0 stops it
+ */
+bool process_latency_command(const char *cmd)
+{
+	char buf[1024];
+	int period;
+
+	cmd += strlen(LATENCY_PREFIX);
+
+	if (0 == strcmp(cmd, "ON")) {
+		__atomic_store_n(&latency_enabled, true, __ATOMIC_RELAXED);
+	} else if (0 == strcmp(cmd, "OFF")) {
+		__atomic_store_n(&latency_enabled, false, __ATOMIC_RELAXED);
+	} else if (0 == strcmp(cmd, "RESET")) {
+		latency_reset();
+	} else if (0 == strcmp(cmd, "DUMP")) {
+		if (latency_dump(buf, sizeof(buf)) > 0)
+			INFO("latency %s", buf);
+		mqtt_request_metrics();
+	} else if (1 == sscanf(cmd, "PUBLISH %d", &period) && period >= 0) {
+		mqtt_set_metrics_period(period);
+	} else {
+		return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,236 @@
+/*
+ * Copyright (c) 2018 Samsung Electronics Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+#include "aws_iot_config.h"
+#include "sdk/aws_iot_mqtt_client_interface.h"
+#include "latency.h"
+#include "log.h"
+
+#define DISPATCH_WORKER_NUM		2
+#define DISPATCH_BUFFER_NUM		16
+
+/*
+ * A message copied out of the read buffer of the MQTT client. Topic and
+ * payload fit together, as they did in the read buffer.
+ */
+typedef struct dispatch_msg {
+	struct dispatch_msg *next;
+	AWS_IoT_Client *client;
+	pApplicationHandler_t handler;
+	void *handler_data;
+	IoT_Publish_Message_Params params;
+	uint16_t topic_len;
+	latency_trace_t trace;			// stamps of the MQTT thread
+	char buf[AWS_IOT_MQTT_RX_BUF_LEN];	// topic then payload
+} dispatch_msg_t;
+
+/*
+ * A topic always goes to the same worker, which runs its messages in
+ * order. Other topics go on in parallel on the other workers.
+ */
+typedef struct {
+	dispatch_msg_t *head;
+	dispatch_msg_t *tail;
+	pthread_cond_t cond;
+	pthread_t thread;
+	bool started;
+} dispatch_worker_t;
+
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_free_cond;
+static dispatch_msg_t g_msgs[DISPATCH_BUFFER_NUM];
+static dispatch_msg_t *g_free;
+static dispatch_worker_t g_workers[DISPATCH_WORKER_NUM];
+static bool g_running;
+static unsigned long g_dispatch_count;
+static unsigned long g_wait_count;
+
+// FNV-1a of the topic
+static int dispatch_worker_of(const char *topic, uint16_t len)
+{
+	uint32_t hash = 2166136261u;
+
+	while (len--) {
+		hash ^= (unsigned char)*topic++;
+		hash *= 16777619u;
+	}
+
+	return hash % DISPATCH_WORKER_NUM;
+}
+
+static void *dispatch_worker(void *data)
+{
+	dispatch_worker_t *w = data;
+	dispatch_msg_t *msg, *next;
+
+	while (1) {
+		pthread_mutex_lock(&g_lock);
+		while (w->head == NULL && g_running)
+			pthread_cond_wait(&w->cond, &g_lock);
+
+		// the queued messages still run on close
+		msg = w->head;
+		if (msg == NULL) {
+			pthread_mutex_unlock(&g_lock);
+			break;
+		}
+		// everything queued so far is run in one go, in order
+		w->head = NULL;
+		w->tail = NULL;
+		pthread_mutex_unlock(&g_lock);
+
+		for (; msg != NULL; msg = next) {
+			next = msg->next;
+
+			latency_trace_set(&msg->trace);
+			msg->handler(msg->client, msg->buf, msg->topic_len, &msg->params, msg->handler_data);
+
+			pthread_mutex_lock(&g_lock);
+			if (g_free == NULL)
+				pthread_cond_signal(&g_free_cond);
+			msg->next = g_free;
+			g_free = msg;
+			pthread_mutex_unlock(&g_lock);
+		}
+	}
+
+	return NULL;
+}
+
+/*
+ * Dispatch handler of the MQTT client, called on the yield thread. Only
+ * waits when all buffers are taken, which holds back the network loop no
+ * longer than the handlers hold back each other.
+ */
+IoT_Error_t mqtt_dispatch(AWS_IoT_Client *pClient, pApplicationHandler_t pApplicationHandler,
+		void *pApplicationHandlerData, char *pTopicName, uint16_t topicNameLen,
+		IoT_Publish_Message_Params *pParams, void *pDispatchHandlerData)
+{
+	dispatch_worker_t *w;
+	dispatch_msg_t *msg;
+
+	if (topicNameLen + pParams->payloadLen > sizeof(msg->buf))
+		return MQTT_RX_BUFFER_TOO_SHORT_ERROR;
+
+	pthread_mutex_lock(&g_lock);
+	if (!g_running) {
+		pthread_mutex_unlock(&g_lock);
+		return FAILURE;
+	}
+
+	if (g_free == NULL) {
+		if (g_wait_count++ == 0)
+			WARN("dispatch buffers exhausted, the MQTT thread waits for the handlers");
+		while (g_free == NULL && g_running)
+			pthread_cond_wait(&g_free_cond, &g_lock);
+		if (!g_running) {
+			pthread_mutex_unlock(&g_lock);
+			return FAILURE;
+		}
+	}
+	msg = g_free;
+	g_free = msg->next;
+	g_dispatch_count++;
+	pthread_mutex_unlock(&g_lock);
+
+	msg->next = NULL;
+	msg->client = pClient;
+	msg->handler = pApplicationHandler;
+	msg->handler_data = pApplicationHandlerData;
+	msg->params = *pParams;
+	msg->topic_len = topicNameLen;
+	memcpy(msg->buf, pTopicName, topicNameLen);
+	memcpy(msg->buf + topicNameLen, pParams->payload, pParams->payloadLen);
+	msg->params.payload = msg->buf + topicNameLen;
+	latency_trace_get(&msg->trace);
+
+	w = &g_workers[dispatch_worker_of(pTopicName, topicNameLen)];
+
+	pthread_mutex_lock(&g_lock);
+	if (w->tail != NULL)
+		w->tail->next = msg;
+	else
+		w->head = msg;
+	w->tail = msg;
+	// a worker with queued messages is not waiting
+	if (w->head == msg)
+		pthread_cond_signal(&w->cond);
+	pthread_mutex_unlock(&g_lock);
+
+	return SUCCESS;
+}
+
+/*
+ * Runs the queued messages to the end and stops the workers.
+ */
+void mqtt_dispatch_close(void)
+{
+	int i;
+
+	pthread_mutex_lock(&g_lock);
+	g_running = false;
+	for (i = 0; i < DISPATCH_WORKER_NUM; i++)
+		pthread_cond_broadcast(&g_workers[i].cond);
+	pthread_cond_broadcast(&g_free_cond);
+	pthread_mutex_unlock(&g_lock);
+
+	for (i = 0; i < DISPATCH_WORKER_NUM; i++) {
+		if (g_workers[i].started)
+			pthread_join(g_workers[i].thread, NULL);
+		g_workers[i].started = false;
+	}
+
+	INFO("mqtt dispatch closed, total dispatched [%lu] waited for a buffer [%lu]",
+		g_dispatch_count, g_wait_count);
+}
+
+int mqtt_dispatch_init(void)
+{
+	int ret;
+	int i;
+
+	pthread_cond_init(&g_free_cond, NULL);
+
+	g_free = NULL;
+	for (i = 0; i < DISPATCH_BUFFER_NUM; i++) {
+		g_msgs[i].next = g_free;
+		g_free = &g_msgs[i];
+	}
+
+	g_dispatch_count = 0;
+	g_wait_count = 0;
+	g_running = true;
+	for (i = 0; i < DISPATCH_WORKER_NUM; i++) {
+		g_workers[i].head = NULL;
+		g_workers[i].tail = NULL;
+		pthread_cond_init(&g_workers[i].cond, NULL);
+
+		ret = pthread_create(&g_workers[i].thread, NULL, dispatch_worker, &g_workers[i]);
+		if (ret != 0) {
+			ERR("pthread_create() failed!![%d]", ret);
+			mqtt_dispatch_close();
+			return ret;
+		}
+		g_workers[i].started = true;
+	}
+
+	return 0;
+}
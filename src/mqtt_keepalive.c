@@ -0,0 +1,112 @@
+/*
+ * Copyright (c) 2018 Samsung Electronics Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/*
+ * Keepalive ping interval learned per network
+ *
+ * The SDK adapts the ping interval to how long the network keeps an idle
+ * link. The interval is stored under the name of the network it was
+ * learned on, so a device moving between networks starts each one from
+ * its own interval instead of probing up again. Only the yield thread
+ * calls these, after init.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <app_preference.h>
+#include <net_connection.h>
+#include "aws_iot_config.h"
+#include "sdk/aws_iot_mqtt_client_interface.h"
+#include "log.h"
+
+#define KEEPALIVE_KEY_PREFIX	"keepalive."
+
+// preference key of the network the learned interval belongs to
+static char *g_key = NULL;
+static int g_saved = 0;
+
+// "keepalive.<profile name>", the name is the SSID or APN of the current network
+static char *keepalive_key(void)
+{
+	connection_h connection;
+	connection_profile_h profile;
+	char *name = NULL;
+	char *key = NULL;
+
+	if (connection_create(&connection) != CONNECTION_ERROR_NONE)
+		return NULL;
+
+	if (connection_get_current_profile(connection, &profile) == CONNECTION_ERROR_NONE) {
+		if (connection_profile_get_name(profile, &name) == CONNECTION_ERROR_NONE && name) {
+			key = malloc(strlen(KEEPALIVE_KEY_PREFIX) + strlen(name) + 1);
+			if (key)
+				sprintf(key, KEEPALIVE_KEY_PREFIX"%s", name);
+			free(name);
+		}
+		connection_profile_destroy(profile);
+	}
+	connection_destroy(connection);
+
+	return key;
+}
+
+// the client was initialized again, the next load sets its interval
+void mqtt_keepalive_reset(void)
+{
+	free(g_key);
+	g_key = NULL;
+	g_saved = 0;
+}
+
+// start from the interval learned on the current network, when the network changed
+void mqtt_keepalive_load(AWS_IoT_Client *pClient)
+{
+	char *key = keepalive_key();
+	int interval = 0;
+
+	if (!key || (g_key && !strcmp(key, g_key))) {
+		free(key);
+		return;
+	}
+
+	free(g_key);
+	g_key = key;
+
+	if (preference_get_int(g_key, &interval) != PREFERENCE_ERROR_NONE)
+		interval = 0;
+	g_saved = interval;
+
+	// 0 probes up from the shortest interval
+	aws_iot_mqtt_set_keepalive_interval(pClient, interval);
+	INFO("%s : %d s", g_key, interval);
+}
+
+// store the interval of the current network once it changed
+void mqtt_keepalive_save(AWS_IoT_Client *pClient)
+{
+	int interval = aws_iot_mqtt_get_keepalive_interval(pClient);
+
+	if (!g_key || interval == 0 || interval == g_saved)
+		return;
+
+	if (preference_set_int(g_key, interval) != PREFERENCE_ERROR_NONE) {
+		WARN("%s not saved", g_key);
+		return;
+	}
+	g_saved = interval;
+}
@@ -32,12 +32,14 @@
 #include <linux/limits.h>
 #include <string.h>
 #include <pthread.h>
+#include <time.h>
 #include <service_app.h>
 
 #include "aws_iot_config.h"
 #include "sdk/aws_iot_log.h"
 #include "sdk/aws_iot_version.h"
 #include "sdk/aws_iot_mqtt_client_interface.h"
+#include "latency.h"
 
 #define HOST_ADDRESS_SIZE 255
 
@@ -62,6 +64,11 @@
  */
 const char *TOPIC_SUB = "tizen/sub";
 
+/**
+ * @brief Topic the latency histograms are published to
+ */
+const char *TOPIC_METRICS = "tizen/metrics";
+
 /**
  * @brief Default cert location
  */
@@ -88,17 +95,76 @@ bool terminate_yield_thread;
 pthread_t yield_thread;
 bool mqtt_initalized = false;
 
+/* metrics are published from the yield thread, which owns the client */
+static bool metrics_requested = false;
+static int metrics_period_sec = 0;
+static time_t metrics_next = 0;
+
 extern bool process_command(int length, char *payload);
+extern IoT_Error_t mqtt_dispatch(AWS_IoT_Client *pClient, pApplicationHandler_t pApplicationHandler,
+		void *pApplicationHandlerData, char *pTopicName, uint16_t topicNameLen,
+		IoT_Publish_Message_Params *pParams, void *pDispatchHandlerData);
+extern int latency_dump(char *buf, size_t size);
+extern void mqtt_keepalive_reset(void);
+extern void mqtt_keepalive_load(AWS_IoT_Client *pClient);
+extern void mqtt_keepalive_save(AWS_IoT_Client *pClient);
+
+void mqtt_request_metrics(void)
+{
+	__atomic_store_n(&metrics_requested, true, __ATOMIC_RELAXED);
+}
+
+void mqtt_set_metrics_period(int period_sec)
+{
+	__atomic_store_n(&metrics_period_sec, period_sec, __ATOMIC_RELAXED);
+}
+
+static void publish_metrics(AWS_IoT_Client *pClient)
+{
+	IoT_Publish_Message_Params params;
+	char payload[1024];
+	int period = __atomic_load_n(&metrics_period_sec, __ATOMIC_RELAXED);
+	time_t now = time(NULL);
+	int len;
+
+	if (!__atomic_exchange_n(&metrics_requested, false, __ATOMIC_RELAXED)) {
+		if (period <= 0 || now < metrics_next)
+			return;
+	}
+	metrics_next = now + period;
+
+	len = latency_dump(payload, sizeof(payload));
+	if (len < 0)
+		return;
+
+	params.qos = QOS0;
+	params.isRetained = 0;
+	params.payload = payload;
+	params.payloadLen = len;
+
+	if (aws_iot_mqtt_publish(pClient, TOPIC_METRICS, strlen(TOPIC_METRICS), &params) != SUCCESS)
+		IOT_WARN("metrics publish failed");
+}
+
+static void packet_read_handler(AWS_IoT_Client *pClient, MqttPacketReadEvent event, void *data)
+{
+	latency_stamp(event == MQTT_PACKET_READ_STARTED ? LATENCY_READABLE : LATENCY_FRAMED);
+}
 
 void iot_subscribe_callback_handler(AWS_IoT_Client *pClient, char *topicName, uint16_t topicNameLen,
 									IoT_Publish_Message_Params *params, void *pData) {
+	latency_stamp(LATENCY_CALLBACK);
+
 	IOT_UNUSED(pData);
 	IOT_UNUSED(pClient);
 	IOT_INFO("Subscribe callback : %.*s\t%.*s", topicNameLen, topicName, (int)params->payloadLen, (char *)params->payload);
 
 	int length = (int)params->payloadLen;
-	char cmd[30];
-	memset(cmd, 0, 30);
+	// raw and Pronto commands take up to the whole payload
+	char cmd[AWS_IOT_MQTT_RX_BUF_LEN + 1];
+	if (length > AWS_IOT_MQTT_RX_BUF_LEN)
+		length = AWS_IOT_MQTT_RX_BUF_LEN;
+	memset(cmd, 0, sizeof(cmd));
 	strncpy(cmd, (char *)params->payload, length);
 
 	if (length > 0) {
@@ -136,14 +202,24 @@ static void *aws_iot_mqtt_yield_thread_runner(void *ptr)
 	IoT_Error_t rc = SUCCESS;
 	AWS_IoT_Client *pClient = (AWS_IoT_Client *) ptr;
 
-	while(SUCCESS == rc && terminate_yield_thread == false) {
+	// keep yielding while auto reconnect brings the link back
+	while((SUCCESS == rc || NETWORK_ATTEMPTING_RECONNECT == rc || NETWORK_RECONNECTED == rc) &&
+			terminate_yield_thread == false) {
 		do {
 			usleep(THREAD_SLEEP_INTERVAL_USEC);
 			rc = aws_iot_mqtt_yield(pClient, 100);
 		} while(MQTT_CLIENT_NOT_IDLE_ERROR == rc); // Client is busy, wait to get lock
 
+		if(NETWORK_RECONNECTED == rc) {
+			// the link may have come back on another network
+			mqtt_keepalive_load(pClient);
+		}
+
 		if(SUCCESS != rc) {
 			IOT_DEBUG("Yield Returned : %d\n", rc);
+		} else {
+			mqtt_keepalive_save(pClient);
+			publish_metrics(pClient);
 		}
 	}
 	IOT_DEBUG("Yield Thread Runner terminating  rc : %d, terminate_yield_thread : %d\n", rc, terminate_yield_thread);
@@ -168,6 +244,7 @@ int init_mqtt(void)
 	//AWS_IoT_Client client;
 	IoT_Client_Init_Params mqttInitParams = iotClientInitParamsDefault;
 	IoT_Client_Connect_Params connectParams = iotClientConnectParamsDefault;
+	IoT_MQTT_Subscription subscription;
 
 	IOT_INFO("AWS IoT SDK Version %d.%d.%d-%s\n", VERSION_MAJOR, VERSION_MINOR, VERSION_PATCH, VERSION_TAG);
 
@@ -196,6 +273,11 @@ int init_mqtt(void)
 	mqttInitParams.isSSLHostnameVerify = true;
 	mqttInitParams.disconnectHandler = disconnectCallbackHandler;
 	mqttInitParams.disconnectHandlerData = NULL;
+	/* callbacks run on the dispatch workers, a slow one never holds back the keepalive */
+	mqttInitParams.dispatchHandler = mqtt_dispatch;
+	mqttInitParams.dispatchHandlerData = NULL;
+	/* ping only as often as the network needs to keep the idle link */
+	mqttInitParams.isAdaptiveKeepAliveEnabled = true;
 
 	rc = aws_iot_mqtt_init(&client, &mqttInitParams);
 	if(SUCCESS != rc) {
@@ -203,17 +285,32 @@ int init_mqtt(void)
 		return rc;
 	}
 
+	aws_iot_mqtt_set_packet_read_handler(&client, packet_read_handler, NULL);
+
+	// the client state was reset, so is the learned keepalive
+	mqtt_keepalive_reset();
+	mqtt_keepalive_load(&client);
+
+	/* the MQTT ping interval adapts up to this, TCP keepalive finds an idle dead link once it settled */
 	connectParams.keepAliveIntervalInSec = 600;
-	connectParams.isCleanSession = true;
+	/* the broker keeps the subscription and queues QoS1 commands across short disconnects */
+	connectParams.isCleanSession = false;
 	connectParams.MQTTVersion = MQTT_3_1_1;
 	connectParams.pClientID = AWS_IOT_MQTT_CLIENT_ID;
 	connectParams.clientIDLen = (uint16_t) strlen(AWS_IOT_MQTT_CLIENT_ID);
 	connectParams.isWillMsgPresent = false;
 
+	/* the command topic is subscribed in the same round trip as the CONNECT */
+	subscription.pTopicName = TOPIC_SUB;
+	subscription.topicNameLen = (uint16_t) strlen(TOPIC_SUB);
+	subscription.qos = QOS1;
+	subscription.pApplicationHandler = iot_subscribe_callback_handler;
+	subscription.pApplicationHandlerData = NULL;
+
 	IOT_DEBUG("Connecting Client\n");
 	do {
 		gettimeofday(&start, NULL);
-		rc = aws_iot_mqtt_connect(&client, &connectParams);
+		rc = aws_iot_mqtt_connect_subscribe(&client, &connectParams, &subscription, 1);
 		gettimeofday(&end, NULL);
 		timersub(&end, &start, &connectTime);
 
@@ -227,6 +324,12 @@ int init_mqtt(void)
 		return -1;
 	}
 
+	if(QOS_SUBACK_FAILURE == subscription.grantedQoS) {
+		IOT_ERROR("Subscribe to %s refused\n", TOPIC_SUB);
+		return FAILURE;
+	}
+	INFO("OK\n");
+
 	/*
 	 * Enable Auto Reconnect functionality. Minimum and Maximum time of Exponential backoff are set in aws_iot_config.h
 	 *  #AWS_IOT_MQTT_MIN_RECONNECT_WAIT_INTERVAL
@@ -238,21 +341,14 @@ int init_mqtt(void)
 		return rc;
 	}
 
-	IOT_INFO("Subscribing...");
-	rc = aws_iot_mqtt_subscribe(&client, TOPIC_SUB, strlen(TOPIC_SUB), QOS0, iot_subscribe_callback_handler, NULL);
-	if(SUCCESS != rc) {
-		IOT_ERROR("Error subscribing : %d\n", rc);
-		return rc;
-	} else {
-		mqtt_initalized = true;
-		INFO("OK\n");
-	}
-
 	yieldThreadReturn = pthread_create(&yield_thread, NULL, aws_iot_mqtt_yield_thread_runner, &client);
 	if(SUCCESS != yieldThreadReturn) {
 		IOT_ERROR("An error occurred pthread_create.\n");
+		rc = FAILURE;
 	} else {
 		IOT_INFO("pthread_create - yield_thread done\n");
+		/* only once the client is connected and yielded on */
+		mqtt_initalized = true;
 	}
 
 	if(SUCCESS != rc) {
@@ -0,0 +1,365 @@
+/*
+ * Copyright (c) 2018 Samsung Electronics Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <app_common.h>
+#include <peripheral_io.h>
+#include "remote_key.h"
+#include "ir_frame.h"
+#include "ir_codebook.h"
+#include "log.h"
+
+#define CODEBOOK_PATH_MAX		256
+
+/*
+ * The codebook file is mapped read-only and used in place. A reload maps
+ * the new file and swaps it in; the old mapping stays until the last
+ * queued job referencing it is done.
+ */
+struct ir_codebook {
+	void *map;
+	size_t size;
+	const codebook_header_t *header;
+	const codebook_entry_t *entries;
+	const uint32_t *buckets;
+	const uint32_t *durations;
+	uint32_t duration_count;
+	const char *strings;
+	int refcount;
+};
+
+static ir_codebook_t *g_book = NULL;
+static pthread_mutex_t g_book_lock = PTHREAD_MUTEX_INITIALIZER;
+static char g_book_path[CODEBOOK_PATH_MAX];
+
+extern int device_emitter[];
+extern peripheral_error_e resource_irtx_transmit(int emitter, const ir_frame_t *frame);
+extern bool resource_irtx_is_available(int emitter);
+extern bool remocon_queue_preempted(int emitter, int priority);
+extern void write_led(bool on);
+
+static bool codebook_section_valid(uint32_t offset, uint64_t length, size_t size)
+{
+	return (offset % sizeof(uint32_t) == 0 && offset <= size && length <= size - offset);
+}
+
+/*
+ * Only the header is checked here, entries are checked when they are
+ * looked up, so a load does not walk the whole file.
+ */
+static int codebook_validate(ir_codebook_t *book)
+{
+	const codebook_header_t *h = book->header;
+
+	if (book->size < sizeof(*h) || h->magic != CODEBOOK_MAGIC) {
+		ERR("not a codebook file");
+		return -1;
+	}
+
+	if (h->version != CODEBOOK_VERSION) {
+		ERR("codebook version [%u] is not supported", h->version);
+		return -1;
+	}
+
+	if (h->file_size != book->size || h->hash_size == 0 ||
+		(h->hash_size & (h->hash_size - 1)) != 0 ||
+		h->durations_offset > h->strings_offset ||
+		!codebook_section_valid(h->entries_offset, (uint64_t)h->entry_count * sizeof(codebook_entry_t), book->size) ||
+		!codebook_section_valid(h->buckets_offset, (uint64_t)h->hash_size * sizeof(uint32_t), book->size) ||
+		!codebook_section_valid(h->durations_offset, h->strings_offset - h->durations_offset, book->size) ||
+		h->strings_size == 0 || h->strings_offset > book->size ||
+		h->strings_size > book->size - h->strings_offset) {
+		ERR("codebook file is corrupted");
+		return -1;
+	}
+
+	book->entries = (const codebook_entry_t *)((const char *)book->map + h->entries_offset);
+	book->buckets = (const uint32_t *)((const char *)book->map + h->buckets_offset);
+	book->durations = (const uint32_t *)((const char *)book->map + h->durations_offset);
+	book->duration_count = (h->strings_offset - h->durations_offset) / sizeof(uint32_t);
+	book->strings = (const char *)book->map + h->strings_offset;
+
+	// every name is terminated inside the table
+	if (book->strings[h->strings_size - 1] != '\0') {
+		ERR("codebook string table is not terminated");
+		return -1;
+	}
+
+	return 0;
+}
+
+/*
+ * The carrier is checked as the compiler does, the transmitter divides by
+ * it, and the device indexes the emitter of each device.
+ */
+static bool codebook_entry_valid(const ir_codebook_t *book, const codebook_entry_t *entry)
+{
+	return (entry->name_offset < book->header->strings_size &&
+		entry->carrier >= CODEBOOK_MIN_CARRIER && entry->carrier <= CODEBOOK_MAX_CARRIER &&
+		entry->device < DEVICE_NUM &&
+		entry->next <= book->header->entry_count &&
+		entry->frame_len > 0 && entry->frame_len <= IR_FRAME_MAX_LEN &&
+		entry->frame_offset <= book->duration_count &&
+		entry->frame_len <= book->duration_count - entry->frame_offset &&
+		entry->repeat_len <= IR_FRAME_MAX_LEN &&
+		entry->repeat_offset <= book->duration_count &&
+		entry->repeat_len <= book->duration_count - entry->repeat_offset);
+}
+
+static ir_codebook_t *codebook_map(const char *path)
+{
+	ir_codebook_t *book;
+	struct stat st;
+	int fd;
+
+	fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return NULL;
+
+	if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+		close(fd);
+		return NULL;
+	}
+
+	book = calloc(1, sizeof(*book));
+	if (book == NULL) {
+		close(fd);
+		return NULL;
+	}
+
+	book->size = st.st_size;
+	book->map = mmap(NULL, book->size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+
+	if (book->map == MAP_FAILED) {
+		ERR("mmap() of [%s] failed", path);
+		free(book);
+		return NULL;
+	}
+
+	book->header = book->map;
+	book->refcount = 1;
+
+	if (codebook_validate(book) != 0) {
+		munmap(book->map, book->size);
+		free(book);
+		return NULL;
+	}
+
+	return book;
+}
+
+void remocon_codebook_put(ir_codebook_t *book)
+{
+	int refcount;
+
+	pthread_mutex_lock(&g_book_lock);
+	refcount = --book->refcount;
+	pthread_mutex_unlock(&g_book_lock);
+
+	if (refcount == 0) {
+		munmap(book->map, book->size);
+		free(book);
+	}
+}
+
+/*
+ * Map the codebook file of the app and swap it in.
+ * A new file is installed by writing it next to the old one and renaming
+ * it over, then sending CODEBOOK:RELOAD.
+ */
+int remocon_codebook_reload(void)
+{
+	ir_codebook_t *book;
+	ir_codebook_t *old;
+
+	book = codebook_map(g_book_path);
+	if (book == NULL)
+		return -1;
+
+	pthread_mutex_lock(&g_book_lock);
+	old = g_book;
+	g_book = book;
+	pthread_mutex_unlock(&g_book_lock);
+
+	if (old != NULL)
+		remocon_codebook_put(old);
+
+	INFO("codebook [%s] loaded, %u keys", g_book_path, book->header->entry_count);
+
+	return 0;
+}
+
+/*
+ * Find a key in the current codebook.
+ * Returns the entry index and a reference to the codebook in 'book',
+ * or -1 when the key is not there.
+ */
+int remocon_codebook_find(const char *name, ir_codebook_t **book)
+{
+	const codebook_entry_t *entry;
+	ir_codebook_t *b;
+	uint32_t hash = codebook_hash(name);
+	uint32_t next;
+	uint32_t steps;
+
+	pthread_mutex_lock(&g_book_lock);
+	b = g_book;
+	if (b == NULL) {
+		pthread_mutex_unlock(&g_book_lock);
+		return -1;
+	}
+	b->refcount++;
+	pthread_mutex_unlock(&g_book_lock);
+
+	next = b->buckets[hash & (b->header->hash_size - 1)];
+	for (steps = 0; next != 0 && steps < b->header->entry_count; steps++) {
+		if (next > b->header->entry_count)
+			break;
+
+		entry = &b->entries[next - 1];
+		if (!codebook_entry_valid(b, entry)) {
+			ERR("codebook entry [%u] is corrupted", next - 1);
+			break;
+		}
+
+		if (entry->name_hash == hash && 0 == strcmp(b->strings + entry->name_offset, name)) {
+			*book = b;
+			return next - 1;
+		}
+		next = entry->next;
+	}
+
+	remocon_codebook_put(b);
+
+	return -1;
+}
+
+int remocon_codebook_emitter(const ir_codebook_t *book, int entry)
+{
+	// the device was checked on lookup
+	int emitter = device_emitter[book->entries[entry].device];
+
+	if (!resource_irtx_is_available(emitter))
+		emitter = EMITTER_MAIN;
+
+	return emitter;
+}
+
+int remocon_codebook_device(const ir_codebook_t *book, int entry)
+{
+	return book->entries[entry].device;
+}
+
+int remocon_codebook_priority(const ir_codebook_t *book, int entry)
+{
+	int priority = book->entries[entry].priority;
+
+	return (priority < PRIORITY_NUM) ? priority : PRIORITY_NORMAL;
+}
+
+static void codebook_frame(const ir_codebook_t *book, uint32_t offset, int len, unsigned int carrier, ir_frame_t *frame)
+{
+	ir_frame_init(frame, carrier);
+	memcpy(frame->duration, &book->durations[offset], len * sizeof(uint32_t));
+	frame->len = len;
+}
+
+/*
+ * Send 'count' presses of a codebook key. The first press sends the frame
+ * send_count times, further presses send the repeat frame when there is
+ * one. Returns the number of presses sent before a more urgent command
+ * took over.
+ */
+int send_codebook_repeat(ir_codebook_t *book, int entry, int count)
+{
+	const codebook_entry_t *e = &book->entries[entry];
+	int emitter = remocon_codebook_emitter(book, entry);
+	int priority = remocon_codebook_priority(book, entry);
+	ir_frame_t frame;
+	int frames;
+	int i, j;
+
+	INFO("codebook %d : %s x %d", entry, book->strings + e->name_offset, count);
+
+	write_led(true);
+
+	for (i = 0; i < count; i++) {
+		if (i > 0 && remocon_queue_preempted(emitter, priority))
+			break;
+
+		if (i > 0 && e->repeat_len > 0) {
+			codebook_frame(book, e->repeat_offset, e->repeat_len, e->carrier, &frame);
+			frames = 1;
+		} else {
+			codebook_frame(book, e->frame_offset, e->frame_len, e->carrier, &frame);
+			frames = (i == 0 && e->send_count > 0) ? e->send_count : 1;
+		}
+
+		for (j = 0; j < frames; j++) {
+			if (resource_irtx_transmit(emitter, &frame) != PERIPHERAL_ERROR_NONE) {
+				write_led(false);
+				return -1;
+			}
+		}
+	}
+
+	write_led(false);
+
+	return i;
+}
+
+int remocon_codebook_init(void)
+{
+	char *data_path = app_get_data_path();
+
+	if (data_path == NULL) {
+		ERR("app_get_data_path() failed");
+		return -1;
+	}
+
+	snprintf(g_book_path, sizeof(g_book_path), "%s%s", data_path, CODEBOOK_FILE_NAME);
+	free(data_path);
+
+	// the codebook is optional, the built-in keys work without it
+	if (remocon_codebook_reload() != 0)
+		WARN("no codebook loaded from [%s]", g_book_path);
+
+	return 0;
+}
+
+void remocon_codebook_close(void)
+{
+	ir_codebook_t *book;
+
+	pthread_mutex_lock(&g_book_lock);
+	book = g_book;
+	g_book = NULL;
+	pthread_mutex_unlock(&g_book_lock);
+
+	if (book != NULL)
+		remocon_codebook_put(book);
+}
@@ -0,0 +1,543 @@
+/*
+ * Copyright (c) 2018 Samsung Electronics Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include <pthread.h>
+#include <app_common.h>
+#include "remote_key.h"
+#include "log.h"
+
+#define MACRO_PREFIX		"MACRO:"
+#define MACRO_SET_PREFIX	"MACRO_SET:"
+#define MACRO_FILE_NAME		"macros.conf"
+
+#define MACRO_MAX			16
+#define MACRO_NAME_MAX		32
+#define MACRO_LINE_MAX		512
+#define MACRO_STEP_MAX		32
+#define MACRO_LANE_MAX		4
+#define MACRO_RUN_MAX		4
+#define MACRO_COUNT_MAX		50
+#define MACRO_WAIT_MAX		(10 * 60 * 1000)	// msec
+#define MACRO_PRESS_GAP		150		// msec between the presses of KEY*n
+
+/*
+ * A macro is a plan of lanes separated by '|', each lane a list of steps
+ * separated by ','. A step is a key with an optional press count or a wait
+ * in msec, e.g.
+ *
+ *   movie_night = TV_KEY_POWER, wait 8000, TV_KEY_MENU, TV_KEY_VOLUMEUP*12 | VA_KEY_HOME
+ *
+ * Lanes run side by side. The keys of a lane are queued at once, so they
+ * go out back-to-back on their emitter and keys of lanes on the same
+ * emitter are interleaved by the queue. KEY*n is n separate presses, each
+ * queued MACRO_PRESS_GAP after the previous one was sent, so the device
+ * does not see a single held key. A wait starts once every key before it
+ * in the lane has been sent.
+ */
+typedef struct {
+	char key[MACRO_NAME_MAX];	// empty for a wait
+	int count;
+	int wait_ms;
+} macro_step_t;
+
+typedef struct {
+	char name[MACRO_NAME_MAX];
+	char plan[MACRO_LINE_MAX];
+	macro_step_t steps[MACRO_STEP_MAX];
+	int step_count;
+	int lane_end[MACRO_LANE_MAX];	// lane i runs steps lane_end[i - 1] to lane_end[i] - 1
+	int lane_count;
+} macro_t;
+
+typedef struct {
+	int next;
+	int pending;			// keys queued but not sent yet
+	int presses;			// presses of the current step queued so far
+	bool waiting;
+	struct timespec due;
+} macro_lane_t;
+
+typedef struct {
+	bool active;
+	macro_t macro;
+	macro_lane_t lanes[MACRO_LANE_MAX];
+	struct timespec start;
+} macro_run_t;
+
+static macro_t g_macros[MACRO_MAX];
+static int g_macro_count = 0;
+static macro_run_t g_runs[MACRO_RUN_MAX];
+static char g_macro_path[256];
+
+static pthread_mutex_t g_macro_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_macro_cond;
+static pthread_t g_macro_thread;
+static bool g_macro_running = false;
+
+extern int remocon_push_key(const char *name, int count, remocon_done_cb done, void *data);
+
+static char *macro_trim(char *text)
+{
+	char *end;
+
+	while (isspace((unsigned char)*text))
+		text++;
+
+	end = text + strlen(text);
+	while (end > text && isspace((unsigned char)end[-1]))
+		*--end = '\0';
+
+	return text;
+}
+
+static int macro_parse_step(char *text, macro_step_t *step)
+{
+	char *count;
+	char *end;
+
+	text = macro_trim(text);
+
+	if (0 == strncmp(text, "wait", 4) && isspace((unsigned char)text[4])) {
+		step->key[0] = '\0';
+		step->count = 0;
+		step->wait_ms = strtol(text + 5, &end, 10);
+		return (end != text + 5 && *end == '\0' && step->wait_ms >= 0 && step->wait_ms <= MACRO_WAIT_MAX) ? 0 : -1;
+	}
+
+	step->count = 1;
+	step->wait_ms = 0;
+
+	count = strchr(text, '*');
+	if (count != NULL) {
+		*count++ = '\0';
+		step->count = strtol(count, &end, 10);
+		if (end == count || *end != '\0' || step->count < 1 || step->count > MACRO_COUNT_MAX)
+			return -1;
+		text = macro_trim(text);
+	}
+
+	if (*text == '\0' || strlen(text) >= sizeof(step->key))
+		return -1;
+
+	snprintf(step->key, sizeof(step->key), "%s", text);
+
+	return 0;
+}
+
+static int macro_parse(const char *name, const char *plan, macro_t *macro)
+{
+	char buf[MACRO_LINE_MAX];
+	char *lane_save, *step_save;
+	char *lane, *step;
+
+	if (*name == '\0' || strlen(name) >= sizeof(macro->name) || strlen(plan) >= sizeof(macro->plan))
+		return -1;
+
+	memset(macro, 0, sizeof(*macro));
+	snprintf(macro->name, sizeof(macro->name), "%s", name);
+	snprintf(macro->plan, sizeof(macro->plan), "%s", plan);
+	snprintf(buf, sizeof(buf), "%s", plan);
+
+	for (lane = strtok_r(buf, "|", &lane_save); lane != NULL; lane = strtok_r(NULL, "|", &lane_save)) {
+		if (macro->lane_count == MACRO_LANE_MAX)
+			return -1;
+
+		for (step = strtok_r(lane, ",", &step_save); step != NULL; step = strtok_r(NULL, ",", &step_save)) {
+			if (macro->step_count == MACRO_STEP_MAX ||
+				macro_parse_step(step, &macro->steps[macro->step_count]) != 0)
+				return -1;
+			macro->step_count++;
+		}
+		macro->lane_end[macro->lane_count++] = macro->step_count;
+	}
+
+	return (macro->step_count > 0) ? 0 : -1;
+}
+
+static macro_t *macro_find(const char *name)
+{
+	int i;
+
+	for (i = 0; i < g_macro_count; i++) {
+		if (0 == strcmp(g_macros[i].name, name))
+			return &g_macros[i];
+	}
+
+	return NULL;
+}
+
+// written next to the old file and renamed over it
+static int macro_save(void)
+{
+	char tmp_path[sizeof(g_macro_path) + 4];
+	FILE *fp;
+	int i;
+
+	snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", g_macro_path);
+	fp = fopen(tmp_path, "w");
+	if (fp == NULL) {
+		ERR("fopen() of [%s] failed", tmp_path);
+		return -1;
+	}
+
+	for (i = 0; i < g_macro_count; i++)
+		fprintf(fp, "%s = %s\n", g_macros[i].name, g_macros[i].plan);
+
+	if (fclose(fp) != 0 || rename(tmp_path, g_macro_path) != 0) {
+		ERR("saving [%s] failed", g_macro_path);
+		remove(tmp_path);
+		return -1;
+	}
+
+	return 0;
+}
+
+static void macro_load(void)
+{
+	char line[MACRO_NAME_MAX + MACRO_LINE_MAX + 4];
+	char *plan;
+	FILE *fp;
+
+	fp = fopen(g_macro_path, "r");
+	if (fp == NULL) {
+		INFO("no macros in [%s]", g_macro_path);
+		return;
+	}
+
+	while (fgets(line, sizeof(line), fp) != NULL && g_macro_count < MACRO_MAX) {
+		if (line[0] == '#')
+			continue;
+
+		plan = strchr(line, '=');
+		if (plan == NULL)
+			continue;
+		*plan++ = '\0';
+
+		if (macro_parse(macro_trim(line), macro_trim(plan), &g_macros[g_macro_count]) != 0) {
+			ERR("invalid macro [%s]", macro_trim(line));
+			continue;
+		}
+		g_macro_count++;
+	}
+
+	fclose(fp);
+
+	INFO("%d macros loaded", g_macro_count);
+}
+
+static void macro_key_done(void *data)
+{
+	macro_lane_t *lane = data;
+
+	pthread_mutex_lock(&g_macro_lock);
+	lane->pending--;
+	pthread_cond_signal(&g_macro_cond);
+	pthread_mutex_unlock(&g_macro_lock);
+}
+
+static bool timespec_before(const struct timespec *a, const struct timespec *b)
+{
+	return (a->tv_sec < b->tv_sec || (a->tv_sec == b->tv_sec && a->tv_nsec < b->tv_nsec));
+}
+
+static void timespec_add_msec(struct timespec *ts, int msec)
+{
+	ts->tv_sec += msec / 1000;
+	ts->tv_nsec += (msec % 1000) * 1000000L;
+	if (ts->tv_nsec >= 1000000000L) {
+		ts->tv_sec++;
+		ts->tv_nsec -= 1000000000L;
+	}
+}
+
+/*
+ * Wait until every queued key of the lane is sent and 'msec' more passed.
+ * Returns true once the wait is over.
+ */
+static bool macro_lane_wait(macro_lane_t *lane, int msec, const struct timespec *now,
+	struct timespec *next_due, bool *has_due)
+{
+	if (lane->pending > 0)
+		return false;
+
+	if (!lane->waiting) {
+		lane->due = *now;
+		timespec_add_msec(&lane->due, msec);
+		lane->waiting = true;
+	}
+
+	if (timespec_before(now, &lane->due)) {
+		if (!*has_due || timespec_before(&lane->due, next_due))
+			*next_due = lane->due;
+		*has_due = true;
+		return false;
+	}
+
+	lane->waiting = false;
+
+	return true;
+}
+
+/*
+ * Queue the keys of a lane up to its next wait. Called with g_macro_lock.
+ * Returns true when the lane is finished.
+ */
+static bool macro_lane_advance(macro_run_t *run, int lane_no, const struct timespec *now,
+	struct timespec *next_due, bool *has_due)
+{
+	macro_lane_t *lane = &run->lanes[lane_no];
+	macro_step_t *step;
+
+	while (lane->next < run->macro.lane_end[lane_no]) {
+		step = &run->macro.steps[lane->next];
+
+		if (step->key[0] == '\0') {
+			if (!macro_lane_wait(lane, step->wait_ms, now, next_due, has_due))
+				return false;
+			lane->next++;
+			continue;
+		}
+
+		if (lane->presses > 0 && !macro_lane_wait(lane, MACRO_PRESS_GAP, now, next_due, has_due))
+			return false;
+
+		lane->pending++;
+		if (remocon_push_key(step->key, 1, macro_key_done, lane) != 0) {
+			lane->pending--;
+			ERR("macro [%s] : key [%s] failed", run->macro.name, step->key);
+		}
+
+		if (++lane->presses == step->count) {
+			lane->presses = 0;
+			lane->next++;
+		}
+	}
+
+	return (lane->pending == 0);
+}
+
+static void *macro_engine(void *data)
+{
+	struct timespec now;
+	struct timespec next_due;
+	macro_run_t *run;
+	bool has_due;
+	bool finished;
+	int i, j;
+
+	pthread_mutex_lock(&g_macro_lock);
+
+	while (g_macro_running) {
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		has_due = false;
+
+		for (i = 0; i < MACRO_RUN_MAX; i++) {
+			run = &g_runs[i];
+			if (!run->active)
+				continue;
+
+			finished = true;
+			for (j = 0; j < run->macro.lane_count; j++) {
+				if (!macro_lane_advance(run, j, &now, &next_due, &has_due))
+					finished = false;
+			}
+
+			if (finished) {
+				clock_gettime(CLOCK_MONOTONIC, &now);
+				INFO("macro [%s] done in %ld ms", run->macro.name,
+					(now.tv_sec - run->start.tv_sec) * 1000 + (now.tv_nsec - run->start.tv_nsec) / 1000000);
+				run->active = false;
+			}
+		}
+
+		if (has_due)
+			pthread_cond_timedwait(&g_macro_cond, &g_macro_lock, &next_due);
+		else
+			pthread_cond_wait(&g_macro_cond, &g_macro_lock);
+	}
+
+	pthread_mutex_unlock(&g_macro_lock);
+
+	return NULL;
+}
+
+static int macro_run(const char *name)
+{
+	macro_run_t *run = NULL;
+	macro_t *macro;
+	int i;
+
+	pthread_mutex_lock(&g_macro_lock);
+
+	macro = macro_find(name);
+	if (macro == NULL) {
+		pthread_mutex_unlock(&g_macro_lock);
+		ERR("macro [%s] is not defined", name);
+		return -1;
+	}
+
+	for (i = 0; i < MACRO_RUN_MAX; i++) {
+		if (!g_runs[i].active) {
+			run = &g_runs[i];
+			break;
+		}
+	}
+
+	// a slot is reused only after every key it queued is sent
+	if (run == NULL || !g_macro_running) {
+		pthread_mutex_unlock(&g_macro_lock);
+		ERR("macro [%s] can not be started", name);
+		return -1;
+	}
+
+	memset(run, 0, sizeof(*run));
+	run->macro = *macro;
+	for (i = 1; i < macro->lane_count; i++)
+		run->lanes[i].next = macro->lane_end[i - 1];
+	run->active = true;
+	clock_gettime(CLOCK_MONOTONIC, &run->start);
+
+	pthread_cond_signal(&g_macro_cond);
+	pthread_mutex_unlock(&g_macro_lock);
+
+	INFO("macro [%s] started", name);
+
+	return 0;
+}
+
+/*
+ * MACRO_SET:<name>=<plan> defines or replaces a macro, an empty plan
+ * deletes it
+ */
+static int macro_set(char *text)
+{
+	macro_t macro;
+	macro_t *old;
+	char *plan;
+	int ret;
+
+	plan = strchr(text, '=');
+	if (plan == NULL)
+		return -1;
+	*plan++ = '\0';
+	text = macro_trim(text);
+	plan = macro_trim(plan);
+
+	pthread_mutex_lock(&g_macro_lock);
+
+	old = macro_find(text);
+
+	if (*plan == '\0') {
+		if (old != NULL) {
+			*old = g_macros[--g_macro_count];
+			ret = macro_save();
+		} else {
+			ret = -1;
+		}
+		pthread_mutex_unlock(&g_macro_lock);
+		return ret;
+	}
+
+	if (macro_parse(text, plan, &macro) != 0 || (old == NULL && g_macro_count == MACRO_MAX)) {
+		pthread_mutex_unlock(&g_macro_lock);
+		ERR("invalid macro [%s]", text);
+		return -1;
+	}
+
+	if (old == NULL)
+		old = &g_macros[g_macro_count++];
+	*old = macro;
+	ret = macro_save();
+
+	pthread_mutex_unlock(&g_macro_lock);
+
+	INFO("macro [%s] set : %s", macro.name, macro.plan);
+
+	return ret;
+}
+
+bool remocon_macro_is_macro(const char *cmd)
+{
+	return (0 == strncmp(cmd, MACRO_PREFIX, strlen(MACRO_PREFIX)) ||
+		0 == strncmp(cmd, MACRO_SET_PREFIX, strlen(MACRO_SET_PREFIX)));
+}
+
+bool process_macro_command(const char *cmd)
+{
+	char buf[MACRO_NAME_MAX + MACRO_LINE_MAX + 4];
+
+	if (0 == strncmp(cmd, MACRO_PREFIX, strlen(MACRO_PREFIX)))
+		return (macro_run(cmd + strlen(MACRO_PREFIX)) == 0);
+
+	if (strlen(cmd + strlen(MACRO_SET_PREFIX)) >= sizeof(buf))
+		return false;
+	snprintf(buf, sizeof(buf), "%s", cmd + strlen(MACRO_SET_PREFIX));
+
+	return (macro_set(buf) == 0);
+}
+
+int remocon_macro_init(void)
+{
+	pthread_condattr_t attr;
+	char *data_path = app_get_data_path();
+	int ret;
+
+	if (data_path == NULL) {
+		ERR("app_get_data_path() failed");
+		return -1;
+	}
+
+	snprintf(g_macro_path, sizeof(g_macro_path), "%s%s", data_path, MACRO_FILE_NAME);
+	free(data_path);
+
+	macro_load();
+
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_cond_init(&g_macro_cond, &attr);
+	pthread_condattr_destroy(&attr);
+
+	g_macro_running = true;
+	ret = pthread_create(&g_macro_thread, NULL, macro_engine, NULL);
+	if (ret != 0) {
+		ERR("pthread_create() failed!![%d]", ret);
+		g_macro_running = false;
+		return ret;
+	}
+
+	return 0;
+}
+
+void remocon_macro_close(void)
+{
+	pthread_mutex_lock(&g_macro_lock);
+	if (!g_macro_running) {
+		pthread_mutex_unlock(&g_macro_lock);
+		return;
+	}
+	g_macro_running = false;
+	pthread_cond_signal(&g_macro_cond);
+	pthread_mutex_unlock(&g_macro_lock);
+
+	pthread_join(g_macro_thread, NULL);
+}
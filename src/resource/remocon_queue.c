@@ -0,0 +1,468 @@
+/*
+ * Copyright (c) 2018 Samsung Electronics Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdbool.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+#include "remote_key.h"
+#include "ir_frame.h"
+#include "ir_codebook.h"
+#include "latency.h"
+#include "log.h"
+
+#define REMOCON_QUEUE_SIZE		16
+
+// upper bound of presses merged into one transmission
+#define REMOCON_MAX_COALESCE	20
+
+typedef struct {
+	int index;				// index of cmd_table, -1 for a raw or codebook frame
+	ir_raw_t *raw;			// referenced raw frame
+	ir_codebook_t *book;	// referenced codebook
+	int entry;				// entry of the codebook
+	int count;				// number of coalesced presses
+	unsigned long seq;		// push order within the queue
+	remocon_done_cb done;	// completion of the job, never merged
+	void *done_data;
+	latency_trace_t trace;	// stamps of the first press
+	latency_trace_t merged_trace[REMOCON_MAX_COALESCE - 1];	// stamps of the presses merged in
+	int merged_len;
+	bool resumed;			// rest of a preempted job, its trace is already committed
+} remocon_job_t;
+
+typedef struct {
+	remocon_job_t jobs[REMOCON_QUEUE_SIZE];
+	int head;
+	int len;
+} remocon_ring_t;
+
+/*
+ * One queue and transmit worker per emitter, so commands aimed at devices
+ * behind different emitters go out at the same time.
+ * Each priority class has its own ring, so a full ring of volume presses
+ * never holds back an urgent key.
+ */
+typedef struct {
+	int emitter;
+	remocon_ring_t rings[PRIORITY_NUM];
+
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	pthread_t worker;
+	bool running;
+	unsigned long seq;
+
+	unsigned long merged_count;
+	unsigned long replaced_count;
+	unsigned long preempted_count;
+} remocon_queue_t;
+
+static remocon_queue_t g_queues[EMITTER_NUM];
+
+extern cmd_t cmd_table[];
+extern int send_remote_key_repeat(int index, int count);
+extern int remocon_get_emitter(int index);
+extern int send_raw_repeat(ir_raw_t *raw, int count);
+extern void remocon_raw_put(ir_raw_t *raw);
+extern int send_codebook_repeat(ir_codebook_t *book, int entry, int count);
+extern void remocon_codebook_put(ir_codebook_t *book);
+extern int remocon_codebook_emitter(const ir_codebook_t *book, int entry);
+extern int remocon_codebook_priority(const ir_codebook_t *book, int entry);
+extern int remocon_codebook_device(const ir_codebook_t *book, int entry);
+
+// drop the frame references a job holds
+static void remocon_job_put(const remocon_job_t *job)
+{
+	if (job->raw != NULL)
+		remocon_raw_put(job->raw);
+	if (job->book != NULL)
+		remocon_codebook_put(job->book);
+}
+
+static void remocon_job_done(const remocon_job_t *job)
+{
+	if (job->done != NULL)
+		job->done(job->done_data);
+}
+
+static bool remocon_job_same(const remocon_job_t *a, const remocon_job_t *b)
+{
+	return (a->index == b->index && a->raw == b->raw &&
+		a->book == b->book && a->entry == b->entry &&
+		a->done == NULL && b->done == NULL);
+}
+
+static remocon_job_t *ring_at(remocon_ring_t *ring, int pos)
+{
+	return &ring->jobs[(ring->head + pos) % REMOCON_QUEUE_SIZE];
+}
+
+// highest priority ring with a job waiting, NULL when all are empty
+static remocon_ring_t *next_ring(remocon_queue_t *q, int *priority)
+{
+	int i;
+
+	for (i = 0; i < PRIORITY_NUM; i++) {
+		if (q->rings[i].len > 0) {
+			*priority = i;
+			return &q->rings[i];
+		}
+	}
+
+	return NULL;
+}
+
+/*
+ * Presses merged into a queued job went out with it, account them too with
+ * the edges of the job they joined. Called before the job trace is committed.
+ */
+static void commit_merged_traces(remocon_job_t *job)
+{
+	latency_trace_t sent;
+	latency_trace_t *trace;
+	int i;
+
+	if (job->merged_len == 0)
+		return;
+
+	latency_trace_get(&sent);
+	for (i = 0; i < job->merged_len; i++) {
+		trace = &job->merged_trace[i];
+		trace->stamp[LATENCY_FIRST_EDGE] = sent.stamp[LATENCY_FIRST_EDGE];
+		trace->stamp[LATENCY_LAST_EDGE] = sent.stamp[LATENCY_LAST_EDGE];
+		latency_trace_set(trace);
+		latency_trace_commit();
+	}
+	latency_trace_set(&sent);
+	job->merged_len = 0;
+}
+
+static void *remocon_queue_worker(void *data)
+{
+	remocon_queue_t *q = data;
+	remocon_ring_t *ring;
+	remocon_job_t job;
+	int priority;
+	int sent;
+
+	while (1) {
+		pthread_mutex_lock(&q->lock);
+		while ((ring = next_ring(q, &priority)) == NULL && q->running)
+			pthread_cond_wait(&q->cond, &q->lock);
+
+		if (!q->running) {
+			pthread_mutex_unlock(&q->lock);
+			break;
+		}
+
+		job = ring->jobs[ring->head];
+		ring->head = (ring->head + 1) % REMOCON_QUEUE_SIZE;
+		ring->len--;
+		pthread_mutex_unlock(&q->lock);
+
+		if (job.count > 1)
+			INFO("index [%d] : %d presses coalesced", job.index, job.count);
+
+		latency_trace_set(&job.trace);
+		if (job.raw != NULL)
+			sent = send_raw_repeat(job.raw, job.count);
+		else if (job.book != NULL)
+			sent = send_codebook_repeat(job.book, job.entry, job.count);
+		else
+			sent = send_remote_key_repeat(job.index, job.count);
+		if (sent < 0)
+			ERR("index [%d] send failed", job.index);
+		commit_merged_traces(&job);
+		if (!job.resumed)
+			latency_trace_commit();
+
+		pthread_mutex_lock(&q->lock);
+
+		// preempted at a frame boundary, the rest goes back to the front
+		if (sent > 0 && sent < job.count) {
+			q->preempted_count++;
+			if (ring->len < REMOCON_QUEUE_SIZE) {
+				ring->head = (ring->head + REMOCON_QUEUE_SIZE - 1) % REMOCON_QUEUE_SIZE;
+				ring->len++;
+				ring->jobs[ring->head] = job;
+				ring->jobs[ring->head].count = job.count - sent;
+				// one request, one sample: the trace went with the first part
+				memset(&ring->jobs[ring->head].trace, 0, sizeof(latency_trace_t));
+				ring->jobs[ring->head].resumed = true;
+				job.raw = NULL;
+				job.book = NULL;
+				job.done = NULL;
+			} else {
+				ERR("index [%d] : %d presses dropped", job.index, job.count - sent);
+			}
+		}
+		pthread_mutex_unlock(&q->lock);
+
+		remocon_job_put(&job);
+		remocon_job_done(&job);
+	}
+
+	return NULL;
+}
+
+/*
+ * Called by the sender at every frame boundary of a run
+ */
+bool remocon_queue_preempted(int emitter, int priority)
+{
+	remocon_queue_t *q = &g_queues[emitter];
+	bool preempted = false;
+	int i;
+
+	pthread_mutex_lock(&q->lock);
+	for (i = 0; i < priority; i++) {
+		if (q->rings[i].len > 0) {
+			preempted = true;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&q->lock);
+
+	return preempted;
+}
+
+// device a job is aimed at, -1 for a raw frame
+static int remocon_job_device(const remocon_job_t *job)
+{
+	if (job->index >= 0)
+		return cmd_table[job->index].device;
+	if (job->book != NULL)
+		return remocon_codebook_device(job->book, job->entry);
+
+	return -1;
+}
+
+/*
+ * Mailbox commands of a device keep a single not yet started slot at the
+ * end of its queued jobs: a newer one overwrites it, so the device follows
+ * the latest request instead of replaying stale ones. A mailbox job with
+ * other jobs of the device queued after it is left alone, replacing it
+ * would move the new command ahead of them.
+ */
+static remocon_job_t *find_mailbox_job(remocon_queue_t *q, remocon_ring_t *ring, int device)
+{
+	remocon_job_t *job;
+	remocon_job_t *last = NULL;
+	remocon_ring_t *last_ring = NULL;
+	int i, j;
+
+	for (i = 0; i < PRIORITY_NUM; i++) {
+		for (j = 0; j < q->rings[i].len; j++) {
+			job = ring_at(&q->rings[i], j);
+			if (remocon_job_device(job) == device && (last == NULL || job->seq > last->seq)) {
+				last = job;
+				last_ring = &q->rings[i];
+			}
+		}
+	}
+
+	if (last != NULL && last_ring == ring && last->index >= 0 && last->done == NULL &&
+		(cmd_table[last->index].flags & CMD_FLAG_MAILBOX))
+		return last;
+
+	return NULL;
+}
+
+/*
+ * The queue takes over the frame references of 'job', also when it fails.
+ */
+static int remocon_queue_push_job(remocon_queue_t *q, remocon_ring_t *ring, const remocon_job_t *job)
+{
+	remocon_job_t *tail;
+	int index = job->index;
+
+	pthread_mutex_lock(&q->lock);
+
+	if (!q->running) {
+		pthread_mutex_unlock(&q->lock);
+		ERR("remocon queue [%d] is not running", q->emitter);
+		remocon_job_put(job);
+		return -1;
+	}
+
+	if (index >= 0 && job->done == NULL && (cmd_table[index].flags & CMD_FLAG_MAILBOX)) {
+		tail = find_mailbox_job(q, ring, cmd_table[index].device);
+		if (tail != NULL) {
+			DBG("index [%d] replaced by [%d]", tail->index, index);
+			tail->index = index;
+			tail->seq = q->seq++;
+			tail->count = 1;
+			// what goes out is the new command, so is the trace
+			latency_stamp(LATENCY_RESOLVED);
+			latency_trace_get(&tail->trace);
+			tail->merged_len = 0;
+			tail->resumed = false;
+			q->replaced_count++;
+			pthread_mutex_unlock(&q->lock);
+			return 0;
+		}
+	} else if (ring->len > 0) {
+		tail = ring_at(ring, ring->len - 1);
+		if (remocon_job_same(tail, job) && tail->count + job->count <= REMOCON_MAX_COALESCE) {
+			tail->count += job->count;
+			latency_stamp(LATENCY_RESOLVED);
+			latency_trace_get(&tail->merged_trace[tail->merged_len]);
+			// nothing to carry while latency is off
+			if (tail->merged_trace[tail->merged_len].stamp[LATENCY_RESOLVED] != 0)
+				tail->merged_len++;
+			q->merged_count++;
+			DBG("index [%d] merged, count [%d] total merged [%lu]", index, tail->count, q->merged_count);
+			pthread_mutex_unlock(&q->lock);
+			// the queued job already holds a reference
+			remocon_job_put(job);
+			return 0;
+		}
+	}
+
+	if (ring->len == REMOCON_QUEUE_SIZE) {
+		pthread_mutex_unlock(&q->lock);
+		ERR("remocon queue [%d] is full, index [%d] dropped", q->emitter, index);
+		remocon_job_put(job);
+		return -1;
+	}
+
+	tail = ring_at(ring, ring->len);
+	*tail = *job;
+	tail->seq = q->seq++;
+	latency_stamp(LATENCY_RESOLVED);
+	latency_trace_get(&tail->trace);
+	ring->len++;
+
+	pthread_cond_signal(&q->cond);
+	pthread_mutex_unlock(&q->lock);
+
+	return 0;
+}
+
+/*
+ * Queue 'count' presses of a key for the transmit worker of its emitter.
+ * Without 'done', a press identical to the last queued one that has not
+ * started yet is merged into it, so a held key goes out as one continuous
+ * transmission. 'done' is called from the transmit worker once the presses
+ * are sent, or dropped when the queue closes, but not when the push fails.
+ */
+int remocon_queue_push_key(int index, int count, remocon_done_cb done, void *data)
+{
+	remocon_queue_t *q = &g_queues[remocon_get_emitter(index)];
+	remocon_job_t job = {index, NULL, NULL, 0, count, 0, done, data, {{0}}, {{{0}}}, 0, false};
+
+	return remocon_queue_push_job(q, &q->rings[cmd_table[index].priority], &job);
+}
+
+/*
+ * Queue a raw frame for the main emitter. The queue takes over the
+ * reference of 'raw', also when it fails.
+ */
+int remocon_queue_push_raw(ir_raw_t *raw)
+{
+	remocon_queue_t *q = &g_queues[EMITTER_MAIN];
+	remocon_job_t job = {-1, raw, NULL, 0, 1, 0, NULL, NULL, {{0}}, {{{0}}}, 0, false};
+
+	return remocon_queue_push_job(q, &q->rings[PRIORITY_NORMAL], &job);
+}
+
+/*
+ * Queue 'count' presses of a codebook key for the emitter of its device,
+ * 'done' as for remocon_queue_push_key(). The queue takes over the
+ * reference of 'book', also when it fails.
+ */
+int remocon_queue_push_code(ir_codebook_t *book, int entry, int count, remocon_done_cb done, void *data)
+{
+	remocon_queue_t *q = &g_queues[remocon_codebook_emitter(book, entry)];
+	remocon_job_t job = {-1, NULL, book, entry, count, 0, done, data, {{0}}, {{{0}}}, 0, false};
+
+	return remocon_queue_push_job(q, &q->rings[remocon_codebook_priority(book, entry)], &job);
+}
+
+static void remocon_queue_stop(remocon_queue_t *q)
+{
+	remocon_ring_t *ring;
+	int i;
+
+	pthread_mutex_lock(&q->lock);
+	if (!q->running) {
+		pthread_mutex_unlock(&q->lock);
+		return;
+	}
+	q->running = false;
+	pthread_cond_broadcast(&q->cond);
+	pthread_mutex_unlock(&q->lock);
+
+	pthread_join(q->worker, NULL);
+
+	for (i = 0; i < PRIORITY_NUM; i++) {
+		ring = &q->rings[i];
+		while (ring->len > 0) {
+			remocon_job_put(&ring->jobs[ring->head]);
+			remocon_job_done(&ring->jobs[ring->head]);
+			ring->head = (ring->head + 1) % REMOCON_QUEUE_SIZE;
+			ring->len--;
+		}
+	}
+
+	INFO("remocon queue [%d] closed, total merged [%lu] replaced [%lu] preempted [%lu]",
+		q->emitter, q->merged_count, q->replaced_count, q->preempted_count);
+}
+
+int remocon_queue_init(void)
+{
+	remocon_queue_t *q;
+	int ret;
+	int i, j;
+
+	for (i = 0; i < EMITTER_NUM; i++) {
+		q = &g_queues[i];
+		q->emitter = i;
+		for (j = 0; j < PRIORITY_NUM; j++) {
+			q->rings[j].head = 0;
+			q->rings[j].len = 0;
+		}
+		q->seq = 0;
+		q->merged_count = 0;
+		q->replaced_count = 0;
+		q->preempted_count = 0;
+		pthread_mutex_init(&q->lock, NULL);
+		pthread_cond_init(&q->cond, NULL);
+		q->running = true;
+
+		ret = pthread_create(&q->worker, NULL, remocon_queue_worker, q);
+		if (ret != 0) {
+			ERR("pthread_create() failed!![%d]", ret);
+			q->running = false;
+			while (--i >= 0)
+				remocon_queue_stop(&g_queues[i]);
+			return ret;
+		}
+	}
+
+	return 0;
+}
+
+int remocon_queue_close(void)
+{
+	int i;
+
+	for (i = 0; i < EMITTER_NUM; i++)
+		remocon_queue_stop(&g_queues[i]);
+
+	return 0;
+}
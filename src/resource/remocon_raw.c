@@ -0,0 +1,320 @@
+/*
+ * Copyright (c) 2018 Samsung Electronics Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <peripheral_io.h>
+#include "remote_key.h"
+#include "ir_frame.h"
+#include "log.h"
+
+#define RAW_PREFIX			"RAW:"
+#define PRONTO_PREFIX		"PRONTO:"
+
+#define RAW_CACHE_SIZE		8
+#define RAW_PAYLOAD_MAX		512
+
+// accepted ranges of raw payloads
+#define RAW_MIN_DURATION	50			// usec
+#define RAW_MAX_DURATION	500000		// usec
+#define RAW_MIN_CARRIER		20000		// Hz
+#define RAW_MAX_CARRIER		60000		// Hz
+
+// trailing space of a raw frame which ends with a mark
+#define RAW_FRAME_GAP		40000		// usec
+
+// Pronto time base is the carrier period in units of 0.241246 usec
+#define PRONTO_CLOCK		0.241246
+#define PRONTO_WORD_MAX		0xFFFF
+
+/*
+ * Compiled raw frames are cached by the content of their payload, so a
+ * repeated raw command is not parsed again. Entries referenced by queued
+ * jobs are never evicted.
+ */
+struct ir_raw {
+	uint32_t hash;
+	int refcount;
+	unsigned long last_used;
+	char payload[RAW_PAYLOAD_MAX];
+	ir_frame_t frame;
+};
+
+static ir_raw_t g_cache[RAW_CACHE_SIZE];
+static unsigned long g_use_count = 0;
+static pthread_mutex_t g_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+
+extern int mark(ir_frame_t *frame, unsigned int time);
+extern int space(ir_frame_t *frame, unsigned int time);
+extern peripheral_error_e resource_irtx_transmit(int emitter, const ir_frame_t *frame);
+extern bool remocon_queue_preempted(int emitter, int priority);
+extern int remocon_queue_push_raw(ir_raw_t *raw);
+extern void write_led(bool on);
+
+// FNV-1a
+static uint32_t remocon_raw_hash(const char *payload)
+{
+	uint32_t hash = 2166136261u;
+
+	while (*payload) {
+		hash ^= (unsigned char)*payload++;
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+static bool remocon_raw_valid_duration(unsigned long time)
+{
+	return (time >= RAW_MIN_DURATION && time <= RAW_MAX_DURATION);
+}
+
+/*
+ * RAW:[<carrier>:]<mark>,<space>,<mark>,...
+ * durations in usec, carrier in Hz (38000 when omitted)
+ */
+static int remocon_raw_parse_raw(const char *text, ir_frame_t *frame)
+{
+	unsigned long carrier = IR_CARRIER_38KHZ;
+	unsigned long time;
+	const char *p = text;
+	char *end;
+	int i = 0;
+
+	if (strchr(text, ':') != NULL) {
+		carrier = strtoul(p, &end, 10);
+		if (end == p || *end != ':')
+			return -1;
+		p = end + 1;
+	}
+
+	if (carrier < RAW_MIN_CARRIER || carrier > RAW_MAX_CARRIER)
+		return -1;
+
+	ir_frame_init(frame, carrier);
+
+	while (*p) {
+		time = strtoul(p, &end, 10);
+		if (end == p || !remocon_raw_valid_duration(time))
+			return -1;
+		if (i >= IR_FRAME_MAX_LEN)
+			return -1;
+
+		if (((i % 2 == 0) ? mark(frame, time) : space(frame, time)) != 0)
+			return -1;
+		i++;
+
+		p = end;
+		if (*p == ',' || *p == ' ')
+			p++;
+		else if (*p != '\0')
+			return -1;
+	}
+
+	return (i > 0) ? 0 : -1;
+}
+
+/*
+ * PRONTO:0000 <frequency> <once pairs> <repeat pairs> <burst pairs...>
+ * Only learned (0000) codes are supported. The once sequence is used,
+ * or the repeat sequence when there is no once sequence.
+ */
+static int remocon_raw_parse_pronto(const char *text, ir_frame_t *frame)
+{
+	unsigned long words[4 + IR_FRAME_MAX_LEN];
+	unsigned long carrier;
+	double unit;
+	const char *p = text;
+	char *end;
+	int count = 0;
+	unsigned long start, pairs;
+	unsigned long i;
+
+	while (*p) {
+		while (*p == ' ')
+			p++;
+		if (*p == '\0')
+			break;
+		if (count == sizeof(words) / sizeof(words[0]))
+			return -1;
+		words[count] = strtoul(p, &end, 16);
+		if (end == p || (*end != ' ' && *end != '\0') || words[count] > PRONTO_WORD_MAX)
+			return -1;
+		count++;
+		p = end;
+	}
+
+	if (count < 4 || words[0] != 0 || words[1] == 0)
+		return -1;
+
+	// words are 16 bits, so this can not wrap
+	if ((unsigned long)count != 4 + 2 * (words[2] + words[3]))
+		return -1;
+
+	unit = words[1] * PRONTO_CLOCK;
+	carrier = (unsigned long)(1000000.0 / unit);
+	if (carrier < RAW_MIN_CARRIER || carrier > RAW_MAX_CARRIER)
+		return -1;
+
+	// with no once sequence the repeat sequence starts right after the header
+	start = 4;
+	pairs = (words[2] > 0) ? words[2] : words[3];
+
+	if (pairs == 0 || start + 2 * pairs > (unsigned long)count)
+		return -1;
+
+	ir_frame_init(frame, carrier);
+
+	for (i = 0; i < 2 * pairs; i++) {
+		unsigned long time = (unsigned long)(words[start + i] * unit + 0.5);
+
+		if (!remocon_raw_valid_duration(time))
+			return -1;
+
+		if (((i % 2 == 0) ? mark(frame, time) : space(frame, time)) != 0)
+			return -1;
+	}
+
+	return 0;
+}
+
+static int remocon_raw_compile(const char *payload, ir_frame_t *frame)
+{
+	int ret;
+
+	if (0 == strncmp(payload, RAW_PREFIX, strlen(RAW_PREFIX)))
+		ret = remocon_raw_parse_raw(payload + strlen(RAW_PREFIX), frame);
+	else
+		ret = remocon_raw_parse_pronto(payload + strlen(PRONTO_PREFIX), frame);
+
+	if (ret != 0)
+		return ret;
+
+	// keep frames apart when they are sent back-to-back
+	if (frame->len % 2 && space(frame, RAW_FRAME_GAP) != 0)
+		return -1;
+
+	return 0;
+}
+
+/*
+ * Look up the compiled frame of a payload, compiling it on a miss.
+ * Returns a referenced entry, or NULL when the payload is invalid or
+ * every entry is in use.
+ */
+static ir_raw_t *remocon_raw_get(const char *payload)
+{
+	uint32_t hash = remocon_raw_hash(payload);
+	ir_raw_t *victim = NULL;
+	ir_raw_t *raw;
+	ir_frame_t frame;
+	int i;
+
+	if (strlen(payload) >= RAW_PAYLOAD_MAX) {
+		ERR("raw payload is too long");
+		return NULL;
+	}
+
+	pthread_mutex_lock(&g_cache_lock);
+
+	for (i = 0; i < RAW_CACHE_SIZE; i++) {
+		raw = &g_cache[i];
+		if (raw->frame.len > 0 && raw->hash == hash && 0 == strcmp(raw->payload, payload)) {
+			raw->refcount++;
+			raw->last_used = ++g_use_count;
+			pthread_mutex_unlock(&g_cache_lock);
+			return raw;
+		}
+		if (raw->refcount == 0 && (victim == NULL || raw->last_used < victim->last_used))
+			victim = raw;
+	}
+
+	if (victim == NULL) {
+		pthread_mutex_unlock(&g_cache_lock);
+		ERR("raw cache is busy");
+		return NULL;
+	}
+
+	// an invalid payload leaves the entry it would have replaced cached
+	if (remocon_raw_compile(payload, &frame) != 0) {
+		pthread_mutex_unlock(&g_cache_lock);
+		ERR("invalid raw payload");
+		return NULL;
+	}
+
+	victim->frame = frame;
+	victim->hash = hash;
+	snprintf(victim->payload, sizeof(victim->payload), "%s", payload);
+	victim->refcount = 1;
+	victim->last_used = ++g_use_count;
+
+	pthread_mutex_unlock(&g_cache_lock);
+
+	DBG("raw frame of %d edges compiled", victim->frame.len);
+
+	return victim;
+}
+
+void remocon_raw_put(ir_raw_t *raw)
+{
+	pthread_mutex_lock(&g_cache_lock);
+	raw->refcount--;
+	pthread_mutex_unlock(&g_cache_lock);
+}
+
+/*
+ * Send a cached raw frame 'count' times on the main emitter.
+ * Returns the number of frames sent before a more urgent command took over.
+ */
+int send_raw_repeat(ir_raw_t *raw, int count)
+{
+	int i;
+
+	write_led(true);
+
+	for (i = 0; i < count; i++) {
+		if (i > 0 && remocon_queue_preempted(EMITTER_MAIN, PRIORITY_NORMAL))
+			break;
+		if (resource_irtx_transmit(EMITTER_MAIN, &raw->frame) != PERIPHERAL_ERROR_NONE) {
+			write_led(false);
+			return -1;
+		}
+	}
+
+	write_led(false);
+
+	return i;
+}
+
+bool remocon_raw_is_raw(const char *cmd)
+{
+	return (0 == strncmp(cmd, RAW_PREFIX, strlen(RAW_PREFIX)) ||
+		0 == strncmp(cmd, PRONTO_PREFIX, strlen(PRONTO_PREFIX)));
+}
+
+bool process_raw_command(const char *cmd)
+{
+	ir_raw_t *raw = remocon_raw_get(cmd);
+
+	if (raw == NULL)
+		return false;
+
+	return (remocon_queue_push_raw(raw) == 0);
+}
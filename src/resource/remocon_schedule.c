@@ -0,0 +1,450 @@
+/*
+ * Copyright (c) 2018 Samsung Electronics Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <Ecore.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/timerfd.h>
+#include "log.h"
+
+#define SCHEDULE_PREFIX			"SCHEDULE:"
+#define SCHEDULE_CANCEL_PREFIX	"SCHEDULE_CANCEL:"
+
+#define SCHEDULE_MAX			32
+#define SCHEDULE_CMD_MAX		64
+
+#define NSEC_PER_SEC			1000000000ULL
+#define SEC_PER_DAY				(24 * 60 * 60)
+
+/*
+ * Scheduled commands live in two min-heaps ordered by their deadline, one
+ * on CLOCK_MONOTONIC for relative delays and one on CLOCK_REALTIME for
+ * times of day, so setting the clock moves the latter and not the former.
+ * A timerfd per heap armed for the earliest entry wakes the main loop, so
+ * nothing polls and commands keep firing while the cloud connection is
+ * down.
+ *
+ *   SCHEDULE:in 30m TV_KEY_POWER      relative, s, m or h (s by default)
+ *   SCHEDULE:at 07:00 TV_KEY_POWER    next 07:00 local time
+ *   SCHEDULE:daily 07:00 MACRO:wakeup every day at 07:00
+ *   SCHEDULE_CANCEL:TV_KEY_POWER      drops every entry of a command
+ */
+typedef struct {
+	uint64_t deadline;		// nsec on the clock of its heap
+	int daily;				// seconds after midnight, -1 when firing once
+	char cmd[SCHEDULE_CMD_MAX];
+} schedule_t;
+
+typedef struct {
+	clockid_t clock;
+	int flags;				// timerfd_settime() flags
+	schedule_t entries[SCHEDULE_MAX];
+	int len;
+	int fd;
+	Ecore_Fd_Handler *handler;
+} schedule_heap_t;
+
+enum {
+	HEAP_MONOTONIC,
+	HEAP_REALTIME,
+	HEAP_NUM,
+};
+
+static schedule_heap_t g_heaps[HEAP_NUM] = {
+	{ CLOCK_MONOTONIC, TFD_TIMER_ABSTIME, {{0}}, 0, -1, NULL },
+	// woken up with ECANCELED when the clock is set
+	{ CLOCK_REALTIME, TFD_TIMER_ABSTIME | TFD_TIMER_CANCEL_ON_SET, {{0}}, 0, -1, NULL },
+};
+static pthread_mutex_t g_schedule_lock = PTHREAD_MUTEX_INITIALIZER;
+
+extern bool process_command(int length, char *cmd);
+
+static uint64_t clock_now(clockid_t clock)
+{
+	struct timespec ts;
+
+	clock_gettime(clock, &ts);
+
+	return ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+/*
+ * Wall clock deadline of the first time of day 'daily' after 'after'.
+ * A daily entry counts from its previous deadline, so a clock stepped
+ * back can not make it fire twice for the same day.
+ */
+static uint64_t schedule_next_daily(int daily, time_t after)
+{
+	struct tm tm;
+	time_t target;
+
+	localtime_r(&after, &tm);
+	tm.tm_hour = daily / 3600;
+	tm.tm_min = (daily / 60) % 60;
+	tm.tm_sec = daily % 60;
+	tm.tm_isdst = -1;
+	target = mktime(&tm);
+
+	while (target <= after) {
+		tm.tm_mday++;
+		tm.tm_hour = daily / 3600;
+		tm.tm_min = (daily / 60) % 60;
+		tm.tm_sec = daily % 60;
+		tm.tm_isdst = -1;
+		target = mktime(&tm);
+	}
+
+	return (uint64_t)target * NSEC_PER_SEC;
+}
+
+static void heap_swap(schedule_heap_t *heap, int a, int b)
+{
+	schedule_t tmp = heap->entries[a];
+
+	heap->entries[a] = heap->entries[b];
+	heap->entries[b] = tmp;
+}
+
+static void heap_up(schedule_heap_t *heap, int i)
+{
+	while (i > 0 && heap->entries[i].deadline < heap->entries[(i - 1) / 2].deadline) {
+		heap_swap(heap, i, (i - 1) / 2);
+		i = (i - 1) / 2;
+	}
+}
+
+static void heap_down(schedule_heap_t *heap, int i)
+{
+	int child;
+
+	while ((child = 2 * i + 1) < heap->len) {
+		if (child + 1 < heap->len && heap->entries[child + 1].deadline < heap->entries[child].deadline)
+			child++;
+		if (heap->entries[i].deadline <= heap->entries[child].deadline)
+			break;
+		heap_swap(heap, i, child);
+		i = child;
+	}
+}
+
+static void heap_remove(schedule_heap_t *heap, int i)
+{
+	heap->entries[i] = heap->entries[--heap->len];
+	if (i < heap->len) {
+		heap_up(heap, i);
+		heap_down(heap, i);
+	}
+}
+
+// order the whole array as a heap again, after entries were dropped in place
+static void heap_build(schedule_heap_t *heap)
+{
+	int i;
+
+	for (i = heap->len / 2 - 1; i >= 0; i--)
+		heap_down(heap, i);
+}
+
+// arm the timer for the earliest entry, called with g_schedule_lock
+static void schedule_arm(schedule_heap_t *heap)
+{
+	struct itimerspec its;
+
+	memset(&its, 0, sizeof(its));
+	if (heap->len > 0) {
+		its.it_value.tv_sec = heap->entries[0].deadline / NSEC_PER_SEC;
+		its.it_value.tv_nsec = heap->entries[0].deadline % NSEC_PER_SEC;
+		// an all zero value would disarm it
+		if (its.it_value.tv_sec == 0 && its.it_value.tv_nsec == 0)
+			its.it_value.tv_nsec = 1;
+	}
+
+	if (timerfd_settime(heap->fd, heap->flags, &its, NULL) != 0)
+		ERR("timerfd_settime() failed [%d]", errno);
+}
+
+static int schedule_add(schedule_heap_t *heap, uint64_t deadline, int daily, const char *cmd)
+{
+	schedule_t *entry;
+
+	if (strlen(cmd) >= SCHEDULE_CMD_MAX)
+		return -1;
+
+	pthread_mutex_lock(&g_schedule_lock);
+
+	if (heap->fd < 0 || heap->len == SCHEDULE_MAX) {
+		pthread_mutex_unlock(&g_schedule_lock);
+		ERR("schedule is full");
+		return -1;
+	}
+
+	entry = &heap->entries[heap->len++];
+	entry->deadline = deadline;
+	entry->daily = daily;
+	snprintf(entry->cmd, sizeof(entry->cmd), "%s", cmd);
+	heap_up(heap, heap->len - 1);
+	schedule_arm(heap);
+
+	pthread_mutex_unlock(&g_schedule_lock);
+
+	return 0;
+}
+
+static Eina_Bool schedule_timer_cb(void *data, Ecore_Fd_Handler *handler)
+{
+	schedule_heap_t *heap = data;
+	char cmd[SCHEDULE_CMD_MAX];
+	uint64_t expirations;
+	uint64_t now;
+	time_t after;
+	schedule_t entry;
+
+	if (read(heap->fd, &expirations, sizeof(expirations)) < 0) {
+		// entries the new time already passed fire below, the rest wait for it
+		if (errno == ECANCELED)
+			INFO("wall clock changed");
+		else if (errno != EAGAIN)
+			ERR("read() of timerfd failed [%d]", errno);
+	}
+
+	pthread_mutex_lock(&g_schedule_lock);
+
+	now = clock_now(heap->clock);
+	while (heap->len > 0 && heap->entries[0].deadline <= now) {
+		entry = heap->entries[0];
+		heap_remove(heap, 0);
+
+		if (entry.daily >= 0) {
+			// occurrences missed while the clock jumped forward are skipped
+			after = (entry.deadline > now ? entry.deadline : now) / NSEC_PER_SEC;
+			heap->entries[heap->len] = entry;
+			heap->entries[heap->len].deadline = schedule_next_daily(entry.daily, after);
+			heap_up(heap, heap->len++);
+		}
+
+		// the command may schedule again, so it runs without the lock
+		pthread_mutex_unlock(&g_schedule_lock);
+		INFO("scheduled [%s] fired %llu us late", entry.cmd,
+			(unsigned long long)(now - entry.deadline) / 1000);
+		snprintf(cmd, sizeof(cmd), "%s", entry.cmd);
+		if (!process_command(strlen(cmd), cmd))
+			ERR("scheduled [%s] failed", cmd);
+		pthread_mutex_lock(&g_schedule_lock);
+
+		now = clock_now(heap->clock);
+	}
+
+	schedule_arm(heap);
+	pthread_mutex_unlock(&g_schedule_lock);
+
+	return ECORE_CALLBACK_RENEW;
+}
+
+// HH:MM[:SS] to seconds after midnight
+static int parse_time_of_day(const char *text)
+{
+	int hour, min, sec = 0;
+	char end;
+
+	if (sscanf(text, "%d:%d:%d%c", &hour, &min, &sec, &end) != 3 &&
+		sscanf(text, "%d:%d%c", &hour, &min, &end) != 2)
+		return -1;
+
+	if (hour < 0 || hour > 23 || min < 0 || min > 59 || sec < 0 || sec > 59)
+		return -1;
+
+	return hour * 3600 + min * 60 + sec;
+}
+
+// <n>[s|m|h] to nsec
+static int parse_delay(const char *text, uint64_t *delay)
+{
+	unsigned long value;
+	char *end;
+
+	value = strtoul(text, &end, 10);
+	if (end == text)
+		return -1;
+
+	if (*end == 'h')
+		value *= 3600;
+	else if (*end == 'm')
+		value *= 60;
+	else if (*end != 's' && *end != '\0')
+		return -1;
+
+	if (*end != '\0' && end[1] != '\0')
+		return -1;
+
+	if (value > 7 * SEC_PER_DAY)
+		return -1;
+
+	*delay = value * NSEC_PER_SEC;
+
+	return 0;
+}
+
+static int schedule_parse(const char *text)
+{
+	char mode[8];
+	char when[16];
+	int offset = 0;
+	int daily;
+	uint64_t delay;
+	time_t now;
+
+	if (sscanf(text, "%7s %15s %n", mode, when, &offset) != 2 || offset == 0 || text[offset] == '\0')
+		return -1;
+
+	if (0 == strcmp(mode, "in")) {
+		if (parse_delay(when, &delay) != 0)
+			return -1;
+		return schedule_add(&g_heaps[HEAP_MONOTONIC], clock_now(CLOCK_MONOTONIC) + delay, -1, text + offset);
+	}
+
+	daily = parse_time_of_day(when);
+	if (daily < 0)
+		return -1;
+
+	now = time(NULL);
+	if (0 == strcmp(mode, "at"))
+		return schedule_add(&g_heaps[HEAP_REALTIME], schedule_next_daily(daily, now), -1, text + offset);
+	if (0 == strcmp(mode, "daily"))
+		return schedule_add(&g_heaps[HEAP_REALTIME], schedule_next_daily(daily, now), daily, text + offset);
+
+	return -1;
+}
+
+static int schedule_cancel(const char *cmd)
+{
+	schedule_heap_t *heap;
+	int removed = 0;
+	int h, i, kept;
+
+	pthread_mutex_lock(&g_schedule_lock);
+
+	for (h = 0; h < HEAP_NUM; h++) {
+		heap = &g_heaps[h];
+		// removing one by one sifts entries across the scan, so compact and rebuild instead
+		for (i = 0, kept = 0; i < heap->len; i++) {
+			if (0 == strcmp(heap->entries[i].cmd, cmd))
+				continue;
+			if (kept != i)
+				heap->entries[kept] = heap->entries[i];
+			kept++;
+		}
+		removed += heap->len - kept;
+		if (kept != heap->len) {
+			heap->len = kept;
+			heap_build(heap);
+		}
+
+		if (heap->fd >= 0)
+			schedule_arm(heap);
+	}
+
+	pthread_mutex_unlock(&g_schedule_lock);
+
+	INFO("%d schedules of [%s] cancelled", removed, cmd);
+
+	return (removed > 0) ? 0 : -1;
+}
+
+bool remocon_schedule_is_schedule(const char *cmd)
+{
+	return (0 == strncmp(cmd, SCHEDULE_PREFIX, strlen(SCHEDULE_PREFIX)) ||
+		0 == strncmp(cmd, SCHEDULE_CANCEL_PREFIX, strlen(SCHEDULE_CANCEL_PREFIX)));
+}
+
+bool process_schedule_command(const char *cmd)
+{
+	if (0 == strncmp(cmd, SCHEDULE_CANCEL_PREFIX, strlen(SCHEDULE_CANCEL_PREFIX)))
+		return (schedule_cancel(cmd + strlen(SCHEDULE_CANCEL_PREFIX)) == 0);
+
+	if (schedule_parse(cmd + strlen(SCHEDULE_PREFIX)) != 0) {
+		ERR("invalid schedule [%s]", cmd);
+		return false;
+	}
+
+	INFO("[%s] scheduled", cmd);
+
+	return true;
+}
+
+void remocon_schedule_close(void)
+{
+	schedule_heap_t *heap;
+	int h;
+
+	pthread_mutex_lock(&g_schedule_lock);
+
+	for (h = 0; h < HEAP_NUM; h++) {
+		heap = &g_heaps[h];
+
+		if (heap->handler != NULL) {
+			ecore_main_fd_handler_del(heap->handler);
+			heap->handler = NULL;
+		}
+
+		if (heap->fd >= 0) {
+			close(heap->fd);
+			heap->fd = -1;
+		}
+
+		heap->len = 0;
+	}
+
+	pthread_mutex_unlock(&g_schedule_lock);
+}
+
+/*
+ * Must be called from the main loop thread
+ */
+int remocon_schedule_init(void)
+{
+	schedule_heap_t *heap;
+	int h;
+
+	for (h = 0; h < HEAP_NUM; h++) {
+		heap = &g_heaps[h];
+
+		heap->fd = timerfd_create(heap->clock, TFD_NONBLOCK | TFD_CLOEXEC);
+		if (heap->fd < 0) {
+			ERR("timerfd_create() failed [%d]", errno);
+			goto error;
+		}
+
+		heap->handler = ecore_main_fd_handler_add(heap->fd, ECORE_FD_READ, schedule_timer_cb, heap, NULL, NULL);
+		if (heap->handler == NULL) {
+			ERR("ecore_main_fd_handler_add() failed");
+			goto error;
+		}
+	}
+
+	return 0;
+
+error:
+	remocon_schedule_close();
+	return -1;
+}
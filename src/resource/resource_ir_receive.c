@@ -0,0 +1,470 @@
+/*
+ * Copyright (c) 2018 Samsung Electronics Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/ioctl.h>
+#include <linux/gpio.h>
+#include <peripheral_io.h>
+#include "log.h"
+#include "remote_key.h"
+#include "ir_frame.h"
+#include "ir_protocol.h"
+
+#define IR_RX_GPIO				130		// GPIO2, output of the IR demodulator
+#ifndef IR_RX_GPIO_CHIP_PATH
+#define IR_RX_GPIO_CHIP_PATH	"/dev/gpiochip4"	// gpio 128..159
+#endif
+#define IR_RX_GPIO_LINE			2		// IR_RX_GPIO on IR_RX_GPIO_CHIP_PATH
+
+#define IR_RX_RING_SIZE			1024	// power of 2
+#define IR_RX_FRAME_GAP			20		// silence ending a frame, msec
+#define IR_RX_POLL_TIME			10		// msec
+#define IR_RX_EVENT_BATCH		16		// size of the kernel event fifo
+#define IR_RX_LEARN_TIMEOUT		10		// sec
+#define IR_RX_TOLERANCE			30		// percent
+#define IR_RX_TOLERANCE_MIN		100		// usec, demodulators stretch marks
+
+/*
+ * Line event fd of the receiver pin.
+ * The kernel stamps every edge in its interrupt handler, so the durations do
+ * not depend on how fast user space is scheduled.
+ */
+static int g_line_fd = -1;
+
+/*
+ * Edge timestamp ring, used only when the gpio chardev is not available.
+ * Single producer (interrupt callback) and single consumer (learn thread),
+ * the indexes run freely and are only ever written by their owner.
+ */
+static uint64_t g_ring[IR_RX_RING_SIZE];
+static unsigned int g_ring_head = 0;
+static unsigned int g_ring_tail = 0;
+static unsigned long g_overrun_count = 0;
+
+static peripheral_gpio_h g_rx_h = NULL;
+
+// serializes starting, reaping and stopping the learn thread
+static pthread_mutex_t g_learn_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_t g_learn_thread;
+static bool g_learn_thread_valid = false;
+static bool g_learning = false;
+static bool g_learn_stop = false;
+static char g_learn_name[20];
+
+extern const ir_protocol_t tv_protocol;
+extern const ir_protocol_t vacuum_protocol;
+
+static const ir_protocol_t *g_protocols[] = {
+	&tv_protocol,
+	&vacuum_protocol,
+};
+
+extern int remocon_cmd_learn(const char *name, uint16_t key_value, int device);
+
+static inline uint64_t resource_irrx_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/*
+ * Called on both edges of the demodulator output.
+ * Only a timestamp and a store, the decoding is done by the learn thread.
+ */
+static void resource_irrx_interrupted_cb(peripheral_gpio_h gpio, peripheral_error_e error, void *user_data)
+{
+	uint64_t ts = resource_irrx_now();
+	unsigned int head = __atomic_load_n(&g_ring_head, __ATOMIC_RELAXED);
+	unsigned int tail = __atomic_load_n(&g_ring_tail, __ATOMIC_ACQUIRE);
+
+	if (error != PERIPHERAL_ERROR_NONE)
+		return;
+
+	if (head - tail >= IR_RX_RING_SIZE) {
+		g_overrun_count++;
+		return;
+	}
+
+	g_ring[head & (IR_RX_RING_SIZE - 1)] = ts;
+	__atomic_store_n(&g_ring_head, head + 1, __ATOMIC_RELEASE);
+}
+
+static bool resource_irrx_match(unsigned int measured, unsigned int expected)
+{
+	unsigned int tolerance = expected * IR_RX_TOLERANCE / 100 + IR_RX_TOLERANCE_MIN;
+
+	return (measured + tolerance >= expected && measured <= expected + tolerance);
+}
+
+/*
+ * Decode a captured frame against a protocol descriptor
+ */
+static int resource_irrx_decode(const ir_frame_t *frame, const ir_protocol_t *p, uint16_t *key_value)
+{
+	const unsigned int *d = frame->duration;
+	int total = p->pre_data_bits + p->bits;
+	uint64_t data = 0;
+	int i;
+
+	if (frame->len < 2 + 2 * total + 1)
+		return -1;
+
+	if (!resource_irrx_match(d[0], p->header_mark) || !resource_irrx_match(d[1], p->header_space))
+		return -1;
+
+	for (i = 0; i < total; i++) {
+		unsigned int m = d[2 + 2 * i];
+		unsigned int s = d[3 + 2 * i];
+
+		if (!resource_irrx_match(m, p->one_mark) && !resource_irrx_match(m, p->zero_mark))
+			return -1;
+
+		if (resource_irrx_match(s, p->one_space))
+			data = (data << 1) | 1;
+		else if (resource_irrx_match(s, p->zero_space))
+			data = data << 1;
+		else
+			return -1;
+	}
+
+	if (!resource_irrx_match(d[2 + 2 * total], p->stop_mark))
+		return -1;
+
+	if ((data >> p->bits) != p->pre_data)
+		return -1;
+
+	*key_value = (uint16_t)(data & ((1ULL << p->bits) - 1));
+
+	return 0;
+}
+
+static bool resource_irrx_learn_frame(const ir_frame_t *frame)
+{
+	uint16_t key_value;
+	int i;
+
+	if (frame->overflow) {
+		INFO("frame longer than %d edges", IR_FRAME_MAX_LEN);
+		return false;
+	}
+
+	for (i = 0; i < sizeof(g_protocols) / sizeof(g_protocols[0]); i++) {
+		if (resource_irrx_decode(frame, g_protocols[i], &key_value) == 0) {
+			INFO("learned [%s] : %s 0x%04x", g_learn_name, g_protocols[i]->name, key_value);
+			remocon_cmd_learn(g_learn_name, key_value, g_protocols[i]->device);
+			return true;
+		}
+	}
+
+	INFO("unknown frame of %d edges", frame->len);
+
+	return false;
+}
+
+/*
+ * Wait up to 'timeout' msec for the next edges.
+ * Returns the number of timestamps (nsec) stored in 'ts', 0 on timeout.
+ */
+static int resource_irrx_wait_edges(uint64_t *ts, int max, int timeout)
+{
+	int n = 0;
+
+	if (g_line_fd >= 0) {
+		struct gpioevent_data ev[IR_RX_EVENT_BATCH];
+		struct pollfd pfd = { g_line_fd, POLLIN, 0 };
+		ssize_t len;
+		int i;
+
+		if (max > IR_RX_EVENT_BATCH)
+			max = IR_RX_EVENT_BATCH;
+
+		if (poll(&pfd, 1, timeout) <= 0)
+			return 0;
+
+		len = read(g_line_fd, ev, max * sizeof(ev[0]));
+		for (i = 0; len > 0 && i < len / (ssize_t)sizeof(ev[0]); i++)
+			ts[n++] = ev[i].timestamp;
+
+		return n;
+	} else {
+		unsigned int head, tail;
+		int waited = 0;
+
+		for (;;) {
+			head = __atomic_load_n(&g_ring_head, __ATOMIC_ACQUIRE);
+			tail = g_ring_tail;
+			if (tail != head || waited >= timeout)
+				break;
+			usleep(IR_RX_POLL_TIME * 1000);
+			waited += IR_RX_POLL_TIME;
+		}
+
+		while (tail != head && n < max)
+			ts[n++] = g_ring[tail++ & (IR_RX_RING_SIZE - 1)];
+		__atomic_store_n(&g_ring_tail, tail, __ATOMIC_RELEASE);
+
+		return n;
+	}
+}
+
+/*
+ * Drop edges received before learning started
+ */
+static void resource_irrx_flush(void)
+{
+	struct gpioevent_data ev[IR_RX_EVENT_BATCH];
+
+	if (g_line_fd >= 0) {
+		while (read(g_line_fd, ev, sizeof(ev)) > 0)
+			;
+	}
+
+	g_ring_head = 0;
+	g_ring_tail = 0;
+	g_overrun_count = 0;
+}
+
+static void *resource_irrx_learn_thread(void *data)
+{
+	time_t deadline = time(NULL) + IR_RX_LEARN_TIMEOUT;
+	bool in_frame = false;
+	bool learned = false;
+	uint64_t last = 0;
+	uint64_t ts[IR_RX_EVENT_BATCH];
+	ir_frame_t frame;
+	int i, n;
+
+	ir_frame_init(&frame, IR_CARRIER_38KHZ);
+
+	while (!learned && time(NULL) < deadline &&
+		!__atomic_load_n(&g_learn_stop, __ATOMIC_ACQUIRE)) {
+		n = resource_irrx_wait_edges(ts, IR_RX_EVENT_BATCH,
+			in_frame ? IR_RX_FRAME_GAP : IR_RX_POLL_TIME);
+
+		if (n == 0) {
+			// silence, the frame is complete
+			if (in_frame) {
+				learned = resource_irrx_learn_frame(&frame);
+				ir_frame_init(&frame, IR_CARRIER_38KHZ);
+				in_frame = false;
+			}
+			continue;
+		}
+
+		for (i = 0; i < n && !learned; i++) {
+			if (in_frame) {
+				uint64_t d = (ts[i] - last) / 1000;
+
+				if (d > IR_RX_FRAME_GAP * 1000) {
+					learned = resource_irrx_learn_frame(&frame);
+					ir_frame_init(&frame, IR_CARRIER_38KHZ);
+				} else {
+					// the first edge after silence starts a mark
+					ir_frame_add(&frame, frame.len % 2 == 0, (unsigned int)d);
+				}
+			}
+			in_frame = true;
+			last = ts[i];
+		}
+	}
+
+	if (g_line_fd < 0)
+		peripheral_gpio_unset_interrupted_cb(g_rx_h);
+
+	if (!learned)
+		ERR("learning [%s] timed out", g_learn_name);
+	if (g_overrun_count)
+		ERR("%lu edges lost", g_overrun_count);
+
+	__atomic_store_n(&g_learning, false, __ATOMIC_RELEASE);
+
+	return NULL;
+}
+
+/*
+ * Capture the next frame from the receiver and add it to cmd_table as 'name'
+ */
+int resource_irrx_learn(const char *name)
+{
+	int ret;
+
+	if (g_line_fd < 0 && g_rx_h == NULL) {
+		ERR("IR receiver is not available");
+		return -1;
+	}
+
+	if (name[0] == '\0' || strlen(name) >= sizeof(g_learn_name)) {
+		ERR("invalid name [%s]", name);
+		return -1;
+	}
+
+	pthread_mutex_lock(&g_learn_lock);
+
+	if (__atomic_load_n(&g_learning, __ATOMIC_ACQUIRE)) {
+		ERR("already learning [%s]", g_learn_name);
+		pthread_mutex_unlock(&g_learn_lock);
+		return -1;
+	}
+
+	if (g_learn_thread_valid) {
+		pthread_join(g_learn_thread, NULL);
+		g_learn_thread_valid = false;
+	}
+
+	snprintf(g_learn_name, sizeof(g_learn_name), "%s", name);
+	resource_irrx_flush();
+	__atomic_store_n(&g_learn_stop, false, __ATOMIC_RELEASE);
+	__atomic_store_n(&g_learning, true, __ATOMIC_RELEASE);
+
+	if (g_line_fd < 0) {
+		ret = peripheral_gpio_set_interrupted_cb(g_rx_h, resource_irrx_interrupted_cb, NULL);
+		if (ret != PERIPHERAL_ERROR_NONE) {
+			ERR("peripheral_gpio_set_interrupted_cb failed, ret=[%d]", ret);
+			goto error;
+		}
+	}
+
+	ret = pthread_create(&g_learn_thread, NULL, resource_irrx_learn_thread, NULL);
+	if (ret != 0) {
+		ERR("pthread_create() failed!![%d]", ret);
+		if (g_line_fd < 0)
+			peripheral_gpio_unset_interrupted_cb(g_rx_h);
+		goto error;
+	}
+	g_learn_thread_valid = true;
+
+	pthread_mutex_unlock(&g_learn_lock);
+
+	INFO("learning [%s]...", name);
+
+	return 0;
+
+error:
+	__atomic_store_n(&g_learning, false, __ATOMIC_RELEASE);
+	pthread_mutex_unlock(&g_learn_lock);
+	return ret;
+}
+
+/*
+ * Request edge events of the receiver line from the gpio chardev
+ */
+static int resource_irrx_open_line(void)
+{
+	struct gpioevent_request req;
+	int chip_fd;
+	int flags;
+
+	chip_fd = open(IR_RX_GPIO_CHIP_PATH, O_RDONLY | O_CLOEXEC);
+	if (chip_fd < 0)
+		return -1;
+
+	memset(&req, 0, sizeof(req));
+	req.lineoffset = IR_RX_GPIO_LINE;
+	req.handleflags = GPIOHANDLE_REQUEST_INPUT;
+	req.eventflags = GPIOEVENT_REQUEST_BOTH_EDGES;
+	snprintf(req.consumer_label, sizeof(req.consumer_label), "irrx");
+
+	if (ioctl(chip_fd, GPIO_GET_LINEEVENT_IOCTL, &req) < 0) {
+		close(chip_fd);
+		return -1;
+	}
+	close(chip_fd);
+
+	// reads only block in poll()
+	flags = fcntl(req.fd, F_GETFL);
+	fcntl(req.fd, F_SETFL, flags | O_NONBLOCK);
+
+	g_line_fd = req.fd;
+
+	return 0;
+}
+
+int resource_irrx_init(void)
+{
+	int ret = PERIPHERAL_ERROR_NONE;
+
+	INFO("IR receiver(gpio_pin:%d) is opening...", IR_RX_GPIO);
+
+	if (resource_irrx_open_line() == 0) {
+		INFO("IR receiver uses kernel edge timestamps");
+		return 0;
+	}
+
+	WARN("%s is not available, edge timestamps are taken in user space", IR_RX_GPIO_CHIP_PATH);
+
+	ret = peripheral_gpio_open(IR_RX_GPIO, &g_rx_h);
+	if (ret != PERIPHERAL_ERROR_NONE) {
+		ERR("peripheral_gpio_open failed, ret=[%d]", ret);
+		g_rx_h = NULL;
+		return ret;
+	}
+
+	ret = peripheral_gpio_set_direction(g_rx_h, PERIPHERAL_GPIO_DIRECTION_IN);
+	if (ret != PERIPHERAL_ERROR_NONE) {
+		ERR("peripheral_gpio_set_direction failed, ret=[%d]", ret);
+		goto error;
+	}
+
+	ret = peripheral_gpio_set_edge_mode(g_rx_h, PERIPHERAL_GPIO_EDGE_BOTH);
+	if (ret != PERIPHERAL_ERROR_NONE) {
+		ERR("peripheral_gpio_set_edge_mode failed, ret=[%d]", ret);
+		goto error;
+	}
+
+	return ret;
+
+error:
+	peripheral_gpio_close(g_rx_h);
+	g_rx_h = NULL;
+	return ret;
+}
+
+int resource_irrx_close(void)
+{
+	int ret = PERIPHERAL_ERROR_NONE;
+
+	pthread_mutex_lock(&g_learn_lock);
+	if (g_learn_thread_valid) {
+		__atomic_store_n(&g_learn_stop, true, __ATOMIC_RELEASE);
+		pthread_join(g_learn_thread, NULL);
+		g_learn_thread_valid = false;
+	}
+	pthread_mutex_unlock(&g_learn_lock);
+
+	if (g_line_fd >= 0) {
+		close(g_line_fd);
+		g_line_fd = -1;
+	}
+
+	if (g_rx_h != NULL) {
+		ret = peripheral_gpio_close(g_rx_h);
+		if (ret != PERIPHERAL_ERROR_NONE)
+			ERR("peripheral_gpio_close failed");
+		g_rx_h = NULL;
+	}
+
+	return ret;
+}
@@ -0,0 +1,291 @@
+/*
+ * Copyright (c) 2018 Samsung Electronics Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <app_common.h>
+#include "remote_key.h"
+#include "log.h"
+
+#define IRTRACE_PREFIX		"IRTRACE:"
+#define IRTRACE_FILE_NAME	"irtrace.vcd"
+
+// edges kept, the oldest are overwritten
+#define IRTRACE_RING_SIZE	4096
+
+/*
+ * Edge trace of the PWM playback: for every toggle the time it was meant
+ * to happen, counted from the first edge of its frame with the durations
+ * of the frame, and the time it did happen.
+ */
+typedef struct {
+	uint64_t intended;		// CLOCK_MONOTONIC nsec
+	uint64_t actual;		// CLOCK_MONOTONIC nsec
+	uint32_t frame;
+	uint16_t edge;
+	uint8_t emitter;
+	uint8_t level;
+} irtrace_edge_t;
+
+typedef struct {
+	uint64_t time;			// nsec from the first traced edge
+	int signal;				// emitter * 2, + 1 for the intended wave
+	int level;
+} irtrace_event_t;
+
+bool irtrace_enabled = false;
+
+static irtrace_edge_t g_ring[IRTRACE_RING_SIZE];
+static unsigned long g_ring_pos = 0;
+static uint32_t g_frame_seq = 0;
+
+uint64_t irtrace_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/*
+ * Called by the transmit workers for every edge while tracing is on, no
+ * lock is taken. The first edge of a frame starts a new frame.
+ */
+void irtrace_record(int emitter, int edge, bool level, uint64_t intended, uint64_t actual)
+{
+	static __thread uint32_t frame;
+	irtrace_edge_t *e;
+
+	if (edge == 0)
+		frame = __atomic_add_fetch(&g_frame_seq, 1, __ATOMIC_RELAXED);
+
+	e = &g_ring[__atomic_fetch_add(&g_ring_pos, 1, __ATOMIC_RELAXED) % IRTRACE_RING_SIZE];
+	e->intended = intended;
+	e->actual = actual;
+	e->frame = frame;
+	e->edge = edge;
+	e->emitter = emitter;
+	e->level = level;
+}
+
+// the traced edges, oldest first
+static int irtrace_snapshot(irtrace_edge_t **edges)
+{
+	unsigned long pos = __atomic_load_n(&g_ring_pos, __ATOMIC_RELAXED);
+	unsigned long count = (pos < IRTRACE_RING_SIZE) ? pos : IRTRACE_RING_SIZE;
+	unsigned long i;
+
+	*edges = malloc(count * sizeof(irtrace_edge_t) + 1);
+	if (*edges == NULL)
+		return -1;
+
+	for (i = 0; i < count; i++)
+		(*edges)[i] = g_ring[(pos - count + i) % IRTRACE_RING_SIZE];
+
+	return count;
+}
+
+static int compare_u64(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *)a;
+	uint64_t y = *(const uint64_t *)b;
+
+	return (x > y) - (x < y);
+}
+
+/*
+ * Error of every edge against the frame it played, in usec. The first edge
+ * of a frame is its own reference, so it is not counted.
+ */
+static void irtrace_summary(const irtrace_edge_t *edges, int count)
+{
+	uint64_t *error;
+	uint64_t sum = 0;
+	int n = 0;
+	int i;
+
+	error = malloc(count * sizeof(uint64_t) + 1);
+	if (error == NULL)
+		return;
+
+	for (i = 0; i < count; i++) {
+		if (edges[i].edge == 0)
+			continue;
+		error[n] = (edges[i].actual > edges[i].intended) ?
+			edges[i].actual - edges[i].intended : edges[i].intended - edges[i].actual;
+		sum += error[n++];
+	}
+
+	if (n > 0) {
+		qsort(error, n, sizeof(uint64_t), compare_u64);
+		INFO("ir edge error over %d edges : mean [%llu] p99 [%llu] max [%llu] us", n,
+			(unsigned long long)(sum / n / 1000),
+			(unsigned long long)(error[(n * 99 + 99) / 100 - 1] / 1000),
+			(unsigned long long)(error[n - 1] / 1000));
+	} else {
+		INFO("no ir edges traced");
+	}
+
+	free(error);
+}
+
+static int compare_event(const void *a, const void *b)
+{
+	const irtrace_event_t *x = a;
+	const irtrace_event_t *y = b;
+
+	if (x->time != y->time)
+		return (x->time > y->time) - (x->time < y->time);
+
+	return x->signal - y->signal;
+}
+
+/*
+ * Value Change Dump with an actual and an intended wire per emitter
+ */
+static int irtrace_write_vcd(const irtrace_edge_t *edges, int count, const char *path)
+{
+	irtrace_event_t *events;
+	uint64_t base;
+	uint64_t last = ~0ULL;
+	FILE *fp;
+	int n = 0;
+	int i;
+
+	if (count == 0)
+		return 0;
+
+	events = malloc(2 * count * sizeof(irtrace_event_t));
+	if (events == NULL)
+		return -1;
+
+	base = edges[0].actual;
+	for (i = 0; i < count; i++) {
+		if (edges[i].actual < base)
+			base = edges[i].actual;
+		if (edges[i].intended < base)
+			base = edges[i].intended;
+	}
+
+	for (i = 0; i < count; i++) {
+		events[n].time = edges[i].actual - base;
+		events[n].signal = edges[i].emitter * 2;
+		events[n++].level = edges[i].level;
+		events[n].time = edges[i].intended - base;
+		events[n].signal = edges[i].emitter * 2 + 1;
+		events[n++].level = edges[i].level;
+	}
+	qsort(events, n, sizeof(irtrace_event_t), compare_event);
+
+	fp = fopen(path, "w");
+	if (fp == NULL) {
+		ERR("fopen() of [%s] failed", path);
+		free(events);
+		return -1;
+	}
+
+	fprintf(fp, "$comment tizen-smart-remote-controller ir edge trace $end\n");
+	fprintf(fp, "$timescale 1us $end\n");
+	fprintf(fp, "$scope module remocon $end\n");
+	for (i = 0; i < EMITTER_NUM; i++) {
+		fprintf(fp, "$var wire 1 %c emitter%d $end\n", '!' + 2 * i, i);
+		fprintf(fp, "$var wire 1 %c emitter%d_intended $end\n", '!' + 2 * i + 1, i);
+	}
+	fprintf(fp, "$upscope $end\n$enddefinitions $end\n");
+
+	fprintf(fp, "$dumpvars\n");
+	for (i = 0; i < 2 * EMITTER_NUM; i++)
+		fprintf(fp, "0%c\n", '!' + i);
+	fprintf(fp, "$end\n");
+
+	for (i = 0; i < n; i++) {
+		if (events[i].time / 1000 != last) {
+			last = events[i].time / 1000;
+			fprintf(fp, "#%llu\n", (unsigned long long)last);
+		}
+		fprintf(fp, "%d%c\n", events[i].level, '!' + events[i].signal);
+	}
+
+	fclose(fp);
+	free(events);
+
+	INFO("%d ir edges written to [%s]", count, path);
+
+	return 0;
+}
+
+static int irtrace_dump(void)
+{
+	irtrace_edge_t *edges;
+	char path[256];
+	char *data_path;
+	int count;
+	int ret;
+
+	count = irtrace_snapshot(&edges);
+	if (count < 0)
+		return -1;
+
+	irtrace_summary(edges, count);
+
+	data_path = app_get_data_path();
+	if (data_path == NULL) {
+		free(edges);
+		return -1;
+	}
+	snprintf(path, sizeof(path), "%s%s", data_path, IRTRACE_FILE_NAME);
+	free(data_path);
+
+	ret = irtrace_write_vcd(edges, count, path);
+	free(edges);
+
+	return ret;
+}
+
+bool irtrace_is_irtrace(const char *cmd)
+{
+	return (0 == strncmp(cmd, IRTRACE_PREFIX, strlen(IRTRACE_PREFIX)));
+}
+
+/*
+ * IRTRACE:ON starts a new trace, IRTRACE:OFF stops it,
+ * IRTRACE:DUMP logs the error summary and writes irtrace.vcd to the data
+ * directory
+ */
+bool process_irtrace_command(const char *cmd)
+{
+	cmd += strlen(IRTRACE_PREFIX);
+
+	if (0 == strcmp(cmd, "ON")) {
+		__atomic_store_n(&irtrace_enabled, false, __ATOMIC_RELAXED);
+		__atomic_store_n(&g_ring_pos, 0, __ATOMIC_RELAXED);
+		__atomic_store_n(&irtrace_enabled, true, __ATOMIC_RELAXED);
+	} else if (0 == strcmp(cmd, "OFF")) {
+		__atomic_store_n(&irtrace_enabled, false, __ATOMIC_RELAXED);
+	} else if (0 == strcmp(cmd, "DUMP")) {
+		return (irtrace_dump() == 0);
+	} else {
+		return false;
+	}
+
+	return true;
+}
@@ -14,87 +14,432 @@
  * limitations under the License.
  */
 
+#include <stdbool.h>
+#include <stdio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/ioctl.h>
+#include <linux/lirc.h>
 #include "log.h"
+#include "remote_key.h"
+#include "ir_frame.h"
+#include "latency.h"
 #include <peripheral_io.h>
 
 #define ARTIK_PWM_CHIPID	0
 #define ARTIK_PWM_PIN		2
+#define ARTIK_PWM_PIN_SUB	0
 
 #define MICRO_SECOND	(1000)
 
-static peripheral_pwm_h g_pwm_h = NULL;
+// Kernel IR transmitter (pwm-ir-tx, gpio-ir-tx or rc-loopback), per emitter
+#ifndef LIRC_DEVICE_PATH
+#define LIRC_DEVICE_PATH	"/dev/lirc%d"
+#endif
+#define LIRC_DUTY_CYCLE		50		// percent
 
-peripheral_error_e resource_irtx_close(void)
+// sysfs attribute behind the PWM channel opened by peripheral-io
+#ifndef PWM_ENABLE_PATH
+#define PWM_ENABLE_PATH		"/sys/class/pwm/pwmchip%d/pwm%d/enable"
+#endif
+
+/*
+ * Each emitter is driven by its own transmit worker, so nothing here is
+ * shared between emitters.
+ */
+typedef struct {
+	int chip;
+	int pin;
+	peripheral_pwm_h pwm_h;
+	unsigned int carrier;
+	int enable_fd;				// pre-opened enable attribute, toggled with a single pwrite()
+	int lirc_fd;
+	unsigned int lirc_features;
+} irtx_emitter_t;
+
+static irtx_emitter_t g_emitters[EMITTER_NUM] = {
+	{ ARTIK_PWM_CHIPID, ARTIK_PWM_PIN,     NULL, 0, -1, -1, 0 },
+	{ ARTIK_PWM_CHIPID, ARTIK_PWM_PIN_SUB, NULL, 0, -1, -1, 0 },
+};
+
+static const char g_enable_value[2] = { '0', '1' };
+
+extern void mysleep_microsec(int microsec);
+
+static void sleep_microsec(unsigned int microsec)
+{
+	struct timespec res;
+
+	res.tv_sec = microsec / 1000000;
+	res.tv_nsec = (microsec % 1000000) * 1000;
+	clock_nanosleep(CLOCK_MONOTONIC, 0, &res, NULL);
+}
+
+/*
+ * A lirc device takes a whole frame of pulse/space durations in one write()
+ * and the kernel driver generates the edges, so the frame timing does not
+ * depend on the scheduling of this process.
+ */
+static int resource_irtx_lirc_open(int emitter)
+{
+	irtx_emitter_t *e = &g_emitters[emitter];
+	unsigned int mode = LIRC_MODE_PULSE;
+	unsigned int duty = LIRC_DUTY_CYCLE;
+	char path[64];
+	int fd;
+
+	snprintf(path, sizeof(path), LIRC_DEVICE_PATH, emitter);
+
+	fd = open(path, O_WRONLY | O_CLOEXEC);
+	if (fd < 0) {
+		DBG("%s is not available [%d]", path, errno);
+		return -1;
+	}
+
+	e->lirc_features = 0;
+	if (ioctl(fd, LIRC_GET_FEATURES, &e->lirc_features) < 0) {
+		if (errno != ENOTTY) {
+			ERR("LIRC_GET_FEATURES failed!![%d]", errno);
+			close(fd);
+			return -1;
+		}
+		// a plain file or fifo standing in for the device takes the raw pulses
+		WARN("%s is not a lirc device, pulses are written as is", path);
+		return fd;
+	}
+
+	if (!(e->lirc_features & LIRC_CAN_SEND_PULSE)) {
+		INFO("%s can not send pulses", path);
+		close(fd);
+		return -1;
+	}
+
+	if (ioctl(fd, LIRC_SET_SEND_MODE, &mode) < 0)
+		WARN("LIRC_SET_SEND_MODE failed!![%d]", errno);
+
+	if ((e->lirc_features & LIRC_CAN_SET_SEND_DUTY_CYCLE) &&
+		ioctl(fd, LIRC_SET_SEND_DUTY_CYCLE, &duty) < 0)
+		WARN("LIRC_SET_SEND_DUTY_CYCLE failed!![%d]", errno);
+
+	INFO("emitter [%d] transmits through %s", emitter, path);
+
+	return fd;
+}
+
+static peripheral_error_e resource_irtx_lirc_transmit(irtx_emitter_t *e, const ir_frame_t *frame)
+{
+	unsigned int carrier = frame->carrier;
+	unsigned int gap = 0;
+	int len = frame->len;
+	ssize_t n;
+
+	if (len == 0)
+		return PERIPHERAL_ERROR_NONE;
+
+	if (carrier != e->carrier) {
+		if ((e->lirc_features & LIRC_CAN_SET_SEND_CARRIER) &&
+			ioctl(e->lirc_fd, LIRC_SET_SEND_CARRIER, &carrier) < 0)
+			WARN("LIRC_SET_SEND_CARRIER failed!![%d]", errno);
+		e->carrier = carrier;
+	}
+
+	// lirc takes an odd number of entries ending with a pulse
+	if (len % 2 == 0) {
+		len--;
+		gap = frame->duration[len];
+	}
+
+	latency_stamp(LATENCY_FIRST_EDGE);
+	n = write(e->lirc_fd, frame->duration, len * sizeof(frame->duration[0]));
+	if (n < 0) {
+		ERR("lirc write failed!![%d]", errno);
+		return PERIPHERAL_ERROR_IO_ERROR;
+	}
+	// a partly sent frame is a wrong code on air
+	if (n != (ssize_t)(len * sizeof(frame->duration[0]))) {
+		ERR("lirc write sent %zd of %zu bytes", n, len * sizeof(frame->duration[0]));
+		return PERIPHERAL_ERROR_IO_ERROR;
+	}
+	latency_stamp(LATENCY_LAST_EDGE);
+
+	// write() returns once the frame is on air, the trailing space is ours
+	if (gap)
+		sleep_microsec(gap);
+
+	return PERIPHERAL_ERROR_NONE;
+}
+
+static peripheral_error_e resource_irtx_set_carrier(irtx_emitter_t *e, unsigned int carrier)
+{
+	peripheral_error_e ret = PERIPHERAL_ERROR_NONE;
+	int period = 1000000000 / carrier;	// nano
+	int duty_cycle = period / 2;		// 50% duty
+
+	if ((ret = peripheral_pwm_set_period(e->pwm_h, period)) != PERIPHERAL_ERROR_NONE) {
+		ERR("peripheral_pwm_set_period() failed!![%d]", ret);
+		return ret;
+	}
+
+	if ((ret = peripheral_pwm_set_duty_cycle(e->pwm_h, duty_cycle)) != PERIPHERAL_ERROR_NONE) {
+		ERR("peripheral_pwm_set_duty_cycle() failed!![%d]", ret);
+		return ret;
+	}
+
+	e->carrier = carrier;
+
+	return ret;
+}
+
+/*
+ * peripheral_pwm_set_enabled() goes through the peripheral bus on every call.
+ * The enable attribute of the exported channel is kept open instead, when
+ * this process is allowed to write it.
+ */
+static int resource_irtx_open_enable(int chip, int pin)
+{
+	char path[64];
+	int fd;
+
+	snprintf(path, sizeof(path), PWM_ENABLE_PATH, chip, pin);
+
+	fd = open(path, O_WRONLY | O_CLOEXEC);
+	if (fd < 0) {
+		INFO("%s is not available [%d], using peripheral-io", path, errno);
+		return -1;
+	}
+
+	INFO("toggle PWM through %s", path);
+
+	return fd;
+}
+
+static peripheral_error_e resource_irtx_close_emitter(irtx_emitter_t *e)
 {
 	peripheral_error_e ret = PERIPHERAL_ERROR_NONE;
 
-	if (g_pwm_h != NULL) {
+	if (e->lirc_fd >= 0) {
+		close(e->lirc_fd);
+		e->lirc_fd = -1;
+	}
+
+	if (e->enable_fd >= 0) {
+		close(e->enable_fd);
+		e->enable_fd = -1;
+	}
+
+	if (e->pwm_h != NULL) {
 		// Closing a PWM Handle : close a PWM handle that is no longer used,
-		if ((ret = peripheral_pwm_close(g_pwm_h)) != PERIPHERAL_ERROR_NONE ) {
+		if ((ret = peripheral_pwm_close(e->pwm_h)) != PERIPHERAL_ERROR_NONE ) {
 			ERR("peripheral_pwm_close() failed!![%d]", ret);
 			return ret;
 		}
-		g_pwm_h = NULL;
+		e->pwm_h = NULL;
 	}
 
 	return ret;
 }
 
-peripheral_error_e resource_irtx_init(void)
+peripheral_error_e resource_irtx_close(void)
 {
 	peripheral_error_e ret = PERIPHERAL_ERROR_NONE;
-	INFO("resource_irtx_init...");
+	peripheral_error_e err;
+	int i;
 
-	int chip = ARTIK_PWM_CHIPID;	// Chip 0
-	int pin  = ARTIK_PWM_PIN;		// Pin 2
+	for (i = 0; i < EMITTER_NUM; i++) {
+		if ((err = resource_irtx_close_emitter(&g_emitters[i])) != PERIPHERAL_ERROR_NONE)
+			ret = err;
+	}
+
+	return ret;
+}
+
+static peripheral_error_e resource_irtx_init_emitter(int emitter)
+{
+	irtx_emitter_t *e = &g_emitters[emitter];
+	peripheral_error_e ret = PERIPHERAL_ERROR_NONE;
+
+	int chip = e->chip;
+	int pin  = e->pin;
 
 	int period = 26 * MICRO_SECOND;	// micro - 38kHz
 	int duty_cycle = period / 2;	// 50% duty
 
-	if (g_pwm_h == NULL){
+	if (e->lirc_fd < 0) {
+		e->lirc_fd = resource_irtx_lirc_open(emitter);
+		if (e->lirc_fd >= 0) {
+			e->carrier = 0;
+			return ret;
+		}
+	}
+
+	if (e->pwm_h == NULL){
 		// Opening a PWM Handle : The chip and pin parameters required for this function must be set
-		if ((ret = peripheral_pwm_open(chip, pin, &g_pwm_h)) != PERIPHERAL_ERROR_NONE ) {
+		if ((ret = peripheral_pwm_open(chip, pin, &e->pwm_h)) != PERIPHERAL_ERROR_NONE ) {
 			ERR("peripheral_pwm_open() failed!![%d]", ret);
 			return ret;
 		}
 	}
 
 	// Setting the Period
-	if ((ret = peripheral_pwm_set_period(g_pwm_h, period)) != PERIPHERAL_ERROR_NONE) {
+	if ((ret = peripheral_pwm_set_period(e->pwm_h, period)) != PERIPHERAL_ERROR_NONE) {
 		ERR("peripheral_pwm_set_period() failed!![%d]", ret);
 		return ret;
 	}
 
 	// Setting the Duty Cycle
-	if ((ret = peripheral_pwm_set_duty_cycle(g_pwm_h, duty_cycle)) != PERIPHERAL_ERROR_NONE) {
+	if ((ret = peripheral_pwm_set_duty_cycle(e->pwm_h, duty_cycle)) != PERIPHERAL_ERROR_NONE) {
 		ERR("peripheral_pwm_set_duty_cycle() failed!![%d]", ret);
 		return ret;
 	}
 
 	// Setting the Polarity
-	//if ((ret = peripheral_pwm_set_polarity(g_pwm_h, PERIPHERAL_PWM_POLARITY_ACTIVE_HIGH)) != PERIPHERAL_ERROR_NONE) {
-	if ((ret = peripheral_pwm_set_polarity(g_pwm_h, PERIPHERAL_PWM_POLARITY_ACTIVE_LOW)) != PERIPHERAL_ERROR_NONE) {
+	//if ((ret = peripheral_pwm_set_polarity(e->pwm_h, PERIPHERAL_PWM_POLARITY_ACTIVE_HIGH)) != PERIPHERAL_ERROR_NONE) {
+	if ((ret = peripheral_pwm_set_polarity(e->pwm_h, PERIPHERAL_PWM_POLARITY_ACTIVE_LOW)) != PERIPHERAL_ERROR_NONE) {
 		ERR("peripheral_pwm_set_polarity() failed!![%d]", ret);
 		return ret;
 	}
 
+	e->carrier = IR_CARRIER_38KHZ;
+
+	if (e->enable_fd < 0)
+		e->enable_fd = resource_irtx_open_enable(chip, pin);
+
+	return ret;
+}
+
+extern bool remocon_emitter_used(int emitter);
+
+/*
+ * The main emitter is required. The others are opened only when a device is
+ * mapped to them and are optional, devices mapped to an emitter which is not
+ * available fall back to the main one.
+ */
+peripheral_error_e resource_irtx_init(void)
+{
+	peripheral_error_e ret = PERIPHERAL_ERROR_NONE;
+	int i;
+
+	INFO("resource_irtx_init...");
+
+	for (i = 0; i < EMITTER_NUM; i++) {
+		if (!remocon_emitter_used(i))
+			continue;
+
+		ret = resource_irtx_init_emitter(i);
+		if (ret != PERIPHERAL_ERROR_NONE) {
+			resource_irtx_close_emitter(&g_emitters[i]);
+			if (i == EMITTER_MAIN)
+				return ret;
+			WARN("emitter [%d] is not available!![%d]", i, ret);
+			ret = PERIPHERAL_ERROR_NONE;
+		}
+	}
+
 	return ret;
 }
 
-peripheral_error_e resource_transmit_data(bool enable)
+bool resource_irtx_is_available(int emitter)
+{
+	if (emitter < 0 || emitter >= EMITTER_NUM)
+		return false;
+
+	return (g_emitters[emitter].lirc_fd >= 0 || g_emitters[emitter].pwm_h != NULL);
+}
+
+peripheral_error_e resource_transmit_data(int emitter, bool enable)
 {
+	irtx_emitter_t *e = &g_emitters[emitter];
 	peripheral_error_e ret = PERIPHERAL_ERROR_NONE;
 
-	if (g_pwm_h == NULL){
+	if (e->pwm_h == NULL){
 		ERR("resource_transmit_data() failed!![%d]", ret);
 		return ret;
 	}
 
+	if (e->enable_fd >= 0) {
+		if (pwrite(e->enable_fd, &g_enable_value[enable], 1, 0) == 1)
+			return ret;
+
+		ERR("pwrite() failed!![%d], fall back to peripheral-io", errno);
+		close(e->enable_fd);
+		e->enable_fd = -1;
+	}
+
 	// Enabling
-	if ((ret = peripheral_pwm_set_enabled(g_pwm_h, enable)) != PERIPHERAL_ERROR_NONE) {
+	if ((ret = peripheral_pwm_set_enabled(e->pwm_h, enable)) != PERIPHERAL_ERROR_NONE) {
 		ERR("peripheral_pwm_set_enabled() failed!![%d]", ret);
 		return ret;
 	}
 
 	return ret;
 }
+
+extern bool irtrace_enabled;
+extern uint64_t irtrace_now(void);
+extern void irtrace_record(int emitter, int edge, bool level, uint64_t intended, uint64_t actual);
+
+static peripheral_error_e resource_irtx_pwm_transmit(int emitter, const ir_frame_t *frame)
+{
+	irtx_emitter_t *e = &g_emitters[emitter];
+	peripheral_error_e ret = PERIPHERAL_ERROR_NONE;
+	bool trace = __atomic_load_n(&irtrace_enabled, __ATOMIC_RELAXED);
+	uint64_t start = 0, offset = 0, now;
+	int i;
+
+	if (frame->carrier != e->carrier) {
+		if ((ret = resource_irtx_set_carrier(e, frame->carrier)) != PERIPHERAL_ERROR_NONE)
+			return ret;
+	}
+
+	for (i = 0; i < frame->len; i++) {
+		// even entries are marks, odd entries are spaces
+		if ((ret = resource_transmit_data(emitter, i % 2 == 0)) != PERIPHERAL_ERROR_NONE)
+			break;
+		if (i == 0)
+			latency_stamp(LATENCY_FIRST_EDGE);
+		else if (i == frame->len - 1 && i % 2)
+			latency_stamp(LATENCY_LAST_EDGE);
+		if (trace) {
+			now = irtrace_now();
+			if (i == 0)
+				start = now;
+			irtrace_record(emitter, i, i % 2 == 0, start + offset, now);
+			offset += frame->duration[i] * 1000ULL;
+		}
+		mysleep_microsec(frame->duration[i]);
+	}
+
+	// never leave the carrier on
+	if (ret != PERIPHERAL_ERROR_NONE || frame->len % 2) {
+		resource_transmit_data(emitter, false);
+		latency_stamp(LATENCY_LAST_EDGE);
+		if (trace && ret == PERIPHERAL_ERROR_NONE)
+			irtrace_record(emitter, frame->len, false, start + offset, irtrace_now());
+	}
+
+	return ret;
+}
+
+/*
+ * Transmit a precomputed frame through the kernel lirc device of the emitter
+ * when there is one, otherwise by toggling its PWM from here.
+ */
+peripheral_error_e resource_irtx_transmit(int emitter, const ir_frame_t *frame)
+{
+	if (!resource_irtx_is_available(emitter)) {
+		ERR("emitter [%d] is not available", emitter);
+		return PERIPHERAL_ERROR_INVALID_PARAMETER;
+	}
+
+	if (frame->overflow) {
+		ERR("frame longer than %d edges", IR_FRAME_MAX_LEN);
+		return PERIPHERAL_ERROR_INVALID_PARAMETER;
+	}
+
+	if (g_emitters[emitter].lirc_fd >= 0)
+		return resource_irtx_lirc_transmit(&g_emitters[emitter], frame);
+
+	return resource_irtx_pwm_transmit(emitter, frame);
+}
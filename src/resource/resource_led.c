@@ -14,6 +14,7 @@
  * limitations under the License.
  */
 
+#include <pthread.h>
 #include "log.h"
 #include <peripheral_io.h>
 
@@ -25,6 +26,10 @@
 static peripheral_gpio_h green_led_h = NULL;
 static peripheral_gpio_h red_led_h = NULL;
 
+// emitters transmit in parallel, the led is on while any of them is active
+static pthread_mutex_t led_lock = PTHREAD_MUTEX_INITIALIZER;
+static int led_active_count = 0;
+
 int resource_close_led(peripheral_gpio_h handle)
 {
 	int ret = PERIPHERAL_ERROR_NONE;
@@ -78,13 +83,19 @@ int resource_write_led(peripheral_gpio_h handle, int write_value)
 void write_led(bool on)
 {
 	//INFO("write_led [%d]", on);
+	pthread_mutex_lock(&led_lock);
 	if (on == true) {
-		resource_write_led(green_led_h, LED_ON);
-		resource_write_led(red_led_h, LED_OFF);
+		if (led_active_count++ == 0) {
+			resource_write_led(green_led_h, LED_ON);
+			resource_write_led(red_led_h, LED_OFF);
+		}
 	} else {
-		resource_write_led(green_led_h, LED_OFF);
-		resource_write_led(red_led_h, LED_ON);
+		if (led_active_count > 0 && --led_active_count == 0) {
+			resource_write_led(green_led_h, LED_OFF);
+			resource_write_led(red_led_h, LED_ON);
+		}
 	}
+	pthread_mutex_unlock(&led_lock);
 }
 
 int open_led_dev(void)
@@ -17,7 +17,16 @@
 #include <Ecore.h>
 #include <peripheral_io.h>
 #include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <pthread.h>
+#include <app_common.h>
 #include "remote_key.h"
+#include "ir_frame.h"
+#include "ir_protocol.h"
+#include "ir_codebook.h"
 #include "log.h"
 
 #define PRE_DATA_BITS		16
@@ -36,37 +45,73 @@
 #define STOP_MARK			493		//590
 #define STOP_SPACE			590
 
-cmd_t cmd_table[] = {
-	{0, "TV_KEY_POWER",       TV_KEY_POWER},
-	{1, "TV_KEY_CHANNELUP",   TV_KEY_CHANNELUP},
-	{2, "TV_KEY_CHANNELDOWN", TV_KEY_CHANNELDOWN},
-	{3, "TV_KEY_VOLUMEUP",    TV_KEY_VOLUMEUP},
-	{4, "TV_KEY_VOLUMEDOWN",  TV_KEY_VOLUMEDOWN},
+// gap between the two copies of a key press
+#define RESEND_SPACE		(52*1000)
+// minimum spacing of back-to-back frames of a held key (108ms frame period)
+#define REPEAT_SPACE		(46*1000)
+
+// built-in commands, learned ones are appended at run time
+#define CMD_TABLE_MAX		64
+#define CMD_BUILTIN_NUM		20
+
+cmd_t cmd_table[CMD_TABLE_MAX] = {
+	{0, "TV_KEY_POWER",       TV_KEY_POWER,       DEVICE_TV,     0,                PRIORITY_URGENT},
+	{1, "TV_KEY_CHANNELUP",   TV_KEY_CHANNELUP,   DEVICE_TV,     0,                PRIORITY_NORMAL},
+	{2, "TV_KEY_CHANNELDOWN", TV_KEY_CHANNELDOWN, DEVICE_TV,     0,                PRIORITY_NORMAL},
+	{3, "TV_KEY_VOLUMEUP",    TV_KEY_VOLUMEUP,    DEVICE_TV,     0,                PRIORITY_LOW},
+	{4, "TV_KEY_VOLUMEDOWN",  TV_KEY_VOLUMEDOWN,  DEVICE_TV,     0,                PRIORITY_LOW},
 	// not used keys
-	{5, "TV_KEY_MENU",       TV_KEY_MENU},
-	{6, "TV_KEY_UP",         TV_KEY_UP},
-	{7, "TV_KEY_DOWN",       TV_KEY_DOWN},
-	{8, "TV_KEY_LEFT",       TV_KEY_LEFT},
-	{9, "TV_KEY_RIGHT",      TV_KEY_RIGHT},
+	{5, "TV_KEY_MENU",        TV_KEY_MENU,        DEVICE_TV,     0,                PRIORITY_LOW},
+	{6, "TV_KEY_UP",          TV_KEY_UP,          DEVICE_TV,     0,                PRIORITY_LOW},
+	{7, "TV_KEY_DOWN",        TV_KEY_DOWN,        DEVICE_TV,     0,                PRIORITY_LOW},
+	{8, "TV_KEY_LEFT",        TV_KEY_LEFT,        DEVICE_TV,     0,                PRIORITY_LOW},
+	{9, "TV_KEY_RIGHT",       TV_KEY_RIGHT,       DEVICE_TV,     0,                PRIORITY_LOW},
 
 	// Robot Vacuum cleaner
-	{10, "VA_KEY_UP",        VA_KEY_UP},
-	{11, "VA_KEY_DOWN",      VA_KEY_DOWN},
-	{12, "VA_KEY_RIGHT",     VA_KEY_RIGHT},
-	{13, "VA_KEY_LEFT",      VA_KEY_LEFT},
-	{14, "VA_KEY_START",     VA_KEY_START},
-	{15, "VA_KEY_RANDOM",    VA_KEY_RANDOM},
-	{16, "VA_KEY_CIRCLE",    VA_KEY_CIRCLE},
-	{17, "VA_KEY_WALL",      VA_KEY_WALL},
-	{18, "VA_KEY_SCHED",     VA_KEY_SCHED},
-	{19, "VA_KEY_HOME",      VA_KEY_HOME},
+	{10, "VA_KEY_UP",         VA_KEY_UP,          DEVICE_VACUUM, CMD_FLAG_MAILBOX, PRIORITY_NORMAL},
+	{11, "VA_KEY_DOWN",       VA_KEY_DOWN,        DEVICE_VACUUM, CMD_FLAG_MAILBOX, PRIORITY_NORMAL},
+	{12, "VA_KEY_RIGHT",      VA_KEY_RIGHT,       DEVICE_VACUUM, CMD_FLAG_MAILBOX, PRIORITY_NORMAL},
+	{13, "VA_KEY_LEFT",       VA_KEY_LEFT,        DEVICE_VACUUM, CMD_FLAG_MAILBOX, PRIORITY_NORMAL},
+	{14, "VA_KEY_START",      VA_KEY_START,       DEVICE_VACUUM, 0,                PRIORITY_URGENT},
+	{15, "VA_KEY_RANDOM",     VA_KEY_RANDOM,      DEVICE_VACUUM, 0,                PRIORITY_NORMAL},
+	{16, "VA_KEY_CIRCLE",     VA_KEY_CIRCLE,      DEVICE_VACUUM, 0,                PRIORITY_NORMAL},
+	{17, "VA_KEY_WALL",       VA_KEY_WALL,        DEVICE_VACUUM, 0,                PRIORITY_NORMAL},
+	{18, "VA_KEY_SCHED",      VA_KEY_SCHED,       DEVICE_VACUUM, 0,                PRIORITY_NORMAL},
+	{19, "VA_KEY_HOME",       VA_KEY_HOME,        DEVICE_VACUUM, 0,                PRIORITY_URGENT},
+};
+
+// maps devices to the second emitter, e.g. "vacuum sub"
+#define EMITTER_FILE_NAME	"emitters.conf"
+#define LEARNED_FILE_NAME	"learned.conf"
+
+// emitter facing each device, the main one unless emitters.conf says otherwise
+int device_emitter[DEVICE_NUM] = {
+	EMITTER_MAIN,	// DEVICE_TV
+	EMITTER_MAIN,	// DEVICE_VACUUM
 };
 
-#define ROBOT_VACUUM_KEY_INDEX 10
+static const char *device_names[DEVICE_NUM] = { "tv", "vacuum" };
+static const char *emitter_names[EMITTER_NUM] = { "main", "sub" };
 
-extern peripheral_error_e resource_transmit_data(bool enable);
+static int cmd_table_size = CMD_BUILTIN_NUM;
+static pthread_mutex_t cmd_table_lock = PTHREAD_MUTEX_INITIALIZER;
+
+const ir_protocol_t tv_protocol = {
+	"BN59-01180A", DEVICE_TV,
+	HEADER_MARK, HEADER_SPACE,
+	MARK_ONE, SPACE_ONE,
+	MARK_ZERO, SPACE_ZERO,
+	STOP_MARK,
+	PRE_DATA_BITS, PRE_DATA,
+	BITS_NUM,
+};
+
+extern peripheral_error_e resource_irtx_transmit(int emitter, const ir_frame_t *frame);
+extern bool resource_irtx_is_available(int emitter);
 extern void write_led(bool on);
-extern bool process_vacuum_key(int index);
+extern int process_vacuum_key_repeat(int index, int count);
+extern int remocon_queue_push_key(int index, int count, remocon_done_cb done, void *data);
+extern bool remocon_queue_preempted(int emitter, int priority);
 
 void mysleep_microsec(int microsec)
 {
@@ -80,18 +125,18 @@ void mysleep_microsec(int microsec)
     clock_nanosleep(CLOCK_MONOTONIC, 0, &res, NULL);
 }
 
-void mark(unsigned int time)
+/*
+ * mark and space append to a frame which is handed to the transmitter
+ * as a whole, so the timing is not disturbed by the encoding work.
+ */
+int mark(ir_frame_t *frame, unsigned int time)
 {
-	resource_transmit_data(true);
-	//usleep(time);
-	mysleep_microsec(time);
+	return ir_frame_add(frame, 1, time);
 }
 
-void space(unsigned int time)
+int space(ir_frame_t *frame, unsigned int time)
 {
-	resource_transmit_data(false);
-	//usleep(time);
-	mysleep_microsec(time);
+	return ir_frame_add(frame, 0, time);
 }
 
 /*
@@ -103,7 +148,7 @@ void space(unsigned int time)
  *
  * https://www.vishay.com/docs/80071/dataform.pdf
  */
-void send_key_data(uint16_t key_value)
+void send_key_data(ir_frame_t *frame, uint16_t key_value)
 {
 	int nbits = PRE_DATA_BITS + BITS_NUM;
 	unsigned long data = 0;
@@ -115,41 +160,146 @@ void send_key_data(uint16_t key_value)
 	for (unsigned long  mask = 1UL << (nbits - 1);  mask;  mask >>= 1) {
 		if (data & mask) {
 			// for bit 1
-			mark(MARK_ONE);
-			space(SPACE_ONE);
+			mark(frame, MARK_ONE);
+			space(frame, SPACE_ONE);
 		} else {
 			// for bit 0
-			mark(MARK_ZERO);
-			space(SPACE_ZERO);
+			mark(frame, MARK_ZERO);
+			space(frame, SPACE_ZERO);
+		}
+	}
+}
+
+static int find_name(const char **names, int num, const char *name)
+{
+	int i;
+
+	for (i = 0; i < num; i++) {
+		if (0 == strcasecmp(names[i], name))
+			return i;
+	}
+
+	return -1;
+}
+
+/*
+ * A board with a single LED may still open the PWM of the second emitter,
+ * so a device only moves to it when emitters.conf opts in.
+ * Called before the emitters are opened.
+ */
+void remocon_emitter_load(void)
+{
+	char *data_path = app_get_data_path();
+	char path[256];
+	char line[128];
+	char device[32], emitter[32];
+	int d, e;
+	FILE *fp;
+
+	if (data_path == NULL) {
+		ERR("app_get_data_path() failed");
+		return;
+	}
+
+	snprintf(path, sizeof(path), "%s%s", data_path, EMITTER_FILE_NAME);
+	free(data_path);
+
+	fp = fopen(path, "r");
+	if (fp == NULL) {
+		INFO("no emitter map in [%s], all devices on the main emitter", path);
+		return;
+	}
+
+	while (fgets(line, sizeof(line), fp) != NULL) {
+		if (line[0] == '#' || sscanf(line, "%31s %31s", device, emitter) != 2)
+			continue;
+
+		d = find_name(device_names, DEVICE_NUM, device);
+		e = find_name(emitter_names, EMITTER_NUM, emitter);
+		if (d < 0 || e < 0) {
+			ERR("invalid emitter map [%s %s]", device, emitter);
+			continue;
 		}
+
+		device_emitter[d] = e;
+		INFO("%s on the %s emitter", device_names[d], emitter_names[e]);
+	}
+
+	fclose(fp);
+}
+
+// an emitter no device faces is not opened at all
+bool remocon_emitter_used(int emitter)
+{
+	int i;
+
+	if (emitter == EMITTER_MAIN)
+		return true;
+
+	for (i = 0; i < DEVICE_NUM; i++) {
+		if (device_emitter[i] == emitter)
+			return true;
 	}
+
+	return false;
 }
 
-static void send_key_once(uint16_t key_value)
+/*
+ * Emitter to send the command of cmd_table with.
+ * Devices whose emitter is not available share the main one.
+ */
+int remocon_get_emitter(int index)
 {
+	int emitter = device_emitter[cmd_table[index].device];
+
+	if (!resource_irtx_is_available(emitter))
+		emitter = EMITTER_MAIN;
+
+	return emitter;
+}
+
+static peripheral_error_e send_key_once(int emitter, uint16_t key_value)
+{
+	ir_frame_t frame;
+
+	ir_frame_init(&frame, IR_CARRIER_38KHZ);
+
 	// send_header_bit
-	mark(HEADER_MARK);
-	space(HEADER_SPACE);
+	mark(&frame, HEADER_MARK);
+	space(&frame, HEADER_SPACE);
 
 	// send_data
-	send_key_data(key_value);
+	send_key_data(&frame, key_value);
 
 	// send_stop_bit
-	mark(STOP_MARK);
-	space(STOP_SPACE);
+	mark(&frame, STOP_MARK);
+	space(&frame, STOP_SPACE);
+
+	return resource_irtx_transmit(emitter, &frame);
 }
 
-bool send_remote_key_data(int index)
+/*
+ * Send 'count' coalesced presses of the same key as one transmission.
+ * Samsung protocol has no dedicated repeat frame, so a held key is sent as
+ * full frames back-to-back at the minimum inter-frame spacing.
+ * A more urgent command waiting for the emitter stops the run at the next
+ * frame boundary. Returns the number of presses sent, -1 when the
+ * transmitter failed.
+ */
+int send_remote_key_repeat(int index, int count)
 {
-	INFO("%d : %s : 0x%04x", index, cmd_table[index].cmd, cmd_table[index].key_value);
+	int emitter = remocon_get_emitter(index);
+	int i;
+
+	if (count < 1)
+		count = 1;
+
+	INFO("%d : %s : 0x%04x x %d", index, cmd_table[index].cmd, cmd_table[index].key_value, count);
 
-	if (index >= ROBOT_VACUUM_KEY_INDEX) {
+	if (cmd_table[index].device == DEVICE_VACUUM) {
 		// defined for AC Remote
 		//if (process_vacuum_key(cmd_table[index].key_value))
-		if (process_vacuum_key(index))
-			return true;
-		else
-			return false;
+		return process_vacuum_key_repeat(index, count);
 	}
 
 
@@ -158,32 +308,239 @@ bool send_remote_key_data(int index)
 
 	// samsung TV remote controller send key data twice
 	// send first key data
-	send_key_once(cmd_table[index].key_value);
+	if (send_key_once(emitter, cmd_table[index].key_value) != PERIPHERAL_ERROR_NONE)
+		goto error;
 
 	// wait for a while
-	mysleep_microsec(52*1000);
+	mysleep_microsec(RESEND_SPACE);
 
 	// send again same key data
-	send_key_once(cmd_table[index].key_value);
+	if (send_key_once(emitter, cmd_table[index].key_value) != PERIPHERAL_ERROR_NONE)
+		goto error;
+
+	// every further press is one more frame of the held key
+	for (i = 1; i < count; i++) {
+		if (remocon_queue_preempted(emitter, cmd_table[index].priority))
+			break;
+		mysleep_microsec(REPEAT_SPACE);
+		if (send_key_once(emitter, cmd_table[index].key_value) != PERIPHERAL_ERROR_NONE)
+			goto error;
+	}
 
 	// Turn OFF led to indicate ir transmit is ended
 	write_led(false);
 
+	return i;
+
+error:
+	write_led(false);
+
+	return -1;
+}
+
+bool send_remote_key_data(int index)
+{
+	return (send_remote_key_repeat(index, 1) == 1);
+}
+
+int remocon_cmd_count(void)
+{
+	return __atomic_load_n(&cmd_table_size, __ATOMIC_ACQUIRE);
+}
+
+/*
+ * Append a command to cmd_table.
+ * Entries are never moved or removed, so readers only need to see the new
+ * size after the entry is complete.
+ */
+int remocon_cmd_add(const char *name, uint16_t key_value, int device)
+{
+	cmd_t *entry;
+	int index;
+
+	pthread_mutex_lock(&cmd_table_lock);
+
+	for (index = 0; index < cmd_table_size; index++) {
+		if (0 == strcmp(name, cmd_table[index].cmd)) {
+			pthread_mutex_unlock(&cmd_table_lock);
+			ERR("cmd [%s] already exists", name);
+			return -1;
+		}
+	}
+
+	if (cmd_table_size == CMD_TABLE_MAX) {
+		pthread_mutex_unlock(&cmd_table_lock);
+		ERR("cmd_table is full");
+		return -1;
+	}
+
+	index = cmd_table_size;
+	entry = &cmd_table[index];
+	entry->index = index;
+	snprintf(entry->cmd, sizeof(entry->cmd), "%s", name);
+	entry->key_value = key_value;
+	entry->device = device;
+	entry->flags = 0;
+	entry->priority = PRIORITY_NORMAL;
+
+	__atomic_store_n(&cmd_table_size, index + 1, __ATOMIC_RELEASE);
+
+	pthread_mutex_unlock(&cmd_table_lock);
+
+	INFO("%d : %s : 0x%04x added", index, entry->cmd, key_value);
+
+	return index;
+}
+
+static bool learned_file_path(char *path, size_t size)
+{
+	char *data_path = app_get_data_path();
+
+	if (data_path == NULL) {
+		ERR("app_get_data_path() failed");
+		return false;
+	}
+
+	snprintf(path, size, "%s%s", data_path, LEARNED_FILE_NAME);
+	free(data_path);
+
 	return true;
 }
 
-bool process_command(int length, char *cmd)
+/*
+ * Add a learned command and keep it in learned.conf for the next start
+ */
+int remocon_cmd_learn(const char *name, uint16_t key_value, int device)
 {
+	char path[256];
 	int index;
-	size_t size = sizeof(cmd_table) / sizeof(cmd_table[0]);
-	//INFO("size of cmd_table = [%d]", size);
+	FILE *fp;
+
+	index = remocon_cmd_add(name, key_value, device);
+	if (index < 0 || !learned_file_path(path, sizeof(path)))
+		return index;
+
+	fp = fopen(path, "a");
+	if (fp == NULL) {
+		ERR("failed to open [%s]", path);
+		return index;
+	}
+
+	fprintf(fp, "%s %s 0x%04x\n", name, device_names[device], key_value);
+	if (fclose(fp) != 0)
+		ERR("failed to save [%s] to [%s]", name, path);
+
+	return index;
+}
+
+/*
+ * Restore the commands learned before, lines of "<name> <device> <key_value>"
+ */
+void remocon_learned_load(void)
+{
+	char path[256];
+	char line[128];
+	char name[32], device[32];
+	unsigned int key_value;
+	int d;
+	FILE *fp;
+
+	if (!learned_file_path(path, sizeof(path)))
+		return;
+
+	fp = fopen(path, "r");
+	if (fp == NULL)
+		return;
+
+	while (fgets(line, sizeof(line), fp) != NULL) {
+		if (line[0] == '#' || sscanf(line, "%31s %31s %x", name, device, &key_value) != 3)
+			continue;
+
+		d = find_name(device_names, DEVICE_NUM, device);
+		if (d < 0 || key_value > 0xffff) {
+			ERR("invalid learned command [%s %s 0x%x]", name, device, key_value);
+			continue;
+		}
+
+		remocon_cmd_add(name, (uint16_t)key_value, d);
+	}
+
+	fclose(fp);
+}
+
+extern int resource_irrx_learn(const char *name);
+extern bool remocon_raw_is_raw(const char *cmd);
+extern bool process_raw_command(const char *cmd);
+extern int remocon_codebook_find(const char *name, ir_codebook_t **book);
+extern int remocon_codebook_reload(void);
+extern int remocon_queue_push_code(ir_codebook_t *book, int entry, int count, remocon_done_cb done, void *data);
+extern bool remocon_macro_is_macro(const char *cmd);
+extern bool process_macro_command(const char *cmd);
+extern bool remocon_schedule_is_schedule(const char *cmd);
+extern bool process_schedule_command(const char *cmd);
+extern bool latency_is_latency(const char *cmd);
+extern bool process_latency_command(const char *cmd);
+extern bool irtrace_is_irtrace(const char *cmd);
+extern bool process_irtrace_command(const char *cmd);
+
+#define LEARN_PREFIX		"LEARN:"
+#define CODEBOOK_RELOAD		"CODEBOOK:RELOAD"
+
+/*
+ * Queue 'count' presses of a key by name, see remocon_queue_push_key().
+ * Returns -1 when the key is unknown or the queue is full.
+ */
+int remocon_push_key(const char *name, int count, remocon_done_cb done, void *data)
+{
+	int index;
+	int size = remocon_cmd_count();
+	ir_codebook_t *book;
+	int entry;
+
+	// the codebook comes first, so it can also replace built-in codes
+	entry = remocon_codebook_find(name, &book);
+	if (entry >= 0)
+		return remocon_queue_push_code(book, entry, count, done, data);
 
 	for (index = 0; index < size; index++) {
-		if (0 == strcmp(cmd, cmd_table[index].cmd)) {
-			INFO("cmd [%s] : index [%d] - key [%s]", cmd, index, cmd_table[index].cmd);
-			return send_remote_key_data(index);
+		if (0 == strcmp(name, cmd_table[index].cmd)) {
+			INFO("cmd [%s] : index [%d] - key [%s]", name, index, cmd_table[index].cmd);
+			return remocon_queue_push_key(index, count, done, data);
 		}
 	}
 
-	return false;
+	return -1;
+}
+
+bool process_command(int length, char *cmd)
+{
+	// LEARN:<name> captures the next frame from the receiver as <name>
+	if (0 == strncmp(cmd, LEARN_PREFIX, strlen(LEARN_PREFIX)))
+		return (resource_irrx_learn(cmd + strlen(LEARN_PREFIX)) == 0);
+
+	// RAW:... or PRONTO:... for devices without a modelled protocol
+	if (remocon_raw_is_raw(cmd))
+		return process_raw_command(cmd);
+
+	// swap in a codebook file renamed over the old one
+	if (0 == strcmp(cmd, CODEBOOK_RELOAD))
+		return (remocon_codebook_reload() == 0);
+
+	// MACRO:<name> runs a stored plan of keys, MACRO_SET:<name>=<plan> stores one
+	if (remocon_macro_is_macro(cmd))
+		return process_macro_command(cmd);
+
+	// SCHEDULE:<in|at|daily> <when> <command> sends a command later
+	if (remocon_schedule_is_schedule(cmd))
+		return process_schedule_command(cmd);
+
+	// LATENCY:<ON|OFF|RESET|DUMP|PUBLISH <sec>> controls the latency histograms
+	if (latency_is_latency(cmd))
+		return process_latency_command(cmd);
+
+	// IRTRACE:<ON|OFF|DUMP> records the PWM edges against their frames
+	if (irtrace_is_irtrace(cmd))
+		return process_irtrace_command(cmd);
+
+	return (remocon_push_key(cmd, 1, NULL, NULL) == 0);
 }
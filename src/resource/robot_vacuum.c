@@ -16,7 +16,10 @@
 
 #include <stdbool.h>
 #include <stdint.h>
+#include <peripheral_io.h>
 #include "remote_key.h"
+#include "ir_frame.h"
+#include "ir_protocol.h"
 #include "log.h"
 
 #define VA_PRE_DATA				0xA2AA0A
@@ -37,19 +40,35 @@
 #define VA_EXTRA_MARK			8980
 #define VA_EXTRA_SPACE			2298
 #define VA_EXTRA_PULSE			570
+#define VA_EXTRA_GAP			VA_STOP_SPACE
 
-extern void mark(unsigned int time);
-extern void space(unsigned int time);
+extern int mark(ir_frame_t *frame, unsigned int time);
+extern int space(ir_frame_t *frame, unsigned int time);
+extern peripheral_error_e resource_irtx_transmit(int emitter, const ir_frame_t *frame);
+extern int remocon_get_emitter(int index);
+extern bool remocon_queue_preempted(int emitter, int priority);
 extern void write_led(bool on);
 extern cmd_t cmd_table[];
 
+int process_vacuum_key_repeat(int index, int count);
+
 unsigned char pre_key[3] = { 0xA2, 0xAA, 0x0A };
 
+const ir_protocol_t vacuum_protocol = {
+	"FC8794", DEVICE_VACUUM,
+	VA_HEADER_MARK, VA_HEADER_SPACE,
+	VA_MARK_ONE, VA_SPACE_ONE,
+	VA_MARK_ZERO, VA_SPACE_ZERO,
+	VA_STOP_MARK,
+	24, VA_PRE_DATA,
+	VA_BITS_NUM,
+};
+
 /*
  * Philips FC8794 Robot vacuum cleaner remote controller
  * remote code is composed with 5 bytes
  */
-void send_vacuum_key_data(int index)
+void send_vacuum_key_data(ir_frame_t *frame, int index)
 {
 	int nbits = 8;
 	uint8_t data = 0;
@@ -61,12 +80,12 @@ void send_vacuum_key_data(int index)
 		for (uint8_t mask = 1 << (nbits - 1);  mask;  mask >>= 1) {
 			if (data & mask) {
 				// for bit 1
-				mark(VA_MARK_ONE);
-				space(VA_SPACE_ONE);
+				mark(frame, VA_MARK_ONE);
+				space(frame, VA_SPACE_ONE);
 			} else {
 				// for bit 0
-				mark(VA_MARK_ZERO);
-				space(VA_SPACE_ZERO);
+				mark(frame, VA_MARK_ZERO);
+				space(frame, VA_SPACE_ZERO);
 			}
 		}
 	}
@@ -78,37 +97,82 @@ void send_vacuum_key_data(int index)
 	for (uint16_t mask = 1 << (nbits - 1);  mask;  mask >>= 1) {
 		if (key_value & mask) {
 			// for bit 1
-			mark(VA_MARK_ONE);
-			space(VA_SPACE_ONE);
+			mark(frame, VA_MARK_ONE);
+			space(frame, VA_SPACE_ONE);
 		} else {
 			// for bit 0
-			mark(VA_MARK_ZERO);
-			space(VA_SPACE_ZERO);
+			mark(frame, VA_MARK_ZERO);
+			space(frame, VA_SPACE_ZERO);
 		}
 	}
 }
 
+/*
+ * NEC style repeat frame sent while a key is held down
+ */
+static peripheral_error_e send_vacuum_repeat_frame(int emitter)
+{
+	ir_frame_t frame;
+
+	ir_frame_init(&frame, IR_CARRIER_38KHZ);
+
+	mark(&frame, VA_EXTRA_MARK);
+	space(&frame, VA_EXTRA_SPACE);
+	mark(&frame, VA_EXTRA_PULSE);
+	space(&frame, VA_EXTRA_GAP);
+
+	return resource_irtx_transmit(emitter, &frame);
+}
+
 bool process_vacuum_key(int index)
 {
+	return (process_vacuum_key_repeat(index, 1) == 1);
+}
+
+/*
+ * Send 'count' coalesced presses of the same key as one full frame followed
+ * by repeat frames, as the original remote controller does for a held key.
+ * Returns the number of presses sent before a more urgent command took over,
+ * -1 when the transmitter failed.
+ */
+int process_vacuum_key_repeat(int index, int count)
+{
+	int emitter = remocon_get_emitter(index);
+	ir_frame_t frame;
+	int i;
+
+	ir_frame_init(&frame, IR_CARRIER_38KHZ);
+
 	// Turn ON led to indicate ir transmit is activated
 	write_led(true);
 
 	// send_header_bit
-	mark(VA_HEADER_MARK);
-	space(VA_HEADER_SPACE);
+	mark(&frame, VA_HEADER_MARK);
+	space(&frame, VA_HEADER_SPACE);
 
 	// send_data
-	send_vacuum_key_data(index);
+	send_vacuum_key_data(&frame, index);
 
 	// send_stop_bit
-	mark(VA_STOP_MARK);
-	space(VA_STOP_SPACE);
+	mark(&frame, VA_STOP_MARK);
+	space(&frame, VA_STOP_SPACE);
+
+	if (resource_irtx_transmit(emitter, &frame) != PERIPHERAL_ERROR_NONE) {
+		write_led(false);
+		return -1;
+	}
+
+	for (i = 1; i < count; i++) {
+		if (remocon_queue_preempted(emitter, cmd_table[index].priority))
+			break;
+		if (send_vacuum_repeat_frame(emitter) != PERIPHERAL_ERROR_NONE) {
+			write_led(false);
+			return -1;
+		}
+	}
 
 	// Turn OFF led to indicate ir transmit is ended
 	write_led(false);
 
-	return true;
+	return i;
 }
-
-
-
@@ -21,11 +21,25 @@
 
 extern peripheral_error_e resource_irtx_close(void);
 extern peripheral_error_e resource_irtx_init(void);
+extern void remocon_emitter_load(void);
+extern void remocon_learned_load(void);
 extern int open_led_dev(void);
 extern int close_led_dev(void);
+extern int remocon_queue_init(void);
+extern int resource_irrx_init(void);
+extern int resource_irrx_close(void);
+extern int remocon_queue_close(void);
+extern int remocon_codebook_init(void);
+extern void remocon_codebook_close(void);
+extern int remocon_macro_init(void);
+extern void remocon_macro_close(void);
+extern int remocon_schedule_init(void);
+extern void remocon_schedule_close(void);
 
 extern bool terminate_yield_thread;
 extern int init_mqtt(void);
+extern int mqtt_dispatch_init(void);
+extern void mqtt_dispatch_close(void);
 
 #define MAX_RETRY_COUNT	100
 
@@ -34,6 +48,7 @@ bool service_app_create(void *data)
 	INFO("service_app_create\n");
 
 	int ret = 0;
+	remocon_emitter_load();
 	ret = resource_irtx_init();
 	if (ret != 0 ) {
 		ERR("resource_irtx_init() failed!![%d]", ret);
@@ -44,6 +59,38 @@ bool service_app_create(void *data)
 		ERR("open_led_dev() failed!![%d]", ret);
 		return false;
 	}
+	ret = resource_irrx_init();
+	if (ret != 0 ) {
+		// learning mode is optional
+		WARN("resource_irrx_init() failed!![%d]", ret);
+	}
+	remocon_learned_load();
+	ret = remocon_codebook_init();
+	if (ret != 0 ) {
+		ERR("remocon_codebook_init() failed!![%d]", ret);
+		return false;
+	}
+	ret = remocon_queue_init();
+	if (ret != 0 ) {
+		ERR("remocon_queue_init() failed!![%d]", ret);
+		return false;
+	}
+	ret = remocon_macro_init();
+	if (ret != 0 ) {
+		ERR("remocon_macro_init() failed!![%d]", ret);
+		return false;
+	}
+	ret = remocon_schedule_init();
+	if (ret != 0 ) {
+		ERR("remocon_schedule_init() failed!![%d]", ret);
+		return false;
+	}
+
+	ret = mqtt_dispatch_init();
+	if (ret != 0 ) {
+		ERR("mqtt_dispatch_init() failed!![%d]", ret);
+		return false;
+	}
 
 	int count = 0;
 	while (count < MAX_RETRY_COUNT) {
@@ -67,6 +114,13 @@ void service_app_terminate(void *data)
 
 	terminate_yield_thread = true;
 
+	// queued commands still reach the transmit queue
+	mqtt_dispatch_close();
+	remocon_schedule_close();
+	remocon_macro_close();
+	remocon_queue_close();
+	remocon_codebook_close();
+	resource_irrx_close();
 	close_led_dev();
 	resource_irtx_close();
 
@@ -0,0 +1,44 @@
+/*
+ * Copyright (c) 2018 Samsung Electronics Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef __CODEBOOK_H__
+#define __CODEBOOK_H__
+
+#include <stdint.h>
+#include "ir_frame.h"
+#include "ir_codebook.h"
+
+#define NAME_MAX_LEN		64
+
+typedef struct {
+	codebook_entry_t *entries;
+	uint32_t entry_count;
+	uint32_t entry_alloc;
+	uint32_t *durations;
+	uint32_t duration_count;
+	uint32_t duration_alloc;
+	char *strings;
+	uint32_t strings_size;
+	uint32_t strings_alloc;
+} codebook_t;
+
+int codebook_parse_device(const char *text);
+int codebook_add(codebook_t *book, const char *name, int device, int priority,
+	int send_count, const ir_frame_t *frame, const ir_frame_t *repeat);
+int lircd_import(codebook_t *book, const char *path, int device);
+
+#endif /* __CODEBOOK_H__ */
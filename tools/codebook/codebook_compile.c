@@ -0,0 +1,399 @@
+/*
+ * Copyright (c) 2018 Samsung Electronics Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/*
+ * Host side compiler of the IR codebook file
+ *
+ *   codebook_compile [-d <device>] <source>... <codebook.bin>
+ *
+ * Sources ending in .conf are lircd.conf files (see lircd_import.c), their
+ * keys go to the device given by the last -d before them, tv by default.
+ * Each line of any other source is one key, '#' starts a comment:
+ *
+ *   <name> <device> <priority> <carrier> <send count> <frame> [<repeat frame>]
+ *
+ *   device    tv, vacuum or a device number below DEVICE_NUM
+ *   priority  urgent, normal or low
+ *   frame     comma separated mark,space,... durations in usec
+ *
+ * The output is written next to the target and renamed over it, so an app
+ * mapping the old file never sees a partial one. Push it to the data
+ * directory of the app the same way and send CODEBOOK:RELOAD.
+ * The file is little endian, like the host and the target.
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "remote_key.h"
+#include "codebook.h"
+
+#define LINE_MAX_LEN		4096
+
+#define MIN_DURATION		50			// usec
+#define MAX_DURATION		500000		// usec
+
+// trailing space of a frame which ends with a mark
+#define FRAME_GAP			40000		// usec
+
+static void *grow(void *buf, uint32_t *alloc, uint32_t need, size_t item)
+{
+	if (need <= *alloc)
+		return buf;
+
+	while (*alloc < need)
+		*alloc = *alloc ? *alloc * 2 : 64;
+
+	buf = realloc(buf, *alloc * item);
+	if (buf == NULL) {
+		fprintf(stderr, "out of memory\n");
+		exit(1);
+	}
+
+	return buf;
+}
+
+static int find_name(const codebook_t *book, const char *name)
+{
+	uint32_t i;
+
+	for (i = 0; i < book->entry_count; i++) {
+		if (0 == strcmp(book->strings + book->entries[i].name_offset, name))
+			return i;
+	}
+
+	return -1;
+}
+
+int codebook_parse_device(const char *text)
+{
+	char *end;
+	long device;
+
+	if (0 == strcmp(text, "tv"))
+		return DEVICE_TV;
+	if (0 == strcmp(text, "vacuum"))
+		return DEVICE_VACUUM;
+
+	device = strtol(text, &end, 10);
+	if (end == text || *end != '\0' || device < 0 || device >= DEVICE_NUM)
+		return -1;
+
+	return device;
+}
+
+static int parse_priority(const char *text)
+{
+	if (0 == strcmp(text, "urgent"))
+		return PRIORITY_URGENT;
+	if (0 == strcmp(text, "normal"))
+		return PRIORITY_NORMAL;
+	if (0 == strcmp(text, "low"))
+		return PRIORITY_LOW;
+
+	return -1;
+}
+
+/*
+ * Parse a comma separated mark,space,... list into 'frame'
+ */
+static int parse_durations(const char *text, ir_frame_t *frame)
+{
+	unsigned long time;
+	const char *p = text;
+	char *end;
+
+	frame->len = 0;
+	while (*p) {
+		time = strtoul(p, &end, 10);
+		if (end == p || frame->len == IR_FRAME_MAX_LEN)
+			return -1;
+		frame->duration[frame->len++] = time;
+
+		p = end;
+		if (*p == ',')
+			p++;
+		else if (*p != '\0')
+			return -1;
+	}
+
+	return 0;
+}
+
+/*
+ * Append a frame to the duration arrays, ending it with a space.
+ * Returns the number of durations, or -1 when the frame is invalid.
+ */
+static int add_durations(codebook_t *book, const ir_frame_t *frame)
+{
+	uint32_t start = book->duration_count;
+	int len = frame->len;
+	int i;
+
+	if (len == 0 || len + (len % 2) > IR_FRAME_MAX_LEN)
+		return -1;
+
+	for (i = 0; i < len; i++) {
+		if (frame->duration[i] < MIN_DURATION || frame->duration[i] > MAX_DURATION)
+			return -1;
+	}
+
+	book->durations = grow(book->durations, &book->duration_alloc, start + len + 1, sizeof(uint32_t));
+	memcpy(&book->durations[start], frame->duration, len * sizeof(uint32_t));
+
+	// keep frames apart when they are sent back-to-back
+	if (len % 2)
+		book->durations[start + len++] = FRAME_GAP;
+
+	book->duration_count += len;
+
+	return len;
+}
+
+int codebook_add(codebook_t *book, const char *name, int device, int priority,
+	int send_count, const ir_frame_t *frame, const ir_frame_t *repeat)
+{
+	codebook_entry_t *entry;
+	uint32_t name_len = strlen(name) + 1;
+	int len;
+
+	if (name_len > NAME_MAX_LEN || find_name(book, name) >= 0) {
+		fprintf(stderr, "key [%s] is too long or defined twice\n", name);
+		return -1;
+	}
+
+	if (frame->carrier < CODEBOOK_MIN_CARRIER || frame->carrier > CODEBOOK_MAX_CARRIER || send_count < 1 || send_count > 255) {
+		fprintf(stderr, "key [%s] has an invalid carrier or send count\n", name);
+		return -1;
+	}
+
+	book->entries = grow(book->entries, &book->entry_alloc, book->entry_count + 1, sizeof(*entry));
+	entry = &book->entries[book->entry_count];
+	memset(entry, 0, sizeof(*entry));
+
+	entry->frame_offset = book->duration_count;
+	len = add_durations(book, frame);
+	if (len < 0) {
+		fprintf(stderr, "key [%s] has an invalid frame\n", name);
+		return -1;
+	}
+	entry->frame_len = len;
+
+	entry->repeat_offset = book->duration_count;
+	if (repeat != NULL) {
+		len = add_durations(book, repeat);
+		if (len < 0) {
+			fprintf(stderr, "key [%s] has an invalid repeat frame\n", name);
+			return -1;
+		}
+		entry->repeat_len = len;
+	}
+
+	book->strings = grow(book->strings, &book->strings_alloc, book->strings_size + name_len, 1);
+	memcpy(book->strings + book->strings_size, name, name_len);
+	entry->name_offset = book->strings_size;
+	book->strings_size += name_len;
+
+	entry->name_hash = codebook_hash(name);
+	entry->carrier = frame->carrier;
+	entry->device = device;
+	entry->priority = priority;
+	entry->send_count = send_count;
+	book->entry_count++;
+
+	return 0;
+}
+
+static int parse_source(codebook_t *book, FILE *fp)
+{
+	static ir_frame_t frame;
+	static ir_frame_t repeat;
+	char line[LINE_MAX_LEN];
+	char *field[7];
+	char *save;
+	char *p;
+	int line_no = 0;
+	int n;
+
+	while (fgets(line, sizeof(line), fp) != NULL) {
+		line_no++;
+
+		p = strchr(line, '#');
+		if (p != NULL)
+			*p = '\0';
+
+		n = 0;
+		for (p = strtok_r(line, " \t\r\n", &save); p != NULL; p = strtok_r(NULL, " \t\r\n", &save)) {
+			if (n == 7)
+				break;
+			field[n++] = p;
+		}
+
+		if (n == 0)
+			continue;
+
+		if (n < 6 || n > 7 || codebook_parse_device(field[1]) < 0 || parse_priority(field[2]) < 0 ||
+			parse_durations(field[5], &frame) != 0 || (n == 7 && parse_durations(field[6], &repeat) != 0)) {
+			fprintf(stderr, "line %d: syntax error\n", line_no);
+			return -1;
+		}
+
+		frame.carrier = strtoul(field[3], NULL, 10);
+		repeat.carrier = frame.carrier;
+
+		if (codebook_add(book, field[0], codebook_parse_device(field[1]), parse_priority(field[2]),
+			atoi(field[4]), &frame, n == 7 ? &repeat : NULL) != 0) {
+			fprintf(stderr, "line %d: invalid key\n", line_no);
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+static uint32_t align4(uint32_t offset)
+{
+	return (offset + 3) & ~3u;
+}
+
+static int codebook_write(codebook_t *book, const char *path)
+{
+	codebook_header_t header;
+	uint32_t *buckets;
+	uint32_t bucket;
+	uint32_t i;
+	char tmp_path[1024];
+	FILE *fp;
+	int ok;
+
+	if (book->entry_count == 0) {
+		fprintf(stderr, "no keys\n");
+		return -1;
+	}
+
+	memset(&header, 0, sizeof(header));
+	header.magic = CODEBOOK_MAGIC;
+	header.version = CODEBOOK_VERSION;
+	header.entry_count = book->entry_count;
+
+	// load factor of at most 0.5
+	header.hash_size = 1;
+	while (header.hash_size < book->entry_count * 2)
+		header.hash_size *= 2;
+
+	buckets = calloc(header.hash_size, sizeof(uint32_t));
+	if (buckets == NULL)
+		return -1;
+
+	for (i = 0; i < book->entry_count; i++) {
+		bucket = book->entries[i].name_hash & (header.hash_size - 1);
+		book->entries[i].next = buckets[bucket];
+		buckets[bucket] = i + 1;
+	}
+
+	header.entries_offset = align4(sizeof(header));
+	header.buckets_offset = header.entries_offset + book->entry_count * sizeof(codebook_entry_t);
+	header.durations_offset = header.buckets_offset + header.hash_size * sizeof(uint32_t);
+	header.strings_offset = header.durations_offset + book->duration_count * sizeof(uint32_t);
+	header.strings_size = book->strings_size;
+	header.file_size = header.strings_offset + header.strings_size;
+
+	snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+	fp = fopen(tmp_path, "wb");
+	if (fp == NULL) {
+		perror(tmp_path);
+		free(buckets);
+		return -1;
+	}
+
+	ok = fwrite(&header, sizeof(header), 1, fp) == 1 &&
+		fwrite(book->entries, sizeof(codebook_entry_t), book->entry_count, fp) == book->entry_count &&
+		fwrite(buckets, sizeof(uint32_t), header.hash_size, fp) == header.hash_size &&
+		fwrite(book->durations, sizeof(uint32_t), book->duration_count, fp) == book->duration_count &&
+		fwrite(book->strings, 1, book->strings_size, fp) == book->strings_size;
+	free(buckets);
+
+	if (fclose(fp) != 0 || !ok || rename(tmp_path, path) != 0) {
+		perror(path);
+		remove(tmp_path);
+		return -1;
+	}
+
+	printf("%s: %u keys, %u durations, %u bytes\n", path,
+		book->entry_count, book->duration_count, header.file_size);
+
+	return 0;
+}
+
+static bool is_lircd_conf(const char *path)
+{
+	size_t len = strlen(path);
+
+	return (len > 5 && 0 == strcmp(path + len - 5, ".conf"));
+}
+
+int main(int argc, char *argv[])
+{
+	codebook_t book;
+	int device = DEVICE_TV;
+	FILE *fp;
+	int ret = 0;
+	int i;
+
+	if (argc < 3) {
+		fprintf(stderr, "usage: %s [-d <device>] <source>... <codebook.bin>\n", argv[0]);
+		return 2;
+	}
+
+	memset(&book, 0, sizeof(book));
+
+	for (i = 1; i < argc - 1 && ret == 0; i++) {
+		if (0 == strcmp(argv[i], "-d") && i + 1 < argc - 1) {
+			device = codebook_parse_device(argv[++i]);
+			if (device < 0) {
+				fprintf(stderr, "unknown device [%s]\n", argv[i]);
+				ret = -1;
+			}
+			continue;
+		}
+
+		if (is_lircd_conf(argv[i])) {
+			ret = lircd_import(&book, argv[i], device);
+			continue;
+		}
+
+		fp = fopen(argv[i], "r");
+		if (fp == NULL) {
+			perror(argv[i]);
+			ret = -1;
+			break;
+		}
+		ret = parse_source(&book, fp);
+		fclose(fp);
+	}
+
+	if (ret == 0)
+		ret = codebook_write(&book, argv[argc - 1]);
+
+	free(book.entries);
+	free(book.durations);
+	free(book.strings);
+
+	return (ret == 0) ? 0 : 1;
+}
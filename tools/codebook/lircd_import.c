@@ -0,0 +1,445 @@
+/*
+ * Copyright (c) 2018 Samsung Electronics Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/*
+ * lircd.conf importer
+ *
+ * Space and pulse encoded remotes and raw_codes sections are compiled into
+ * precomputed frames, one codebook key per code named <remote>_<code>, so
+ * a remote named TV replaces the built-in TV_KEY_* codes.
+ * Bi-phase (RC5, RC6, SHIFT_ENC) remotes are skipped, so are remotes with
+ * toggle bits since a precomputed frame can not change from press to press.
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdint.h>
+#include "remote_key.h"
+#include "codebook.h"
+
+#define LINE_MAX_LEN		1024
+#define DEFAULT_FREQUENCY	38000
+
+typedef enum {
+	LIRCD_NONE,
+	LIRCD_REMOTE,
+	LIRCD_CODES,
+	LIRCD_RAW_CODES,
+} lircd_section_e;
+
+typedef struct {
+	char name[NAME_MAX_LEN];
+	bool supported;
+	bool const_length;
+	int bits;
+	int pre_data_bits;
+	int post_data_bits;
+	uint64_t pre_data;
+	uint64_t post_data;
+	unsigned int header[2];
+	unsigned int one[2];
+	unsigned int zero[2];
+	unsigned int repeat[2];
+	unsigned int pre[2];	// pulse and space between pre_data and the code
+	unsigned int post[2];	// pulse and space between the code and post_data
+	unsigned int foot[2];	// pulse and space after ptrail, sent space first
+	unsigned int plead;
+	unsigned int ptrail;
+	unsigned int gap;
+	unsigned int repeat_gap;
+	unsigned int frequency;
+	unsigned int min_repeat;
+	bool toggles;	// toggle_bit_mask, toggle_mask or toggle_bit set
+} lircd_remote_t;
+
+typedef struct {
+	codebook_t *book;
+	int device;
+	lircd_remote_t remote;
+	char raw_name[NAME_MAX_LEN];
+	ir_frame_t raw_frame;
+	int raw_count;
+	int key_count;
+	int line_no;
+} lircd_parser_t;
+
+static void remote_reset(lircd_remote_t *remote)
+{
+	memset(remote, 0, sizeof(*remote));
+	remote->supported = true;
+	remote->frequency = DEFAULT_FREQUENCY;
+}
+
+static unsigned int frame_length(const ir_frame_t *frame)
+{
+	unsigned int sum = 0;
+	int i;
+
+	for (i = 0; i < frame->len; i++)
+		sum += frame->duration[i];
+
+	return sum;
+}
+
+// with CONST_LENGTH the gap is the whole period from frame start to frame start
+static void add_gap(const lircd_remote_t *remote, ir_frame_t *frame, unsigned int gap)
+{
+	unsigned int length = frame_length(frame);
+
+	if (remote->const_length)
+		gap = (gap > length) ? gap - length : 0;
+
+	if (gap > 0)
+		ir_frame_add(frame, 0, gap);
+}
+
+static void add_bits(const lircd_remote_t *remote, ir_frame_t *frame, uint64_t data, int bits)
+{
+	const unsigned int *pair;
+	int i;
+
+	for (i = bits - 1; i >= 0; i--) {
+		pair = ((data >> i) & 1) ? remote->one : remote->zero;
+		ir_frame_add(frame, 1, pair[0]);
+		ir_frame_add(frame, 0, pair[1]);
+	}
+}
+
+static void encode_code(const lircd_remote_t *remote, uint64_t code, ir_frame_t *frame)
+{
+	ir_frame_init(frame, remote->frequency);
+
+	if (remote->header[0] || remote->header[1]) {
+		ir_frame_add(frame, 1, remote->header[0]);
+		ir_frame_add(frame, 0, remote->header[1]);
+	}
+	if (remote->plead)
+		ir_frame_add(frame, 1, remote->plead);
+
+	add_bits(remote, frame, remote->pre_data, remote->pre_data_bits);
+	if (remote->pre[0] && remote->pre[1]) {
+		ir_frame_add(frame, 1, remote->pre[0]);
+		ir_frame_add(frame, 0, remote->pre[1]);
+	}
+	add_bits(remote, frame, code, remote->bits);
+	if (remote->post[0] && remote->post[1]) {
+		ir_frame_add(frame, 1, remote->post[0]);
+		ir_frame_add(frame, 0, remote->post[1]);
+	}
+	add_bits(remote, frame, remote->post_data, remote->post_data_bits);
+
+	if (remote->ptrail)
+		ir_frame_add(frame, 1, remote->ptrail);
+	if (remote->foot[0] && remote->foot[1]) {
+		ir_frame_add(frame, 0, remote->foot[1]);
+		ir_frame_add(frame, 1, remote->foot[0]);
+	}
+
+	add_gap(remote, frame, remote->gap);
+}
+
+// NULL when a held key repeats the whole frame
+static ir_frame_t *encode_repeat(const lircd_remote_t *remote, ir_frame_t *frame)
+{
+	if (remote->repeat[0] == 0 && remote->repeat[1] == 0)
+		return NULL;
+
+	ir_frame_init(frame, remote->frequency);
+	ir_frame_add(frame, 1, remote->repeat[0]);
+	ir_frame_add(frame, 0, remote->repeat[1]);
+	if (remote->ptrail)
+		ir_frame_add(frame, 1, remote->ptrail);
+	add_gap(remote, frame, remote->repeat_gap ? remote->repeat_gap : remote->gap);
+
+	return frame;
+}
+
+static int send_count(const lircd_remote_t *remote)
+{
+	return (remote->min_repeat < 254) ? remote->min_repeat + 1 : 255;
+}
+
+static int add_key(lircd_parser_t *p, const char *code_name, const ir_frame_t *frame, const ir_frame_t *repeat)
+{
+	char name[2 * NAME_MAX_LEN];
+
+	snprintf(name, sizeof(name), "%s_%s", p->remote.name, code_name);
+	if (frame->overflow || (repeat != NULL && repeat->overflow)) {
+		fprintf(stderr, "line %d: [%s] is longer than %d edges\n", p->line_no, name, IR_FRAME_MAX_LEN);
+		return -1;
+	}
+	if (codebook_add(p->book, name, p->device, PRIORITY_NORMAL, send_count(&p->remote), frame, repeat) != 0)
+		return -1;
+
+	p->key_count++;
+
+	return 0;
+}
+
+static int flush_raw(lircd_parser_t *p)
+{
+	int ret = 0;
+
+	if (p->raw_name[0] == '\0')
+		return 0;
+
+	if (p->raw_frame.len % 2)
+		add_gap(&p->remote, &p->raw_frame, p->remote.gap);
+
+	if (p->raw_count > 0)
+		ret = add_key(p, p->raw_name, &p->raw_frame, NULL);
+	p->raw_name[0] = '\0';
+
+	return ret;
+}
+
+static void parse_flags(lircd_remote_t *remote, char *flags)
+{
+	static const char *unsupported[] = {
+		"RC5", "RC6", "RCMM", "SHIFT_ENC", "GRUNDIG", "BO", "XMP", "SERIAL",
+	};
+	char *save;
+	char *flag;
+	size_t i;
+
+	for (flag = strtok_r(flags, "|", &save); flag != NULL; flag = strtok_r(NULL, "|", &save)) {
+		if (0 == strcasecmp(flag, "CONST_LENGTH"))
+			remote->const_length = true;
+
+		for (i = 0; i < sizeof(unsupported) / sizeof(unsupported[0]); i++) {
+			if (0 == strcasecmp(flag, unsupported[i]))
+				remote->supported = false;
+		}
+	}
+}
+
+static void parse_remote_line(lircd_parser_t *p, const char *key, const char *arg1, const char *arg2)
+{
+	lircd_remote_t *remote = &p->remote;
+	char flags[LINE_MAX_LEN];
+	unsigned int value = strtoul(arg1, NULL, 0);
+
+	if (0 == strcasecmp(key, "name")) {
+		snprintf(remote->name, sizeof(remote->name), "%s", arg1);
+	} else if (0 == strcasecmp(key, "flags")) {
+		snprintf(flags, sizeof(flags), "%s", arg1);
+		parse_flags(remote, flags);
+	} else if (0 == strcasecmp(key, "bits")) {
+		remote->bits = value;
+	} else if (0 == strcasecmp(key, "pre_data_bits")) {
+		remote->pre_data_bits = value;
+	} else if (0 == strcasecmp(key, "pre_data")) {
+		remote->pre_data = strtoull(arg1, NULL, 0);
+	} else if (0 == strcasecmp(key, "post_data_bits")) {
+		remote->post_data_bits = value;
+	} else if (0 == strcasecmp(key, "post_data")) {
+		remote->post_data = strtoull(arg1, NULL, 0);
+	} else if (0 == strcasecmp(key, "header")) {
+		remote->header[0] = value;
+		remote->header[1] = strtoul(arg2, NULL, 0);
+	} else if (0 == strcasecmp(key, "one")) {
+		remote->one[0] = value;
+		remote->one[1] = strtoul(arg2, NULL, 0);
+	} else if (0 == strcasecmp(key, "zero")) {
+		remote->zero[0] = value;
+		remote->zero[1] = strtoul(arg2, NULL, 0);
+	} else if (0 == strcasecmp(key, "repeat")) {
+		remote->repeat[0] = value;
+		remote->repeat[1] = strtoul(arg2, NULL, 0);
+	} else if (0 == strcasecmp(key, "pre")) {
+		remote->pre[0] = value;
+		remote->pre[1] = strtoul(arg2, NULL, 0);
+	} else if (0 == strcasecmp(key, "post")) {
+		remote->post[0] = value;
+		remote->post[1] = strtoul(arg2, NULL, 0);
+	} else if (0 == strcasecmp(key, "foot")) {
+		remote->foot[0] = value;
+		remote->foot[1] = strtoul(arg2, NULL, 0);
+	} else if (0 == strcasecmp(key, "plead")) {
+		remote->plead = value;
+	} else if (0 == strcasecmp(key, "ptrail")) {
+		remote->ptrail = value;
+	} else if (0 == strcasecmp(key, "gap")) {
+		remote->gap = value;
+	} else if (0 == strcasecmp(key, "repeat_gap")) {
+		remote->repeat_gap = value;
+	} else if (0 == strcasecmp(key, "frequency")) {
+		// 0 marks an unmodulated receiver, the emitter always needs a carrier
+		if (value == 0)
+			fprintf(stderr, "line %d: remote [%s] has no carrier, sent at %d Hz\n",
+				p->line_no, remote->name, DEFAULT_FREQUENCY);
+		remote->frequency = value ? value : DEFAULT_FREQUENCY;
+	} else if (0 == strcasecmp(key, "min_repeat")) {
+		remote->min_repeat = value;
+	} else if (0 == strcasecmp(key, "toggle_bit_mask") || 0 == strcasecmp(key, "toggle_mask") ||
+		0 == strcasecmp(key, "toggle_bit")) {
+		if (strtoull(arg1, NULL, 0) != 0)
+			remote->toggles = true;
+	}
+	// eps, aeps and the rest only matter to a receiver
+}
+
+static bool remote_valid(lircd_parser_t *p)
+{
+	lircd_remote_t *remote = &p->remote;
+
+	if (!remote->supported) {
+		fprintf(stderr, "line %d: remote [%s] uses an unsupported encoding, skipped\n", p->line_no, remote->name);
+		return false;
+	}
+
+	if (remote->toggles) {
+		fprintf(stderr, "line %d: remote [%s] toggles bits between presses, skipped\n", p->line_no, remote->name);
+		return false;
+	}
+
+	if (remote->bits + remote->pre_data_bits + remote->post_data_bits > 64 ||
+		(remote->one[0] | remote->one[1]) == 0 || (remote->zero[0] | remote->zero[1]) == 0) {
+		fprintf(stderr, "line %d: remote [%s] has no valid bit timing, skipped\n", p->line_no, remote->name);
+		return false;
+	}
+
+	return true;
+}
+
+static int parse_line(lircd_parser_t *p, lircd_section_e *section, char *line)
+{
+	static ir_frame_t frame;
+	static ir_frame_t repeat;
+	char *save;
+	char *key;
+	char *arg;
+	char *arg2;
+	unsigned long time;
+
+	key = strtok_r(line, " \t\r\n", &save);
+	if (key == NULL)
+		return 0;
+
+	if (0 == strcasecmp(key, "begin") || 0 == strcasecmp(key, "end")) {
+		bool begin = (0 == strcasecmp(key, "begin"));
+
+		arg = strtok_r(NULL, " \t\r\n", &save);
+		if (arg == NULL)
+			return -1;
+
+		if (begin && 0 == strcasecmp(arg, "remote")) {
+			remote_reset(&p->remote);
+			*section = LIRCD_REMOTE;
+		} else if (begin && 0 == strcasecmp(arg, "codes")) {
+			*section = remote_valid(p) ? LIRCD_CODES : LIRCD_NONE;
+		} else if (begin && 0 == strcasecmp(arg, "raw_codes")) {
+			*section = p->remote.supported ? LIRCD_RAW_CODES : LIRCD_NONE;
+			p->raw_name[0] = '\0';
+		} else if (!begin && 0 == strcasecmp(arg, "raw_codes")) {
+			if (*section == LIRCD_RAW_CODES && flush_raw(p) != 0)
+				return -1;
+			*section = LIRCD_REMOTE;
+		} else if (!begin && 0 == strcasecmp(arg, "codes")) {
+			*section = LIRCD_REMOTE;
+		} else if (!begin && 0 == strcasecmp(arg, "remote")) {
+			*section = LIRCD_NONE;
+		}
+		return 0;
+	}
+
+	switch (*section) {
+	case LIRCD_REMOTE:
+		arg = strtok_r(NULL, " \t\r\n", &save);
+		arg2 = strtok_r(NULL, " \t\r\n", &save);
+		parse_remote_line(p, key, arg ? arg : "", arg2 ? arg2 : "0");
+		break;
+
+	case LIRCD_CODES:
+		arg = strtok_r(NULL, " \t\r\n", &save);
+		if (arg == NULL)
+			return -1;
+		encode_code(&p->remote, strtoull(arg, NULL, 0), &frame);
+		return add_key(p, key, &frame, encode_repeat(&p->remote, &repeat));
+
+	case LIRCD_RAW_CODES:
+		if (0 == strcasecmp(key, "name")) {
+			if (flush_raw(p) != 0)
+				return -1;
+			arg = strtok_r(NULL, " \t\r\n", &save);
+			if (arg == NULL)
+				return -1;
+			snprintf(p->raw_name, sizeof(p->raw_name), "%s", arg);
+			ir_frame_init(&p->raw_frame, p->remote.frequency);
+			p->raw_count = 0;
+			break;
+		}
+
+		// pulse and space lengths, possibly over several lines
+		for (; key != NULL; key = strtok_r(NULL, " \t\r\n", &save)) {
+			time = strtoul(key, NULL, 10);
+			if (p->raw_name[0] == '\0' || p->raw_count == IR_FRAME_MAX_LEN)
+				return -1;
+			ir_frame_add(&p->raw_frame, p->raw_count % 2 == 0, time);
+			p->raw_count++;
+		}
+		break;
+
+	default:
+		break;
+	}
+
+	return 0;
+}
+
+int lircd_import(codebook_t *book, const char *path, int device)
+{
+	lircd_section_e section = LIRCD_NONE;
+	lircd_parser_t parser;
+	char line[LINE_MAX_LEN];
+	char *comment;
+	FILE *fp;
+	int ret = 0;
+
+	fp = fopen(path, "r");
+	if (fp == NULL) {
+		perror(path);
+		return -1;
+	}
+
+	memset(&parser, 0, sizeof(parser));
+	parser.book = book;
+	parser.device = device;
+	remote_reset(&parser.remote);
+
+	while (ret == 0 && fgets(line, sizeof(line), fp) != NULL) {
+		parser.line_no++;
+
+		comment = strchr(line, '#');
+		if (comment != NULL)
+			*comment = '\0';
+
+		ret = parse_line(&parser, &section, line);
+		if (ret != 0)
+			fprintf(stderr, "%s:%d: invalid line\n", path, parser.line_no);
+	}
+
+	fclose(fp);
+
+	if (ret == 0)
+		printf("%s: %d keys imported\n", path, parser.key_count);
+
+	return ret;
+}